@@ -0,0 +1,850 @@
+#include "board.h"
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define SETTINGS_OFFSET offsetof(struct Board, lightEnable)
+#define SETTINGS_SIZE   (offsetof(struct Board, chunksW) - SETTINGS_OFFSET)
+
+struct MapFileHeader
+{
+    char     magic[4];
+    uint32_t version;
+    int32_t  w, h;
+    int32_t  chunksW, chunksH;
+    int32_t  numObjects;
+    int32_t  regionsW, regionsH;
+    uint32_t settingsSize;
+};
+
+struct Chunk SolidChunk = {.index = -1};
+
+static void initSolidChunk()
+{
+    int i;
+
+    if (SolidChunk.tiles[0] == TILE_SOLID)
+        return;
+
+    for (i = 0; i < CHUNK_AREA; i++)
+        SolidChunk.tiles[i] = TILE_SOLID;
+
+    updateChunkBits(&SolidChunk);
+}
+
+static uint16_t blockBits(const uint32_t* rows)
+{
+    int bx, by, y;
+    uint32_t any;
+    uint16_t blocks = 0;
+
+    for (by = 0; by < BLOCKS_PER_ROW; by++)
+    {
+        any = 0;
+
+        for (y = by * BLOCK_SIZE; y < (by+1) * BLOCK_SIZE; y++)
+            any |= rows[y];
+
+        for (bx = 0; bx < BLOCKS_PER_ROW; bx++)
+        {
+            if ((any >> (bx * BLOCK_SIZE)) & ((1u << BLOCK_SIZE)-1))
+                blocks |= 1 << (by * BLOCKS_PER_ROW + bx);
+        }
+    }
+
+    return blocks;
+}
+
+void updateChunkBits(struct Chunk* chunk)
+{
+    int x, y;
+    uint16_t tile;
+
+    for (y = 0; y < CHUNK_SIZE; y++)
+    {
+        chunk->occBits[y] = 0;
+        chunk->obsBits[y] = 0;
+        chunk->wallBits[y] = 0;
+
+        for (x = 0; x < CHUNK_SIZE; x++)
+        {
+            tile = chunk->tiles[(y << CHUNK_SHIFT) | x];
+
+            if (tile & TILE_OCCLUSION) chunk->occBits[y] |= 1u << x;
+            if (tile & TILE_OBSTACLE)  chunk->obsBits[y] |= 1u << x;
+            if (tile & (TILE_OCCLUSION | TILE_PARTIAL_OCC)) chunk->wallBits[y] |= 1u << x;
+        }
+    }
+
+    chunk->occBlocks = blockBits(chunk->occBits);
+    chunk->obsBlocks = blockBits(chunk->obsBits);
+    chunk->wallBlocks = blockBits(chunk->wallBits);
+}
+
+void updateTileBits(struct Board* board_, int x, int y)
+{
+    struct Chunk* chunk = chunkAt(board_, x, y);
+    uint16_t tile       = chunk->tiles[chunkOffset(x, y)];
+    uint32_t bit        = 1u << (x & CHUNK_MASK);
+    int row             = y & CHUNK_MASK;
+
+    if (chunk == &SolidChunk)
+        return;
+
+    chunk->occBits[row] = (tile & TILE_OCCLUSION) ? (chunk->occBits[row] | bit) : (chunk->occBits[row] & ~bit);
+    chunk->obsBits[row] = (tile & TILE_OBSTACLE)  ? (chunk->obsBits[row] | bit) : (chunk->obsBits[row] & ~bit);
+    chunk->occBlocks    = blockBits(chunk->occBits);
+    chunk->wallBits[row] = (tile & (TILE_OCCLUSION | TILE_PARTIAL_OCC)) ? (chunk->wallBits[row] | bit) : (chunk->wallBits[row] & ~bit);
+    chunk->obsBlocks    = blockBits(chunk->obsBits);
+    chunk->wallBlocks   = blockBits(chunk->wallBits);
+}
+
+static void recordEdit(struct Board* board_, int x, int y, uint16_t tile)
+{
+    int index = (y >> CHUNK_SHIFT) * board_->chunksW + (x >> CHUNK_SHIFT);
+    int i;
+    struct TileEdit* grown;
+
+    if (board_->chunkEdits == NULL)
+    {
+        if ((board_->chunkEdits = malloc(board_->numChunks * sizeof(int))) == NULL)
+        {
+            printf("Error - recordEdit() could not allocate the edit lists\n");
+
+            return;
+        }
+
+        memset(board_->chunkEdits, 0xFF, board_->numChunks * sizeof(int));
+    }
+
+    for (i = board_->chunkEdits[index]; i >= 0; i = board_->edits[i].next)
+    {
+        if (board_->edits[i].x == x && board_->edits[i].y == y)
+        {
+            board_->edits[i].tile   = tile;
+            board_->edits[i].serial = ++board_->editSerial;
+
+            return;
+        }
+    }
+
+    if (board_->numEdits == board_->maxEdits)
+    {
+        if ((grown = realloc(board_->edits, SDL_max(64, board_->maxEdits * 2) * sizeof(struct TileEdit))) == NULL)
+        {
+            printf("Error - recordEdit() could not keep the edit at %d,%d\n", x, y);
+
+            return;
+        }
+
+        board_->edits    = grown;
+        board_->maxEdits = SDL_max(64, board_->maxEdits * 2);
+    }
+
+    board_->edits[board_->numEdits] = (struct TileEdit){x, y, tile, ++board_->editSerial, board_->chunkEdits[index]};
+    board_->chunkEdits[index]       = board_->numEdits++;
+}
+
+// Puts the edits made to a chunk back after it's read in again
+static void applyEdits(struct Board* board_, struct Chunk* chunk)
+{
+    int i;
+
+    if (board_->chunkEdits == NULL || board_->chunkEdits[chunk->index] < 0)
+        return;
+
+    for (i = board_->chunkEdits[chunk->index]; i >= 0; i = board_->edits[i].next)
+        chunk->tiles[chunkOffset(board_->edits[i].x, board_->edits[i].y)] = board_->edits[i].tile;
+
+    updateChunkBits(chunk);
+}
+
+// The way the game changes a tile once the map is loaded: the occlusion bits follow at once, and the change is
+// queued for the light and cached chunk textures to catch up on. A streamed chunk gets the edits made to it back
+// whenever it's read in, so one that isn't loaded just has the edit kept for then.
+int setTile(struct Board* board_, int x, int y, uint16_t tile)
+{
+    struct Chunk* chunk;
+    uint16_t before;
+
+    if (!inBoard(board_, x, y))
+        return 1;
+
+    if ((chunk = chunkAt(board_, x, y)) == &SolidChunk)
+    {
+        if (board_->Streamer == NULL)
+            return 1;
+
+        recordEdit(board_, x, y, tile);
+
+        return 0;
+    }
+
+    before = chunk->tiles[chunkOffset(x, y)];
+
+    if ((before & ~TILE_LIT) == (tile & ~TILE_LIT))
+        return 0;
+
+    chunk->tiles[chunkOffset(x, y)] = tile;
+    updateTileBits(board_, x, y);
+    recordEdit(board_, x, y, tile);
+
+    if (board_->numChanges < MAX_TILE_CHANGES)
+        board_->changes[board_->numChanges++] = (struct TileChange){x, y, before, tile};
+    else
+        board_->changesLost = 1;
+
+    return 0;
+}
+
+// Moves the queued changes into changes[MAX_TILE_CHANGES] and empties the queue; lost is set if some didn't fit
+int takeTileChanges(struct Board* board_, struct TileChange* changes, int* lost)
+{
+    int count = board_->numChanges;
+
+    memcpy(changes, board_->changes, count * sizeof(struct TileChange));
+    *lost = board_->changesLost;
+
+    board_->numChanges  = 0;
+    board_->changesLost = 0;
+
+    return count;
+}
+
+// Zeroed memory from the level arena, or the heap if there is no arena or it's full
+void* boardAlloc(struct Board* board_, size_t size)
+{
+    void* pointer = board_->Memory ? callocArena(&board_->Memory->Level, 1, size) : NULL;
+
+    return pointer ? pointer : calloc(1, size);
+}
+
+// Arena memory goes back when the level arena is reset on map unload
+void boardFree(struct Board* board_, void* pointer)
+{
+    if (board_->Memory == NULL || !arenaOwns(&board_->Memory->Level, pointer))
+        free(pointer);
+}
+
+struct Board* createBoard(struct Memory* memory)
+{
+    struct Board Temp = {.Memory = memory};
+    struct Board* newBoard = boardAlloc(&Temp, sizeof(struct Board));
+
+    if (newBoard)
+        newBoard->Memory = memory;
+
+    return newBoard;
+}
+
+// Resident chunks live as long as the level, streamed ones come and go, so they're pooled
+static struct Chunk* newChunk(struct Memory* memory, int index, int streamed)
+{
+    int i;
+    struct Chunk* chunk = NULL;
+
+    if (memory)
+        chunk = streamed ? allocPool(&memory->Chunks) : allocArena(&memory->Level, sizeof(struct Chunk));
+
+    if (chunk == NULL && (chunk = malloc(sizeof(struct Chunk))) == NULL)
+        return NULL;
+
+    chunk->index = index;
+
+    // tiles of edge chunks that fall outside the map stay solid
+    for (i = 0; i < CHUNK_AREA; i++)
+        chunk->tiles[i] = TILE_SOLID;
+
+    memset(chunk->light, 0, CHUNK_AREA);
+    updateChunkBits(chunk);
+
+    return chunk;
+}
+
+static void freeChunk(struct Memory* memory, struct Chunk* chunk)
+{
+    if (memory && poolOwns(&memory->Chunks, chunk))
+        freePool(&memory->Chunks, chunk);
+    else if (memory == NULL || !arenaOwns(&memory->Level, chunk))
+        free(chunk);
+}
+
+int allocChunks(struct Board* board_, int resident)
+{
+    int i;
+
+    initSolidChunk();
+
+    board_->chunksW     = (board_->w + CHUNK_MASK) >> CHUNK_SHIFT;
+    board_->chunksH     = (board_->h + CHUNK_MASK) >> CHUNK_SHIFT;
+    board_->numChunks   = board_->chunksW * board_->chunksH;
+    board_->numResident = 0;
+    board_->chunkTable  = boardAlloc(board_, board_->numChunks * sizeof(struct Chunk*));
+    board_->chunkState  = boardAlloc(board_, board_->numChunks * sizeof(uint8_t));
+
+    if (board_->chunkTable == NULL || board_->chunkState == NULL)
+    {
+        printf("Error - allocChunks() failed for %d chunks\n", board_->numChunks);
+
+        return 1;
+    }
+
+    for (i = 0; i < board_->numChunks; i++)
+    {
+        board_->chunkTable[i] = &SolidChunk;
+
+        if (resident)
+        {
+            if ((board_->chunkTable[i] = newChunk(board_->Memory, i, 0)) == NULL)
+            {
+                printf("Error - allocChunks() ran out of memory at chunk %d\n", i);
+                board_->chunkTable[i] = &SolidChunk;
+
+                return 1;
+            }
+
+            board_->chunkState[i] = CHUNK_RESIDENT;
+            board_->numResident++;
+        }
+    }
+
+    return 0;
+}
+
+void freeChunks(struct Board* board_)
+{
+    int i;
+
+    stopStreaming(board_);
+
+    for (i = 0; i < board_->numChunks; i++)
+    {
+        if (board_->chunkTable[i] != &SolidChunk)
+            freeChunk(board_->Memory, board_->chunkTable[i]);
+    }
+
+    boardFree(board_, board_->chunkTable);
+    boardFree(board_, board_->chunkState);
+    board_->chunkTable  = NULL;
+    board_->chunkState  = NULL;
+    board_->numChunks   = 0;
+    board_->numResident = 0;
+}
+
+void freeBoard(struct Board* board_)
+{
+    if (board_ == NULL)
+        return;
+
+    freeChunks(board_);
+    free(board_->edits);
+    free(board_->chunkEdits);
+    boardFree(board_, board_->objects);
+    boardFree(board_, board_->visibility);
+    boardFree(board_, board_);
+}
+
+int sameSettings(struct Board* a, struct Board* b)
+{
+    return memcmp((char*)a + SETTINGS_OFFSET, (char*)b + SETTINGS_OFFSET, SETTINGS_SIZE) == 0;
+}
+
+void copySettings(struct Board* dst, struct Board* src)
+{
+    memcpy((char*)dst + SETTINGS_OFFSET, (char*)src + SETTINGS_OFFSET, SETTINGS_SIZE);
+}
+
+/****************************
+* Potentially visible sets *
+****************************/
+#define VISIBILITY_SHIFT    1
+#define VISIBILITY_SUBDIV   (1 << VISIBILITY_SHIFT)         // rays start on a grid this much finer than tiles, so they thread narrow gaps
+#define VISIBILITY_RADIUS   ((PVS_RANGE+1) * BLOCK_SIZE * VISIBILITY_SUBDIV)   // far enough to reach every region in the set
+
+static int seesThrough(struct Board* board_, int x, int y)
+{
+    uint16_t tile = tileAt(board_, x, y);
+
+    return !(tile & TILE_OCCLUSION) || (tile & (TILE_TOGGLE | TILE_BREAKABLE));
+}
+
+// Walks every cell the line between two cell centres crosses, marking their regions in the set of the one it
+// started in, up to and including the first wall. Through a corner exactly, it goes on diagonally.
+static void visibilityRay(struct Board* board_, uint64_t* set, int ax, int ay, int bx, int by)
+{
+    const int shift = BLOCK_SHIFT + VISIBILITY_SHIFT;
+    int x = ax, y = ay, rx, ry;
+    int dx = abs(bx - ax), dy = abs(by - ay);
+    int stepX = (bx > ax) ? 1 : -1, stepY = (by > ay) ? 1 : -1;
+    int n = 1 + dx + dy, error = dx - dy;
+
+    dx *= 2;
+    dy *= 2;
+
+    for (; n > 0 && x >= 0 && y >= 0 && inBoard(board_, x / VISIBILITY_SUBDIV, y / VISIBILITY_SUBDIV); n--)
+    {
+        rx = (x >> shift) - (ax >> shift) + PVS_RANGE;
+        ry = (y >> shift) - (ay >> shift) + PVS_RANGE;
+
+        if ((unsigned)rx < PVS_SPAN && (unsigned)ry < PVS_SPAN)
+            *set |= 1ull << (ry * PVS_SPAN + rx);
+
+        if (!seesThrough(board_, x / VISIBILITY_SUBDIV, y / VISIBILITY_SUBDIV))
+            return;
+
+        if (error > 0)
+        {
+            x     += stepX;
+            error -= dy;
+        }
+        else if (error < 0)
+        {
+            y     += stepY;
+            error += dx;
+        }
+        else
+        {
+            x     += stepX;
+            y     += stepY;
+            error += dx - dy;
+            n--;
+        }
+    }
+}
+
+// What each 8x8 region could see of the others, for culling whatever is in the rest. Rays go out from every open
+// cell to a tile's worth of cells apart on the edge of a square around it; doors and breakable walls don't stop them, so the sets
+// hold whatever the game does to those at runtime. Needs the whole map resident.
+int buildVisibility(struct Board* board_)
+{
+    int x, y, i, r;
+    uint64_t* set;
+    uint64_t bits;
+    Uint64 start = SDL_GetPerformanceCounter();
+    long visible = 0;
+
+    if (board_->Streamer)
+        return 1;
+
+    board_->regionsW = (board_->w + BLOCK_SIZE-1) >> BLOCK_SHIFT;
+    board_->regionsH = (board_->h + BLOCK_SIZE-1) >> BLOCK_SHIFT;
+
+    if (board_->visibility == NULL)
+        board_->visibility = boardAlloc(board_, board_->regionsW * board_->regionsH * sizeof(uint64_t));
+
+    if (board_->visibility == NULL)
+    {
+        printf("Error - buildVisibility() could not allocate %d regions\n", board_->regionsW * board_->regionsH);
+
+        return 1;
+    }
+
+    memset(board_->visibility, 0, board_->regionsW * board_->regionsH * sizeof(uint64_t));
+
+    for (y = 0; y < board_->h * VISIBILITY_SUBDIV; y++)
+    {
+        for (x = 0; x < board_->w * VISIBILITY_SUBDIV; x++)
+        {
+            if (!seesThrough(board_, x / VISIBILITY_SUBDIV, y / VISIBILITY_SUBDIV))
+                continue;
+
+            set = &board_->visibility[(y / VISIBILITY_SUBDIV >> BLOCK_SHIFT) * board_->regionsW + (x / VISIBILITY_SUBDIV >> BLOCK_SHIFT)];
+            r   = VISIBILITY_RADIUS;
+
+            for (i = -r; i < r; i += VISIBILITY_SUBDIV)
+            {
+                visibilityRay(board_, set, x, y, x + i, y - r);
+                visibilityRay(board_, set, x, y, x + r, y + i);
+                visibilityRay(board_, set, x, y, x - i, y + r);
+                visibilityRay(board_, set, x, y, x - r, y - i);
+            }
+        }
+    }
+
+    for (i = 0; i < board_->regionsW * board_->regionsH; i++)
+    {
+        for (bits = board_->visibility[i]; bits; bits &= bits - 1)
+            visible++;
+    }
+
+    printf("buildVisibility(): %d regions, %.1f visible from each on average, %.1f ms\n", board_->regionsW * board_->regionsH,
+           (double)visible / (board_->regionsW * board_->regionsH),
+           (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+
+    return 0;
+}
+
+/*******************
+* Compiled map I/O *
+*******************/
+int compileMap(struct Board* board_, const char* filename)
+{
+    int i;
+    uint64_t all = ~0ull;
+    FILE* File = fopen(filename, "wb");
+    struct MapFileHeader Header =
+    {
+        .version      = MAP_FILE_VERSION,
+        .w            = board_->w,
+        .h            = board_->h,
+        .chunksW      = board_->chunksW,
+        .chunksH      = board_->chunksH,
+        .numObjects   = board_->numObjects,
+        .regionsW     = (board_->w + BLOCK_SIZE-1) >> BLOCK_SHIFT,
+        .regionsH     = (board_->h + BLOCK_SIZE-1) >> BLOCK_SHIFT,
+        .settingsSize = SETTINGS_SIZE
+    };
+
+    if (File == NULL)
+    {
+        printf("Error - compileMap() could not open %s\n", filename);
+
+        return 1;
+    }
+
+    memcpy(Header.magic, MAP_FILE_MAGIC, 4);
+    fwrite(&Header, sizeof(Header), 1, File);
+    fwrite((char*)board_ + SETTINGS_OFFSET, SETTINGS_SIZE, 1, File);
+    fwrite(board_->objects, sizeof(struct Object), board_->numObjects, File);
+
+    // one visible set per region; a map that couldn't have them gets ones that see everything
+    if (board_->visibility == NULL)
+        buildVisibility(board_);
+
+    for (i = 0; i < Header.regionsW * Header.regionsH; i++)
+        fwrite(board_->visibility ? &board_->visibility[i] : &all, sizeof(uint64_t), 1, File);
+
+    // every chunk is written, empty or not, so a chunk's offset is just its index * CHUNK_BYTES
+    for (i = 0; i < board_->numChunks; i++)
+    {
+        fwrite(board_->chunkTable[i]->tiles, sizeof(uint16_t), CHUNK_AREA, File);
+        fwrite(board_->chunkTable[i]->light, sizeof(uint8_t),  CHUNK_AREA, File);
+    }
+
+    fclose(File);
+    printf("compileMap(): wrote %d chunks to %s\n", board_->numChunks, filename);
+
+    return 0;
+}
+
+int isCompiledMap(const char* filename)
+{
+    char magic[4];
+    int found;
+    FILE* File = fopen(filename, "rb");
+
+    if (File == NULL)
+        return 0;
+
+    found = fread(magic, 1, 4, File) == 4 && memcmp(magic, MAP_FILE_MAGIC, 4) == 0;
+    fclose(File);
+
+    return found;
+}
+
+// The compiled map next to a text map: the same name with MAP_FILE_EXTENSION for its extension. Returns 1
+// when it exists and isn't older than the text map, so an edited map isn't shadowed by a stale compile.
+int findCompiledMap(const char* filename, char* compiled, int size)
+{
+    struct stat Text, Compiled;
+    const char* dot   = strrchr(filename, '.');
+    const char* slash = strrchr(filename, '/');
+    int length        = (dot && (!slash || dot > slash)) ? (int)(dot - filename) : (int)strlen(filename);
+
+    if (snprintf(compiled, size, "%.*s%s", length, filename, MAP_FILE_EXTENSION) >= size || !strcmp(compiled, filename))
+        return 0;
+
+    if (stat(compiled, &Compiled) || stat(filename, &Text))
+        return 0;
+
+    return Compiled.st_mtime >= Text.st_mtime;
+}
+
+static int readChunk(struct ChunkStreamer* streamer, struct Chunk* chunk)
+{
+    if (fseek(streamer->File, streamer->dataOffset + (long)chunk->index * CHUNK_BYTES, SEEK_SET))
+        return 1;
+
+    if (fread(chunk->tiles, sizeof(uint16_t), CHUNK_AREA, streamer->File) != CHUNK_AREA)
+        return 1;
+
+    if (fread(chunk->light, sizeof(uint8_t), CHUNK_AREA, streamer->File) != CHUNK_AREA)
+        return 1;
+
+    updateChunkBits(chunk);
+
+    return 0;
+}
+
+static int streamThread(void* data)
+{
+    struct ChunkStreamer* Streamer = data;
+    struct Chunk* chunk;
+    int index;
+
+    SDL_LockMutex(Streamer->Lock);
+
+    while (Streamer->running)
+    {
+        if (Streamer->numRequests == 0 || Streamer->numLoaded >= STREAM_QUEUE_SIZE || Streamer->numFailed >= STREAM_QUEUE_SIZE)
+        {
+            SDL_CondWait(Streamer->Wake, Streamer->Lock);
+            continue;
+        }
+
+        index = Streamer->requests[--Streamer->numRequests];
+        SDL_UnlockMutex(Streamer->Lock);
+
+        // the file is only ever touched by this thread, so the read happens unlocked
+        if ((chunk = newChunk(Streamer->Memory, index, 1)) == NULL)
+            printf("Error - streamThread() could not allocate chunk %d\n", index);
+        else if (readChunk(Streamer, chunk))
+        {
+            printf("Error - streamThread() failed to read chunk %d\n", index);
+            freeChunk(Streamer->Memory, chunk);
+            chunk = NULL;
+        }
+
+        SDL_LockMutex(Streamer->Lock);
+
+        if (chunk != NULL)
+            Streamer->loaded[Streamer->numLoaded++] = chunk;
+        else
+            Streamer->failed[Streamer->numFailed++] = index;
+    }
+
+    SDL_UnlockMutex(Streamer->Lock);
+
+    return 0;
+}
+
+struct Board* loadCompiledMap(const char* filename, struct Memory* memory)
+{
+    struct MapFileHeader Header;
+    struct Board* newBoard;
+    struct ChunkStreamer* Streamer;
+    size_t numRegions;
+    long dataOffset;
+    FILE* File = fopen(filename, "rb");
+
+    if (File == NULL)
+        return NULL;
+
+    if (fread(&Header, sizeof(Header), 1, File) != 1 || memcmp(Header.magic, MAP_FILE_MAGIC, 4)
+    ||  Header.version != MAP_FILE_VERSION || Header.settingsSize != SETTINGS_SIZE)
+    {
+        printf("Error - loadCompiledMap(): %s is not a version %d compiled map\n", filename, MAP_FILE_VERSION);
+        fclose(File);
+
+        return NULL;
+    }
+
+    // the header says how much to allocate and read, so nothing is until it adds up
+    if (Header.w <= 0 || Header.h <= 0 || Header.w > MAP_MAX_SIZE || Header.h > MAP_MAX_SIZE
+    ||  Header.chunksW != (Header.w + CHUNK_MASK) >> CHUNK_SHIFT || Header.chunksH != (Header.h + CHUNK_MASK) >> CHUNK_SHIFT
+    ||  Header.numObjects < 0 || Header.numObjects > MAP_MAX_OBJECTS)
+    {
+        printf("Error - loadCompiledMap(): %s has a bad header, %dx%d tiles with %d objects\n", filename, Header.w, Header.h, Header.numObjects);
+        fclose(File);
+
+        return NULL;
+    }
+
+    // regionSees() indexes the sets by tile, so they have to cover the map exactly
+    if (Header.regionsW != (Header.w + BLOCK_SIZE-1) >> BLOCK_SHIFT || Header.regionsH != (Header.h + BLOCK_SIZE-1) >> BLOCK_SHIFT)
+    {
+        printf("Error - loadCompiledMap(): %s has %dx%d visible sets for %dx%d tiles\n", filename, Header.regionsW, Header.regionsH, Header.w, Header.h);
+        fclose(File);
+
+        return NULL;
+    }
+
+    if ((newBoard = createBoard(memory)) == NULL)
+    {
+        printf("Error - loadCompiledMap(): could not allocate a board for %s\n", filename);
+        fclose(File);
+
+        return NULL;
+    }
+
+    numRegions           = (size_t)Header.regionsW * Header.regionsH;
+    newBoard->w          = Header.w;
+    newBoard->h          = Header.h;
+    newBoard->size       = Header.w * Header.h;
+    newBoard->numObjects = Header.numObjects;
+    newBoard->objects    = boardAlloc(newBoard, Header.numObjects * sizeof(struct Object));
+    newBoard->regionsW   = Header.regionsW;
+    newBoard->regionsH   = Header.regionsH;
+    newBoard->visibility = boardAlloc(newBoard, numRegions * sizeof(uint64_t));
+
+    // tileSize divides world positions, so a zero from a damaged file would fault the first frame
+    if ((Header.numObjects > 0 && newBoard->objects == NULL) || newBoard->visibility == NULL
+    ||  fread((char*)newBoard + SETTINGS_OFFSET, SETTINGS_SIZE, 1, File) != 1
+    ||  fread(newBoard->objects, sizeof(struct Object), Header.numObjects, File) != (size_t)Header.numObjects
+    ||  fread(newBoard->visibility, sizeof(uint64_t), numRegions, File) != numRegions
+    ||  newBoard->tileSize <= 0)
+    {
+        printf("Error - loadCompiledMap(): could not read %s, it's cut short or damaged\n", filename);
+        freeBoard(newBoard);
+        fclose(File);
+
+        return NULL;
+    }
+
+    if (allocChunks(newBoard, 0))
+    {
+        freeBoard(newBoard);
+        fclose(File);
+
+        return NULL;
+    }
+
+    // every chunk is stored, so any other length means the header and the data disagree
+    dataOffset = ftell(File);
+
+    if (fseek(File, 0, SEEK_END) || ftell(File) != dataOffset + (long)newBoard->numChunks * (long)CHUNK_BYTES)
+    {
+        printf("Error - loadCompiledMap(): %s doesn't hold the %d chunks its header says\n", filename, newBoard->numChunks);
+        freeBoard(newBoard);
+        fclose(File);
+
+        return NULL;
+    }
+
+    if ((Streamer = boardAlloc(newBoard, sizeof(struct ChunkStreamer))) == NULL
+    ||  (Streamer->resident = boardAlloc(newBoard, newBoard->numChunks * sizeof(int))) == NULL)
+    {
+        printf("Error - loadCompiledMap(): could not allocate the streamer for %s\n", filename);
+        boardFree(newBoard, Streamer);
+        freeBoard(newBoard);
+        fclose(File);
+
+        return NULL;
+    }
+
+    Streamer->Memory     = memory;
+    Streamer->File       = File;
+    Streamer->dataOffset = dataOffset;
+    Streamer->running    = 1;
+    Streamer->Lock       = SDL_CreateMutex();
+    Streamer->Wake       = SDL_CreateCond();
+
+    // the board only gets its streamer once the thread runs, so freeBoard() has nothing to stop before then
+    if (Streamer->Lock == NULL || Streamer->Wake == NULL
+    || (Streamer->Thread = SDL_CreateThread(streamThread, "ChunkStreamer", Streamer)) == NULL)
+    {
+        printf("Error - loadCompiledMap(): could not start streaming %s: %s\n", filename, SDL_GetError());
+        SDL_DestroyCond(Streamer->Wake);
+        SDL_DestroyMutex(Streamer->Lock);
+        boardFree(newBoard, Streamer->resident);
+        boardFree(newBoard, Streamer);
+        freeBoard(newBoard);
+        fclose(File);
+
+        return NULL;
+    }
+
+    newBoard->Streamer = Streamer;
+
+    printf("loadCompiledMap(): %s, %dx%d tiles in %dx%d chunks\n", filename, newBoard->w, newBoard->h, newBoard->chunksW, newBoard->chunksH);
+
+    return newBoard;
+}
+
+/************
+* Streaming *
+************/
+// Called once per tick with the camera position in world units, never while anything else reads the board.
+// Chunks are only ever installed into or removed from chunkTable here, so the renderer never races the loader.
+void streamChunks(struct Board* board_, int x, int y)
+{
+    struct ChunkStreamer* Streamer = board_->Streamer;
+    struct Chunk* chunk;
+    int i, cx, cy, camX, camY, radius, index;
+
+    if (Streamer == NULL)
+        return;
+
+    camX   = x / (board_->tileSize * CHUNK_SIZE);
+    camY   = y / (board_->tileSize * CHUNK_SIZE);
+    radius = board_->drawDistance / (board_->tileSize * CHUNK_SIZE) + 1;
+
+    SDL_LockMutex(Streamer->Lock);
+
+    // install finished chunks
+    while (Streamer->numLoaded > 0)
+    {
+        chunk = Streamer->loaded[--Streamer->numLoaded];
+        applyEdits(board_, chunk);
+        board_->chunkTable[chunk->index] = chunk;
+        board_->chunkState[chunk->index] = CHUNK_RESIDENT;
+        Streamer->resident[board_->numResident++] = chunk->index;
+    }
+
+    // a chunk that couldn't be read stays solid rather than pending for good
+    while (Streamer->numFailed > 0)
+        board_->chunkState[Streamer->failed[--Streamer->numFailed]] = CHUNK_FAILED;
+
+    // evict; only what's resident is looked at, so a map far bigger than memory costs no more than a small one
+    for (i = 0; i < board_->numResident; )
+    {
+        index = Streamer->resident[i];
+        cx    = index % board_->chunksW;
+        cy    = index / board_->chunksW;
+
+        if (abs(cx - camX) > radius + STREAM_EVICT_MARGIN || abs(cy - camY) > radius + STREAM_EVICT_MARGIN)
+        {
+            freeChunk(board_->Memory, board_->chunkTable[index]);
+            board_->chunkTable[index] = &SolidChunk;
+            board_->chunkState[index] = CHUNK_ABSENT;
+            Streamer->resident[i]     = Streamer->resident[--board_->numResident];
+        }
+        else
+            i++;
+    }
+
+    // request whatever is missing in the window around the camera
+    for (cy = SDL_max(camY - radius, 0); cy <= SDL_min(camY + radius, board_->chunksH - 1); cy++)
+    {
+        for (cx = SDL_max(camX - radius, 0); cx <= SDL_min(camX + radius, board_->chunksW - 1); cx++)
+        {
+            index = cy * board_->chunksW + cx;
+
+            if (board_->chunkState[index] == CHUNK_ABSENT && Streamer->numRequests < STREAM_QUEUE_SIZE)
+            {
+                Streamer->requests[Streamer->numRequests++] = index;
+                board_->chunkState[index] = CHUNK_PENDING;
+            }
+        }
+    }
+
+    if (Streamer->numRequests > 0)
+        SDL_CondSignal(Streamer->Wake);
+
+    SDL_UnlockMutex(Streamer->Lock);
+}
+
+void stopStreaming(struct Board* board_)
+{
+    struct ChunkStreamer* Streamer = board_->Streamer;
+
+    if (Streamer == NULL)
+        return;
+
+    SDL_LockMutex(Streamer->Lock);
+    Streamer->running = 0;
+    SDL_CondSignal(Streamer->Wake);
+    SDL_UnlockMutex(Streamer->Lock);
+    SDL_WaitThread(Streamer->Thread, NULL);
+
+    while (Streamer->numLoaded > 0)
+        freeChunk(Streamer->Memory, Streamer->loaded[--Streamer->numLoaded]);
+
+    fclose(Streamer->File);
+    SDL_DestroyCond(Streamer->Wake);
+    SDL_DestroyMutex(Streamer->Lock);
+    boardFree(board_, Streamer->resident);
+    boardFree(board_, Streamer);
+    board_->Streamer = NULL;
+}
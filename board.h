@@ -0,0 +1,281 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "memory.h"
+
+#define BUFFER_SIZE                     64
+
+// Chunks
+#define CHUNK_SHIFT                     5
+#define CHUNK_SIZE                      (1 << CHUNK_SHIFT)      // 32x32 tiles per chunk
+#define CHUNK_MASK                      (CHUNK_SIZE-1)
+#define CHUNK_AREA                      (CHUNK_SIZE*CHUNK_SIZE)
+#define CHUNK_BYTES                     (CHUNK_AREA * (sizeof(uint16_t) + sizeof(uint8_t)))
+#define BLOCK_SHIFT                     3
+#define BLOCK_SIZE                      (1 << BLOCK_SHIFT)      // 8x8 tiles per coarse occlusion block
+#define BLOCKS_PER_ROW                  (CHUNK_SIZE >> BLOCK_SHIFT)
+#define STREAM_QUEUE_SIZE               64
+#define STREAM_EVICT_MARGIN             1                       // chunks kept beyond the load radius, so we don't thrash on a chunk border
+#define MAX_TILE_CHANGES                256                     // per tick; past that, whatever listens rebuilds everything
+#define MAX_TILE_GRAPHICS               256
+#define PVS_RANGE                       3                       // regions (8x8 blocks) each way a visible set reaches,
+#define PVS_SPAN                        (2*PVS_RANGE+1)         // so one set is a 7x7 window of regions in a uint64_t
+#define HEIGHT_STEPS                    16                      // wall heights are in 1/16ths of a tile
+
+// Compiled map file
+#define MAP_FILE_MAGIC                  "BLMP"
+#define MAP_FILE_VERSION                3
+#define MAP_FILE_EXTENSION              ".blmp"     // next to the text map it was compiled from
+#define MAP_MAX_SIZE                    (1 << 15)   // tiles a side a compiled map may claim; keeps w*h in an int
+#define MAP_MAX_OBJECTS                 (1 << 16)
+
+enum TILE_TYPES
+{
+    TILE_OBSTACLE    = (1 << 0),
+    TILE_PARTIAL_OBS = (1 << 1),
+    TILE_OCCLUSION   = (1 << 2),
+    TILE_PARTIAL_OCC = (1 << 3),    // see-through: drawn as a wall, but rays and light carry on past it
+    TILE_LIQUID      = (1 << 4),
+    TILE_TOGGLE      = (1 << 5),    // a door: using it flips TILE_DOOR
+    TILE_BREAKABLE   = (1 << 6),    // a shot takes TILE_DOOR and this off for good
+    TILE_LIT         = (1 << 7),
+    TILE_FLAGS       = 8,
+    TILE_SOLID       = TILE_OBSTACLE | TILE_OCCLUSION,  // everything outside the map, and chunks that aren't loaded
+    TILE_DOOR        = TILE_OBSTACLE | TILE_OCCLUSION   // what opening a door or breaking a wall takes away
+};
+
+enum CHUNK_STATES
+{
+    CHUNK_ABSENT,
+    CHUNK_PENDING,
+    CHUNK_RESIDENT,
+    CHUNK_FAILED        // couldn't be read; stays SolidChunk and isn't asked for again
+};
+
+enum OBJECT_TYPES
+{
+    OBJECT_PLAYER,
+    OBJECT_LIGHT
+};
+
+struct Object
+{
+    char type;
+    int x, y;
+
+    union
+    {
+        struct {float angle;};
+        struct {int brightness, range;};
+    };
+};
+
+struct Chunk
+{
+    int             index;
+    uint16_t        tiles[CHUNK_AREA];  // row-major within the chunk, so a vertical ray only crosses 32 tiles worth of rows
+    uint8_t         light[CHUNK_AREA];
+    // derived from tiles; rebuilt by updateChunkBits() / updateTileBits(), never stored in compiled maps
+    uint32_t        occBits[CHUNK_SIZE];    // one word per row, bit x set if the tile has TILE_OCCLUSION
+    uint32_t        obsBits[CHUNK_SIZE];    // same for TILE_OBSTACLE
+    uint32_t        wallBits[CHUNK_SIZE];   // and for anything the renderer draws as a wall, TILE_OCCLUSION or TILE_PARTIAL_OCC
+    uint16_t        occBlocks;              // bit per 8x8 block, set if any tile in it occludes
+    uint16_t        obsBlocks;
+    uint16_t        wallBlocks;
+};
+
+// A tile set at runtime, for whatever is derived from tiles to catch up on
+struct TileChange
+{
+    int         x, y;
+    uint16_t    before, after;
+};
+
+// A tile as setTile() last left it, kept for as long as the board is
+struct TileEdit
+{
+    int         x, y;
+    uint16_t    tile;
+    uint32_t    serial;             // editSerial when it was last set
+    int         next;               // the next edit in the same chunk, -1 for none
+};
+
+struct ChunkStreamer
+{
+    SDL_Thread*     Thread;
+    SDL_mutex*      Lock;
+    SDL_cond*       Wake;
+    FILE*           File;
+    long            dataOffset;
+    int             running;
+    int             numRequests, numLoaded, numFailed;
+    int             requests[STREAM_QUEUE_SIZE];
+    struct Chunk*   loaded  [STREAM_QUEUE_SIZE];
+    int             failed  [STREAM_QUEUE_SIZE];
+    int*            resident;           // indices of the chunks in chunkTable, numResident of them
+    struct Memory*  Memory;
+};
+
+struct Board
+{
+    int             w, h, size, numObjects;
+    // settings block, written to compiled maps as-is; keep everything from lightEnable to wallBase plain data
+    int             lightEnable, wallTex, floorTex, ceilingTex, wallFog, floorFog, ceilingFog, backgroundTop, backgroundBottom;
+    int             fogDistance, drawDistance, backClipPlane;
+    int             tileSize, texSize, minLight, maxLight;
+    int             wallColor   [3];
+    int             floorColor  [3];
+    int             ceilingColor[3];
+    int             fogColor    [3];
+    char            textureFile [BUFFER_SIZE];
+    char            bgFile      [BUFFER_SIZE];
+    uint8_t         wallTop     [MAX_TILE_GRAPHICS];  // by tile graphic, in HEIGHT_STEPS; a wall spans base to top above the floor
+    uint8_t         wallBase    [MAX_TILE_GRAPHICS];
+    // chunk storage
+    int             chunksW, chunksH, numChunks, numResident;
+    struct Chunk**  chunkTable;         // never NULL; chunks that aren't loaded point to SolidChunk
+    uint8_t*        chunkState;
+    struct ChunkStreamer* Streamer;     // NULL when the whole map is resident
+    // potentially visible set, one per 8x8 region; NULL when there isn't one, and then everything is visible
+    int             regionsW, regionsH;
+    uint64_t*       visibility;
+    struct Object*  objects;
+    struct Memory*  Memory;             // level arena & chunk pool; NULL for boards that live on the heap, like hot reloads
+    // runtime edits since takeTileChanges() last ran
+    int             numChanges, changesLost;
+    struct TileChange changes[MAX_TILE_CHANGES];
+    // every tile setTile() has changed, so a streamed chunk read in again gets them back; on the heap, as they grow
+    struct TileEdit* edits;
+    int*            chunkEdits;         // the first edit of each chunk, -1 for none; NULL before the first edit
+    int             numEdits, maxEdits;
+    uint32_t        editSerial;         // counts every edit, so a copy of the board can ask for what changed since
+};
+
+extern struct Chunk SolidChunk;
+
+#define chunkAt(board,x,y)              board->chunkTable[((y) >> CHUNK_SHIFT) * board->chunksW + ((x) >> CHUNK_SHIFT)]
+#define chunkOffset(x,y)                ((((y) & CHUNK_MASK) << CHUNK_SHIFT) | ((x) & CHUNK_MASK))
+#define tileAt(board,x,y)               chunkAt(board,(x),(y))->tiles[chunkOffset((x),(y))]
+#define lightAt(board,x,y)              chunkAt(board,(x),(y))->light[chunkOffset((x),(y))]
+#define writeTile(board,x,y,tile)       (tileAt(board,(x),(y)) = (tile), updateTileBits(board,(x),(y)))    // for loaders, which derive the rest in bulk
+#define blockBit(x,y)                   (((((y) & CHUNK_MASK) >> BLOCK_SHIFT) * BLOCKS_PER_ROW) + (((x) & CHUNK_MASK) >> BLOCK_SHIFT))
+#define occludesAt(board,x,y)           ((chunkAt(board,(x),(y))->occBits[(y) & CHUNK_MASK] >> ((x) & CHUNK_MASK)) & 1)
+#define wallAt(board,x,y)               ((chunkAt(board,(x),(y))->wallBits[(y) & CHUNK_MASK] >> ((x) & CHUNK_MASK)) & 1)
+#define obstructsAt(board,x,y)          ((chunkAt(board,(x),(y))->obsBits[(y) & CHUNK_MASK] >> ((x) & CHUNK_MASK)) & 1)
+#define inBoard(board,x,y)              ((unsigned)(x) < (unsigned)board->w && (unsigned)(y) < (unsigned)board->h)
+
+static inline uint16_t tileAtSafe(struct Board* board_, int x, int y)
+{
+    return inBoard(board_, x, y) ? tileAt(board_, x, y) : TILE_SOLID;
+}
+
+// x, y in world units; rays may wander off the map, so these are bounds checked
+static inline uint16_t tileAtPos(struct Board* board_, int x, int y)
+{
+    return (x < 0 || y < 0) ? TILE_SOLID : tileAtSafe(board_, x/board_->tileSize, y/board_->tileSize);
+}
+
+static inline int occludesAtSafe(struct Board* board_, int x, int y)
+{
+    return inBoard(board_, x, y) ? occludesAt(board_, x, y) : 1;
+}
+
+static inline int occludesAtPos(struct Board* board_, int x, int y)
+{
+    return (x < 0 || y < 0) ? 1 : occludesAtSafe(board_, x/board_->tileSize, y/board_->tileSize);
+}
+
+// Anything drawn as a wall, see-through or not
+static inline int wallAtPos(struct Board* board_, int x, int y)
+{
+    x = (x < 0) ? -1 : x/board_->tileSize;
+    y = (y < 0) ? -1 : y/board_->tileSize;
+
+    return inBoard(board_, x, y) ? wallAt(board_, x, y) : 1;
+}
+
+// How many whole steps of (dx, dy) a ray at (x, y) can take without leaving its 8x8 block,
+// if that block holds no tile with the given flag (TILE_OCCLUSION, TILE_PARTIAL_OCC for any wall, or TILE_OBSTACLE).
+// 0 if it can't skip.
+static inline int emptyBlockSteps(struct Board* board_, float x, float y, float dx, float dy, int flag)
+{
+    const int blockSize = board_->tileSize * BLOCK_SIZE;
+    int tx, ty, blocks;
+    float left, top, stepsX, stepsY;
+
+    if (x < 0 || y < 0)
+        return 0;
+
+    tx = (int)x / board_->tileSize;
+    ty = (int)y / board_->tileSize;
+
+    if (!inBoard(board_, tx, ty))
+        return 0;
+
+    blocks = (flag & TILE_PARTIAL_OCC) ? chunkAt(board_, tx, ty)->wallBlocks
+           : (flag & TILE_OCCLUSION)   ? chunkAt(board_, tx, ty)->occBlocks : chunkAt(board_, tx, ty)->obsBlocks;
+
+    if ((blocks >> blockBit(tx, ty)) & 1)
+        return 0;
+
+    left   = (tx & ~(BLOCK_SIZE-1)) * board_->tileSize;
+    top    = (ty & ~(BLOCK_SIZE-1)) * board_->tileSize;
+    stepsX = (dx > 0) ? (left + blockSize - x) / dx : (dx < 0) ? (left - x) / dx : 1e9;
+    stepsY = (dy > 0) ? (top  + blockSize - y) / dy : (dy < 0) ? (top  - y) / dy : 1e9;
+
+    // stop one step short, so the block boundary itself is always tested by the caller
+    blocks = (int)((stepsX < stepsY) ? stepsX : stepsY);
+
+    return (blocks > 1) ? blocks - 1 : 0;
+}
+
+// Whether anything in tile (bx, by)'s region can be seen from anywhere in tile (ax, ay)'s. Doors and breakable
+// walls count as open. Regions past PVS_RANGE never can, so it's only good for views shorter than pvsReach().
+static inline int regionSees(struct Board* board_, int ax, int ay, int bx, int by)
+{
+    int dx = (bx >> BLOCK_SHIFT) - (ax >> BLOCK_SHIFT) + PVS_RANGE;
+    int dy = (by >> BLOCK_SHIFT) - (ay >> BLOCK_SHIFT) + PVS_RANGE;
+
+    if (board_->visibility == NULL || !inBoard(board_, ax, ay))
+        return 1;
+
+    if ((unsigned)dx >= PVS_SPAN || (unsigned)dy >= PVS_SPAN)
+        return 0;
+
+    return (board_->visibility[(ay >> BLOCK_SHIFT) * board_->regionsW + (ax >> BLOCK_SHIFT)] >> (dy * PVS_SPAN + dx)) & 1;
+}
+
+#define pvsReach(board)                 (PVS_RANGE * BLOCK_SIZE * board->tileSize)    // world units; nearer than this, a region out of the set can't be seen
+
+static inline uint8_t lightAtPos(struct Board* board_, int x, int y)
+{
+    x /= board_->tileSize;
+    y /= board_->tileSize;
+
+    return inBoard(board_, x, y) ? lightAt(board_, x, y) : 0;
+}
+
+struct Board* createBoard(struct Memory* memory);
+void* boardAlloc        (struct Board* board_, size_t size);
+void boardFree          (struct Board* board_, void* pointer);
+int  allocChunks        (struct Board* board_, int resident);
+void freeChunks         (struct Board* board_);
+void freeBoard          (struct Board* board_);
+int  sameSettings       (struct Board* a, struct Board* b);
+void copySettings       (struct Board* dst, struct Board* src);
+void updateChunkBits    (struct Chunk* chunk);
+void updateTileBits     (struct Board* board_, int x, int y);
+int  setTile            (struct Board* board_, int x, int y, uint16_t tile);
+int  takeTileChanges    (struct Board* board_, struct TileChange* changes, int* lost);
+int  buildVisibility    (struct Board* board_);
+int  compileMap         (struct Board* board_, const char* filename);
+struct Board* loadCompiledMap(const char* filename, struct Memory* memory);
+int  isCompiledMap      (const char* filename);
+int  findCompiledMap    (const char* filename, char* compiled, int size);
+void streamChunks       (struct Board* board_, int x, int y);
+void stopStreaming      (struct Board* board_);
+
+#endif
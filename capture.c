@@ -0,0 +1,414 @@
+#include "capture.h"
+#include <SDL2/SDL_image.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int fileExists(const char* filename)
+{
+    FILE* file = fopen(filename, "rb");
+
+    if (file == NULL)
+        return 0;
+
+    fclose(file);
+
+    return 1;
+}
+
+// BT.601 limited range, one sample of each plane per pixel
+static void writeY4MFrame(FILE* file, uint8_t* planes, const uint32_t* pixels, int w, int h)
+{
+    const int size = w * h;
+    uint8_t* Y = planes;
+    uint8_t* U = planes + size;
+    uint8_t* V = planes + size*2;
+    int i, r, g, b;
+
+    for (i = 0; i < size; i++)
+    {
+        r = pixels[i] >> 16 & 0xFF;
+        g = pixels[i] >> 8  & 0xFF;
+        b = pixels[i]       & 0xFF;
+
+        Y[i] = (( 66*r + 129*g +  25*b + 128) >> 8) + 16;
+        U[i] = ((-38*r -  74*g + 112*b + 128) >> 8) + 128;
+        V[i] = ((112*r -  94*g -  18*b + 128) >> 8) + 128;
+    }
+
+    fputs("FRAME\n", file);
+    fwrite(planes, 1, (size_t)size * 3, file);
+}
+
+static void openSequence(struct Capture* capture, struct CaptureFrame* Frame)
+{
+    char filename[CAPTURE_PATH_SIZE];
+
+    if (capture->Video != NULL)
+        fclose(capture->Video);
+
+    capture->Video = NULL;
+
+    // skip numbers already on disk so an earlier run's captures are kept
+    do
+    {
+        snprintf(capture->sequenceName, CAPTURE_PATH_SIZE, "%s_seq%03d", capture->prefix, capture->nextSequence++);
+        snprintf(filename, CAPTURE_PATH_SIZE, Frame->format == CAPTURE_Y4M ? "%s.y4m" : "%s_00000.png", capture->sequenceName);
+    }
+    while (fileExists(filename));
+
+    capture->openSequence = Frame->sequence;
+
+    if (Frame->format == CAPTURE_Y4M)
+    {
+        if ((capture->Video = fopen(filename, "wb")) == NULL)
+        {
+            printf("Error - openSequence() could not create %s\n", filename);
+
+            return;
+        }
+
+        fprintf(capture->Video, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", Frame->w, Frame->h, CAPTURE_Y4M_FPS);
+    }
+
+    printf("openSequence(): recording to %s\n", filename);
+}
+
+static void encodeFrame(struct Capture* capture, struct CaptureFrame* Frame)
+{
+    char filename[CAPTURE_PATH_SIZE];
+
+    if (Frame->screenshot)
+    {
+        do
+            snprintf(filename, CAPTURE_PATH_SIZE, "%s_%04d.png", capture->prefix, capture->nextShot++);
+        while (fileExists(filename));
+
+        if (savePNG(Frame->pixels, Frame->w, Frame->h, filename) == 0)
+            printf("encodeFrame(): saved %s\n", filename);
+    }
+
+    if (Frame->sequence < 0)
+        return;
+
+    if (Frame->sequence != capture->openSequence)
+        openSequence(capture, Frame);
+
+    if (Frame->format == CAPTURE_Y4M)
+    {
+        if (capture->Video != NULL)
+            writeY4MFrame(capture->Video, capture->planes, Frame->pixels, Frame->w, Frame->h);
+    }
+    else
+    {
+        snprintf(filename, CAPTURE_PATH_SIZE, "%.*s_%05d.png", CAPTURE_PATH_SIZE - 16, capture->sequenceName, Frame->index);
+        savePNG(Frame->pixels, Frame->w, Frame->h, filename);
+    }
+}
+
+// A frame stays in the ring while it's encoded, so the frame loop can't hand out its buffer again
+static int captureThread(void* data)
+{
+    struct Capture* Capture = data;
+    struct CaptureFrame* Frame;
+
+    SDL_LockMutex(Capture->Lock);
+
+    while (Capture->running || Capture->count > 0)
+    {
+        if (Capture->count == 0)
+        {
+            SDL_CondWait(Capture->Changed, Capture->Lock);
+            continue;
+        }
+
+        Frame = &Capture->Frames[Capture->head];
+        SDL_UnlockMutex(Capture->Lock);
+
+        encodeFrame(Capture, Frame);
+
+        SDL_LockMutex(Capture->Lock);
+        Capture->head = (Capture->head + 1) % CAPTURE_RING;
+        Capture->count--;
+        SDL_CondBroadcast(Capture->Changed);
+    }
+
+    SDL_UnlockMutex(Capture->Lock);
+
+    return 0;
+}
+
+static void drainCapture(struct Capture* capture)
+{
+    SDL_LockMutex(capture->Lock);
+
+    while (capture->count > 0)
+        SDL_CondWait(capture->Changed, capture->Lock);
+
+    SDL_UnlockMutex(capture->Lock);
+}
+
+static void closeSequence(struct Capture* capture)
+{
+    if (capture->Video != NULL)
+        fclose(capture->Video);
+
+    capture->Video        = NULL;
+    capture->openSequence = -1;
+}
+
+int initCapture(struct Capture* capture, int w, int h)
+{
+    printf("initCapture()\n");
+
+    memset(capture, 0, sizeof(struct Capture));
+    strcpy(capture->prefix, "capture");
+    capture->openSequence = -1;
+    capture->Lock         = SDL_CreateMutex();
+    capture->Changed      = SDL_CreateCond();
+    capture->running      = 1;
+    capture->Thread       = SDL_CreateThread(captureThread, "Capture", capture);
+
+    if (capture->Thread == NULL)
+    {
+        printf("Error - initCapture() could not start the encoder\n");
+
+        return 1;
+    }
+
+    return resizeCapture(capture, w, h);
+}
+
+// Waits for the encoder to finish what it has, as it reads the buffers being replaced
+int resizeCapture(struct Capture* capture, int w, int h)
+{
+    int i, failed;
+
+    if (capture->Thread == NULL)
+        return 1;
+
+    if (w * h <= capture->capacity)
+        return 0;
+
+    drainCapture(capture);
+
+    free(capture->planes);
+    capture->capacity = 0;
+    capture->planes   = malloc((size_t)w * h * 3);
+    failed            = capture->planes == NULL;
+
+    for (i = 0; i < CAPTURE_RING; i++)
+    {
+        free(capture->Frames[i].pixels);
+        capture->Frames[i].pixels = malloc((size_t)w * h * sizeof(uint32_t));
+        failed |= capture->Frames[i].pixels == NULL;
+    }
+
+    if (failed)
+    {
+        printf("Error - resizeCapture() failed to allocate %dx%d\n", w, h);
+
+        return 1;
+    }
+
+    capture->capacity = w * h;
+
+    return 0;
+}
+
+void killCapture(struct Capture* capture)
+{
+    int i;
+
+    if (capture->Thread == NULL)
+        return;
+
+    if (capture->recording)
+        stopCaptureSequence(capture);
+
+    SDL_LockMutex(capture->Lock);
+    capture->running = 0;
+    SDL_CondBroadcast(capture->Changed);
+    SDL_UnlockMutex(capture->Lock);
+
+    SDL_WaitThread(capture->Thread, NULL);
+    closeSequence(capture);
+    SDL_DestroyCond(capture->Changed);
+    SDL_DestroyMutex(capture->Lock);
+
+    for (i = 0; i < CAPTURE_RING; i++)
+        free(capture->Frames[i].pixels);
+
+    free(capture->planes);
+    capture->Thread = NULL;
+}
+
+// A buffer to copy this frame into when a screenshot is wanted or a sequence is recording, or NULL.
+// With every buffer still waiting on the encoder the frame is dropped rather than stalling the game.
+// Nothing is taken until submitCaptureFrame(), so a frame that couldn't be copied is just not submitted.
+uint32_t* acquireCaptureFrame(struct Capture* capture, int w, int h, int screenshot)
+{
+    struct CaptureFrame* Frame;
+    int sequence = capture->recording;
+
+    if (capture->Thread == NULL || (!screenshot && !sequence) || w * h > capture->capacity)
+        return NULL;
+
+    // a Y4M stream can't change size part way through
+    if (sequence && capture->sequenceFormat == CAPTURE_Y4M && capture->frames > 0 && (w != capture->sequenceW || h != capture->sequenceH))
+    {
+        capture->dropped++;
+        sequence = 0;
+    }
+
+    if (!screenshot && !sequence)
+        return NULL;
+
+    SDL_LockMutex(capture->Lock);
+
+    if (capture->count == CAPTURE_RING)
+    {
+        SDL_UnlockMutex(capture->Lock);
+        capture->dropped += sequence;
+
+        return NULL;
+    }
+
+    Frame = &capture->Frames[(capture->head + capture->count) % CAPTURE_RING];
+    SDL_UnlockMutex(capture->Lock);
+
+    Frame->w          = w;
+    Frame->h          = h;
+    Frame->screenshot = screenshot;
+    Frame->sequence   = sequence ? capture->sequence : -1;
+    Frame->index      = capture->frames;
+    Frame->format     = capture->sequenceFormat;
+
+    return Frame->pixels;
+}
+
+// Hands the frame acquireCaptureFrame() gave out to the encoder
+void submitCaptureFrame(struct Capture* capture)
+{
+    struct CaptureFrame* Frame = &capture->Frames[(capture->head + capture->count) % CAPTURE_RING];
+
+    if (Frame->sequence >= 0)
+    {
+        if (capture->frames++ == 0)
+        {
+            capture->sequenceW = Frame->w;
+            capture->sequenceH = Frame->h;
+        }
+    }
+
+    SDL_LockMutex(capture->Lock);
+    capture->count++;
+    SDL_CondBroadcast(capture->Changed);
+    SDL_UnlockMutex(capture->Lock);
+}
+
+// The encoder reads the prefix while it has frames, so a new one waits until it's idle
+void setCaptureOptions(struct Capture* capture, const char* prefix, int format)
+{
+    capture->format = format;
+
+    if (capture->Thread == NULL || !strcmp(capture->prefix, prefix))
+        return;
+
+    SDL_LockMutex(capture->Lock);
+
+    if (capture->count == 0)
+    {
+        strncpy(capture->prefix, prefix, CAPTURE_NAME_SIZE-1);
+        capture->prefix[CAPTURE_NAME_SIZE-1] = '\0';
+    }
+
+    SDL_UnlockMutex(capture->Lock);
+}
+
+void startCaptureSequence(struct Capture* capture)
+{
+    if (capture->Thread == NULL || capture->recording)
+        return;
+
+    capture->recording      = 1;
+    capture->sequence++;
+    capture->sequenceFormat = capture->format;
+    capture->frames         = 0;
+    capture->dropped        = 0;
+
+    printf("startCaptureSequence(): sequence %d\n", capture->sequence);
+}
+
+void stopCaptureSequence(struct Capture* capture)
+{
+    if (!capture->recording)
+        return;
+
+    capture->recording = 0;
+    drainCapture(capture);
+    closeSequence(capture);
+
+    printf("stopCaptureSequence(): %d frames, %d dropped\n", capture->frames, capture->dropped);
+}
+
+int savePNG(const uint32_t* pixels, int w, int h, const char* filename)
+{
+    SDL_Surface* Surface = SDL_CreateRGBSurfaceWithFormatFrom((void*)pixels, w, h, 32, w * sizeof(uint32_t), SDL_PIXELFORMAT_ARGB8888);
+    int result;
+
+    if (Surface == NULL)
+    {
+        printf("Error - savePNG() failed to wrap %dx%d for %s\n", w, h, filename);
+
+        return 1;
+    }
+
+    if ((result = IMG_SavePNG(Surface, filename)) != 0)
+        printf("Error - savePNG() could not write %s\n", filename);
+
+    SDL_FreeSurface(Surface);
+
+    return result != 0;
+}
+
+// Counts the pixels where any channel differs from the reference by more than CAPTURE_MATCH, so the
+// rounding of a different compiler or CPU doesn't fail the comparison. The reference must be ARGB8888.
+int compareImage(const uint32_t* pixels, int w, int h, SDL_Surface* reference, int* mismatched, int* maxDifference)
+{
+    uint32_t a, b;
+    int x, y, shift, difference, worst;
+
+    *mismatched    = 0;
+    *maxDifference = 0;
+
+    if (reference == NULL || reference->format->format != SDL_PIXELFORMAT_ARGB8888 || reference->w != w || reference->h != h)
+    {
+        printf("Error - compareImage() needs a %dx%d ARGB8888 reference\n", w, h);
+
+        return 1;
+    }
+
+    for (y = 0; y < h; y++)
+    {
+        for (x = 0; x < w; x++)
+        {
+            a     = pixels[y * w + x];
+            b     = ((uint32_t*)((uint8_t*)reference->pixels + y * reference->pitch))[x];
+            worst = 0;
+
+            for (shift = 0; shift < 24; shift += 8)
+            {
+                difference = abs((int)(a >> shift & 0xFF) - (int)(b >> shift & 0xFF));
+                worst      = SDL_max(worst, difference);
+            }
+
+            *maxDifference = SDL_max(*maxDifference, worst);
+
+            if (worst > CAPTURE_MATCH)
+                (*mismatched)++;
+        }
+    }
+
+    return 0;
+}
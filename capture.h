@@ -0,0 +1,65 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <SDL2/SDL.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define CAPTURE_RING        4       // frames waiting for the encoder; one that finds them all taken is dropped
+#define CAPTURE_NAME_SIZE   64
+#define CAPTURE_PATH_SIZE   128
+#define CAPTURE_Y4M_FPS     60      // nominal, frames are captured as they're drawn
+#define CAPTURE_MATCH       8       // per channel difference a pixel may have and still match a reference
+
+enum CaptureFormats
+{
+    CAPTURE_PNG,
+    CAPTURE_Y4M
+};
+
+struct CaptureFrame
+{
+    uint32_t*   pixels;             // ARGB8888, w x h packed
+    int         w, h;
+    int         screenshot;
+    int         sequence;           // number of the sequence it belongs to, -1 for none
+    int         index;              // within the sequence
+    int         format;             // the sequence's
+};
+
+// Frames are copied into a ring of buffers allocated up front and encoded on a thread of their own, so the
+// frame loop only pays for the copy. A screenshot is a PNG; a sequence is a numbered PNG per frame, or one
+// Y4M stream, 4:4:4 so the pixel art keeps its color edges, that keeps the size of its first frame.
+struct Capture
+{
+    char                prefix[CAPTURE_NAME_SIZE];
+    int                 format;             // for the next sequence
+    int                 capacity;           // pixels in each buffer
+    struct CaptureFrame Frames[CAPTURE_RING];
+    int                 head, count;        // oldest waiting frame, and how many
+    volatile int        running;
+    SDL_Thread*         Thread;
+    SDL_mutex*          Lock;
+    SDL_cond*           Changed;
+    // the frame loop's side
+    int                 recording, sequence, frames, dropped;
+    int                 sequenceFormat, sequenceW, sequenceH;
+    // the encoder's side
+    int                 nextShot, nextSequence, openSequence;
+    char                sequenceName[CAPTURE_PATH_SIZE];
+    FILE*               Video;
+    uint8_t*            planes;             // Y, U and V of one Y4M frame
+};
+
+int       initCapture         (struct Capture* capture, int w, int h);
+void      killCapture         (struct Capture* capture);
+int       resizeCapture       (struct Capture* capture, int w, int h);
+uint32_t* acquireCaptureFrame (struct Capture* capture, int w, int h, int screenshot);
+void      submitCaptureFrame  (struct Capture* capture);
+void      setCaptureOptions   (struct Capture* capture, const char* prefix, int format);
+void      startCaptureSequence(struct Capture* capture);
+void      stopCaptureSequence (struct Capture* capture);
+int       savePNG             (const uint32_t* pixels, int w, int h, const char* filename);
+int       compareImage        (const uint32_t* pixels, int w, int h, SDL_Surface* reference, int* mismatched, int* maxDifference);
+
+#endif
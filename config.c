@@ -1,20 +1,343 @@
 #include "config.h"
 #include <SDL2/SDL_video.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <ctype.h>
+#include "jobs.h"
+#include "net.h"
 
-int loadConfig(struct Config* config, char* filename)
+#define SETTING(name, type, field, min, max, changes, help) {name, type, offsetof(struct Config, field), changes, help, min, max}
+
+static const struct Setting Settings[] =
 {
-    printf("loadConfig()\n");
-    // Try to load configuration from file here; success returns; failure sets default values below
+    SETTING("title",              SETTING_STRING, title,              0,   0,               CHANGE_RESTART,                "window title"),
+    SETTING("font",               SETTING_STRING, font,               0,   0,               CHANGE_FONT,                   "bitmap font file"),
+    SETTING("windowwidth",        SETTING_INT,    windowWidth,        64,  8192,            CHANGE_WINDOW | CHANGE_SCREEN, "logical window width"),
+    SETTING("windowheight",       SETTING_INT,    windowHeight,       64,  8192,            CHANGE_WINDOW | CHANGE_SCREEN, "logical window height"),
+    SETTING("screenwidth",        SETTING_INT,    screenWidth,        64,  4096,            CHANGE_WINDOW,                 "viewport width for the menus and the game view"),
+    SETTING("screenheight",       SETTING_INT,    screenHeight,       64,  4096,            CHANGE_WINDOW,                 "viewport height for the menus and the game view"),
+    SETTING("resscale",           SETTING_INT,    resScale,           1,   8,               CHANGE_WINDOW,                 "window pixels per logical pixel"),
+    SETTING("fullscreen",         SETTING_INT,    fullscreen,         0,   1,               CHANGE_RESTART,                "0 or 1"),
+    SETTING("borderless",         SETTING_INT,    borderless,         0,   1,               CHANGE_RESTART,                "0 or 1"),
+    SETTING("floorenable",        SETTING_INT,    floorEnable,        0,   1,               CHANGE_RENDER,                 "textured floor casting, 0 draws a flat floor"),
+    SETTING("fov",                SETTING_FLOAT,  fov,                0.1, 4,               CHANGE_RENDER,                 "camera plane length, 1.0 is 90 degrees"),
+    SETTING("drawdistance",       SETTING_INT,    drawDistance,       16,  65536,           CHANGE_RENDER,                 "upper limit for the map's draw distance, world units"),
+    SETTING("dynres",             SETTING_INT,    dynamicRes,         0,   1,               CHANGE_RENDER,                 "scale the 3D render resolution to stay within framebudget"),
+    SETTING("framebudget",        SETTING_FLOAT,  frameBudget,        0.5, 1000,            CHANGE_RENDER,                 "ms per frame for the 3D view when dynres is on"),
+    SETTING("views",              SETTING_INT,    views,              1,   4,               CHANGE_RENDER,                 "split the game view between this many cameras, 1 to 4"),
+    SETTING("palette",            SETTING_INT,    palette,            0,   1,               CHANGE_RENDER,                 "8-bit palettised 3D view, shaded through colormaps"),
+    SETTING("minimap",            SETTING_INT,    minimap,            0,   1,               CHANGE_RENDER,                 "draw the 2D map in a corner of the game view"),
+    SETTING("map",                SETTING_STRING, map,                0,   0,               CHANGE_RESTART,                "map file, text or compiled"),
+    SETTING("hotreload",          SETTING_INT,    hotReload,          0,   1,               CHANGE_RESTART,                "watch the map and textures for changes"),
+    SETTING("compile",            SETTING_STRING, compile,            0,   0,               CHANGE_RESTART,                "compile this text map, lit, to a .blmp next to it and quit; maps with an up to date one are streamed from it"),
+    SETTING("record",             SETTING_STRING, record,             0,   0,               CHANGE_RESTART,                "record the game's input to this file, saved when the game ends"),
+    SETTING("replay",             SETTING_STRING, replay,             0,   0,               CHANGE_RESTART,                "play this recording instead of taking input"),
+    SETTING("headless",           SETTING_INT,    headless,           0,   1,               CHANGE_RESTART,                "play the replay through without a window, then quit"),
+    SETTING("reference",          SETTING_STRING, reference,          0,   0,               CHANGE_RESTART,                "headless: compare the last frame with this image, written first if it doesn't exist"),
+    SETTING("referencetolerance", SETTING_FLOAT,  referenceTolerance, 0,   100,             CHANGE_RESTART,                "headless: percent of pixels that may differ from the reference"),
+    SETTING("rewindmb",           SETTING_INT,    rewindMB,           0,   1024,            CHANGE_RESTART,                "memory for the rewind history (hold backspace), 0 turns it off"),
+    SETTING("captureprefix",      SETTING_STRING, capturePrefix,      0,   0,               CHANGE_RENDER,                 "file name start for screenshots (F12) and recorded sequences (F11)"),
+    SETTING("captureformat",      SETTING_STRING, captureFormat,      0,   0,               CHANGE_RENDER,                 "sequences as numbered png files or one y4m video"),
+    SETTING("workers",            SETTING_INT,    workers,            -1,  MAX_WORKERS,     CHANGE_RESTART,                "threads running game systems besides the main one, -1 is one per core"),
+    SETTING("server",             SETTING_INT,    server,             0,   65535,           CHANGE_RESTART,                "run a dedicated server on this UDP port instead of the game, 0 is off"),
+    SETTING("connect",            SETTING_STRING, connect,            0,   0,               CHANGE_RESTART,                "host:port of a server to play on"),
+    SETTING("bots",               SETTING_INT,    bots,               0,   NET_MAX_CLIENTS, CHANGE_RESTART,                "clients the server runs itself, pressing random keys"),
+    SETTING("serverseconds",      SETTING_INT,    serverSeconds,      0,   31536000,        CHANGE_RESTART,                "stop the server and print its numbers after this long, 0 runs for good")
+};
+
+#define NUM_SETTINGS ((int)(sizeof(Settings) / sizeof(Settings[0])))
+
+static void setDefaults(struct Config* config)
+{
+    memset(config, 0, sizeof(struct Config));
 
-    config->title        = "Blasterline";
-    config->font         = "font.bmp";
+    strcpy(config->title, "Blasterline");
+    strcpy(config->font,  "font.bmp");
+    strcpy(config->map,   "map2.txt");
     config->windowWidth  = 320;
     config->windowHeight = 240;
     config->screenWidth  = 256;
     config->screenHeight = 224;
-    config->windowFlags  = SDL_WINDOW_SHOWN;// | SDL_WINDOW_BORDERLESS;// | SDL_WINDOW_FULLSCREEN;
     config->resScale     = 2;
+    config->fullscreen   = 0;
+    config->borderless   = 0;
+    config->floorEnable  = 1;
+    config->fov          = 1.0;
+    config->drawDistance = 16 * 20;   // 20 tiles
+    config->dynamicRes   = 0;
+    config->frameBudget  = 8.0;
+    config->views        = 1;
+    config->palette      = 0;
+    config->hotReload    = 1;
+    config->minimap      = 1;
+    config->workers      = -1;
+    config->rewindMB     = 16;
+    strcpy(config->capturePrefix, "capture");
+    strcpy(config->captureFormat, "png");
+    config->referenceTolerance = 0.5;
+}
+
+static void updateWindowFlags(struct Config* config)
+{
+    config->windowFlags = SDL_WINDOW_SHOWN
+                        | (config->borderless ? SDL_WINDOW_BORDERLESS : 0)
+                        | (config->fullscreen ? SDL_WINDOW_FULLSCREEN : 0);
+}
+
+static const struct Setting* findSetting(const char* key)
+{
+    int i;
+
+    for (i = 0; i < NUM_SETTINGS; i++)
+    {
+        if (!strcmp(Settings[i].name, key))
+            return &Settings[i];
+    }
+
+    return NULL;
+}
+
+static char* trim(char* s)
+{
+    char* end;
+
+    while (isspace((unsigned char)*s))
+        s++;
+
+    end = s + strlen(s);
+
+    while (end > s && isspace((unsigned char)end[-1]))
+        *--end = '\0';
+
+    return s;
+}
+
+static int outOfRange(const struct Setting* setting, double value)
+{
+    if (setting->min == setting->max || (value >= setting->min && value <= setting->max))
+        return 0;
+
+    printf("Error - setConfigValue(): %s must be %g to %g\n", setting->name, setting->min, setting->max);
+
+    return 1;
+}
+
+// Returns the setting's CHANGE_* flags if the value changed, 0 if it didn't, -1 for an unknown key or bad value
+int setConfigValue(struct Config* config, const char* key, const char* value)
+{
+    const struct Setting* Setting = findSetting(key);
+    char* field;
+    char* end;
+    long intValue;
+    float floatValue;
+
+    if (Setting == NULL)
+        return -1;
+
+    field = (char*)config + Setting->offset;
+
+    switch (Setting->type)
+    {
+    case SETTING_INT:
+        intValue = strtol(value, &end, 0);
+
+        if (end == value || outOfRange(Setting, intValue))
+            return -1;
+        if (*(int*)field == intValue)
+            return 0;
+
+        *(int*)field = intValue;
+        break;
+    case SETTING_FLOAT:
+        floatValue = strtof(value, &end);
+
+        if (end == value || outOfRange(Setting, floatValue))
+            return -1;
+        if (*(float*)field == floatValue)
+            return 0;
+
+        *(float*)field = floatValue;
+        break;
+    case SETTING_STRING:
+        if (!strcmp(field, value))
+            return 0;
+
+        strncpy(field, value, CONFIG_STRING_SIZE-1);
+        field[CONFIG_STRING_SIZE-1] = '\0';
+        break;
+    default:
+        return -1;
+    }
+
+    updateWindowFlags(config);
+    config->changes |= Setting->changes;
+
+    return Setting->changes;
+}
+
+int getConfigValue(struct Config* config, const char* key, char* buffer, int size)
+{
+    const struct Setting* Setting = findSetting(key);
+    char* field;
+
+    if (Setting == NULL)
+        return 1;
+
+    field = (char*)config + Setting->offset;
+
+    switch (Setting->type)
+    {
+    case SETTING_INT:    snprintf(buffer, size, "%d", *(int*)field);    break;
+    case SETTING_FLOAT:  snprintf(buffer, size, "%g", *(float*)field);  break;
+    case SETTING_STRING: snprintf(buffer, size, "%s", field);           break;
+    }
+
+    return 0;
+}
+
+// "key value" or "key = value"; returns 1 if the line held a setting that didn't parse
+static int parseLine(struct Config* config, char* line)
+{
+    char* key;
+    char* value;
+    char* c;
+
+    if ((c = strchr(line, '#')) != NULL)
+        *c = '\0';
+
+    key = trim(line);
+
+    if (*key == '\0')
+        return 0;
+
+    for (c = key; *c != '\0' && !isspace((unsigned char)*c) && *c != '='; c++)
+        ;
+
+    value = c;
+
+    if (*value != '\0')
+        *value++ = '\0';
+
+    value = trim(value);
+
+    if (*value == '=')
+        value = trim(value+1);
+
+    if (setConfigValue(config, key, value) < 0)
+    {
+        printf("Error - unknown setting or bad value: %s %s\n", key, value);
+
+        return 1;
+    }
+
+    return 0;
+}
+
+int loadConfig(struct Config* config, char* filename)
+{
+    FILE* ConfigFile;
+    char line[CONFIG_LINE_SIZE];
+    int error = 0;
+
+    printf("loadConfig()\n");
+    setDefaults(config);
+    updateWindowFlags(config);
+
+    if (filename == NULL)
+        filename = DEFAULT_CONFIG_FILE;
+
+    if ((ConfigFile = fopen(filename, "r")) == NULL)
+    {
+        printf("loadConfig(): no %s, using defaults\n", filename);
+
+        return 0;
+    }
+
+    while (fgets(line, CONFIG_LINE_SIZE, ConfigFile) != NULL)
+        error |= parseLine(config, line);
+
+    fclose(ConfigFile);
+    config->changes = CHANGE_NONE;
+
+    return error;
+}
+
+// --key=value or --key value overrides, applied after the config file
+int parseArguments(struct Config* config, int argc, char* argv[])
+{
+    char line[CONFIG_LINE_SIZE];
+    int i, error = 0;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--", 2))
+            continue;
+
+        if (strchr(argv[i], '=') || i+1 >= argc)
+            snprintf(line, CONFIG_LINE_SIZE, "%s", argv[i]+2);
+        else
+        {
+            snprintf(line, CONFIG_LINE_SIZE, "%s %s", argv[i]+2, argv[i+1]);
+            i++;
+        }
+
+        error |= parseLine(config, line);
+    }
+
+    config->changes = CHANGE_NONE;
+
+    return error;
+}
+
+// Console commands: "set <key> <value>", "get <key>", "list"
+int execConfigCommand(struct Config* config, const char* line, char* result, int size)
+{
+    char command[CONFIG_LINE_SIZE];
+    char key[CONFIG_LINE_SIZE] = "";
+    char value[CONFIG_LINE_SIZE] = "";
+    int i, written, changes;
+
+    result[0] = '\0';
+
+    if (sscanf(line, "%255s %255s %255[^\n]", command, key, value) < 1)
+        return 0;
+
+    if (!strcmp(command, "set"))
+    {
+        if ((changes = setConfigValue(config, key, value)) < 0)
+            snprintf(result, size, "unknown setting or bad value: %s %s", key, value);
+        else
+            snprintf(result, size, "%s = %s%s", key, value, (changes & CHANGE_RESTART) ? " (after restart)" : "");
+
+        return changes < 0;
+    }
+    else if (!strcmp(command, "get"))
+    {
+        if (getConfigValue(config, key, value, CONFIG_LINE_SIZE))
+        {
+            snprintf(result, size, "unknown setting: %s", key);
+
+            return 1;
+        }
+
+        snprintf(result, size, "%s = %s", key, value);
+    }
+    else if (!strcmp(command, "list"))
+    {
+        for (i = 0, written = 0; i < NUM_SETTINGS && written < size; i++)
+        {
+            getConfigValue(config, Settings[i].name, value, CONFIG_LINE_SIZE);
+            written += snprintf(result + written, size - written, "%s %s\n", Settings[i].name, value);
+        }
+    }
+    else
+    {
+        snprintf(result, size, "unknown command: %s", command);
+
+        return 1;
+    }
 
     return 0;
 }
@@ -3,17 +3,83 @@
 
 #include <stdint.h>
 
+#define CONFIG_STRING_SIZE  64
+#define CONFIG_LINE_SIZE    256
+#define DEFAULT_CONFIG_FILE "config.txt"
+
+enum SettingTypes
+{
+    SETTING_INT,
+    SETTING_FLOAT,
+    SETTING_STRING
+};
+
+// What has to be rebuilt when a setting changes; accumulated in Config.changes until the owners apply them
+enum SettingChanges
+{
+    CHANGE_NONE     = 0,
+    CHANGE_RESTART  = 1 << 0,   // only read at startup
+    CHANGE_WINDOW   = 1 << 1,   // window size & render scale
+    CHANGE_SCREEN   = 1 << 2,   // offscreen buffers sized by the render resolution
+    CHANGE_FONT     = 1 << 3,
+    CHANGE_RENDER   = 1 << 4    // read every frame, nothing to reallocate
+};
+
+struct Setting
+{
+    const char* name;
+    int         type;
+    int         offset;     // into struct Config
+    int         changes;
+    const char* help;
+    float       min, max;   // for numbers; anything outside is refused
+};
+
 struct Config
 {
-    char* title;
-    char* font;
-    int windowWidth, windowHeight;
-    int screenWidth, screenHeight;
+    // window
+    char    title[CONFIG_STRING_SIZE];
+    char    font [CONFIG_STRING_SIZE];
+    int     windowWidth, windowHeight;
+    int     screenWidth, screenHeight;
+    int     resScale;
+    int     fullscreen, borderless;
     uint32_t windowFlags;
-    int resScale;
+    // renderer quality
+    int     floorEnable;
+    float   fov;
+    int     drawDistance;       // caps the map's $drawdistance
+    int     dynamicRes;         // lower the 3D render resolution when frames run over budget
+    float   frameBudget;        // ms allowed for rendering the 3D view
+    int     views;              // split-screen cameras, 1 to 4
+    int     palette;            // 8-bit indexed 3D view
+    // game
+    char    map  [CONFIG_STRING_SIZE];
+    int     hotReload;
+    char    compile[CONFIG_STRING_SIZE];    // text map to write out compiled, then quit
+    int     minimap;            // 2D map over the 3D view
+    int     workers;            // job threads, -1 for one per core
+    char    record[CONFIG_STRING_SIZE];
+    char    replay[CONFIG_STRING_SIZE];
+    int     headless;           // run the replay without video
+    char    reference[CONFIG_STRING_SIZE];  // image the headless run's last frame is checked against
+    float   referenceTolerance; // percent of pixels that may differ from it
+    int     rewindMB;           // rewind history budget
+    char    capturePrefix[CONFIG_STRING_SIZE];
+    char    captureFormat[CONFIG_STRING_SIZE];  // for sequences, "png" or "y4m"
+    // network
+    int     server;             // port to serve on, 0 for none
+    char    connect[CONFIG_STRING_SIZE];
+    int     bots;               // local clients the server runs for load
+    int     serverSeconds;      // how long the server runs, 0 for good
+
+    int     changes;            // CHANGE_* flags not applied yet
 };
 
-int loadConfig(struct Config* config, char* filename);
+int loadConfig          (struct Config* config, char* filename);
+int parseArguments      (struct Config* config, int argc, char* argv[]);
+int setConfigValue      (struct Config* config, const char* key, const char* value);
+int getConfigValue      (struct Config* config, const char* key, char* buffer, int size);
+int execConfigCommand   (struct Config* config, const char* line, char* result, int size);
 
 #endif
-
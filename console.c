@@ -0,0 +1,47 @@
+#include "console.h"
+#include <stdio.h>
+#include <string.h>
+
+int initConsole(struct Console* console)
+{
+    printf("initConsole()\n");
+
+    console->open      = 0;
+    console->output[0] = '\0';
+    initTextField(&console->TextField);
+
+    return 0;
+}
+
+// Toggled with the backquote key; takes over the input text field while open and runs a command per line
+int execConsole(struct Console* console, struct Input* input, struct Config* config)
+{
+    char* newline;
+
+    if (input->toggleConsole)
+    {
+        console->open ^= 1;
+        initTextField(&console->TextField);
+
+        if (console->open)
+        {
+            input->TextField = &console->TextField;
+            SDL_StartTextInput();
+        }
+        else
+        {
+            input->TextField = NULL;
+            SDL_StopTextInput();
+        }
+    }
+
+    if (!console->open || (newline = strchr(console->TextField.buffer, '\n')) == NULL)
+        return 0;
+
+    *newline = '\0';
+    execConfigCommand(config, console->TextField.buffer, console->output, CONSOLE_OUTPUT_SIZE);
+    printf("> %s\n%s\n", console->TextField.buffer, console->output);
+    initTextField(&console->TextField);
+
+    return 0;
+}
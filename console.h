@@ -0,0 +1,19 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include "input.h"
+#include "config.h"
+
+#define CONSOLE_OUTPUT_SIZE 1024
+
+struct Console
+{
+    int open;
+    struct TextField TextField;
+    char output[CONSOLE_OUTPUT_SIZE];   // result of the last command
+};
+
+int initConsole(struct Console* console);
+int execConsole(struct Console* console, struct Input* input, struct Config* config);
+
+#endif
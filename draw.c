@@ -0,0 +1,401 @@
+#include "draw.h"
+#include "video.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEY_INDEX_MASK  0xFFFF
+
+struct DrawBatch
+{
+    SDL_Renderer*   Renderer;
+    int             texture, blend, numQuads;
+};
+
+void initDrawList(struct DrawList* list, struct Arena* frame)
+{
+    int i;
+
+    printf("initDrawList()\n");
+
+    memset(list, 0, sizeof(struct DrawList));
+    list->Frame = frame;
+    initTextCache(&list->TextCache);
+
+    // every quad is two triangles over its four vertices, so the index buffer never changes
+    for (i = 0; i < DRAW_BATCH_QUADS; i++)
+    {
+        list->indices[i*6+0] = i*4+0;
+        list->indices[i*6+1] = i*4+1;
+        list->indices[i*6+2] = i*4+2;
+        list->indices[i*6+3] = i*4+2;
+        list->indices[i*6+4] = i*4+3;
+        list->indices[i*6+5] = i*4+0;
+    }
+
+    clearDrawList(list);
+}
+
+void clearDrawList(struct DrawList* list)
+{
+    list->numCommands = 0;
+    list->numTextures = 1;      // index 0 is "no texture", used by plain rects
+    list->numBlends   = 0;
+    list->TextCache.frame++;
+    memset(&list->Stats, 0, sizeof(struct DrawStats));
+}
+
+// Scratch memory from the frame arena, gone once the frame is over
+void* allocDrawData(struct DrawList* list, int size)
+{
+    return allocArena(list->Frame, size);
+}
+
+static int findTexture(struct DrawList* list, SDL_Texture* texture)
+{
+    struct DrawTexture* Entry;
+    int i, w, h;
+
+    if (texture == NULL)
+        return 0;
+
+    for (i = 1; i < list->numTextures; i++)
+        if (list->Textures[i].Texture == texture)
+            return i;
+
+    if (list->numTextures >= MAX_DRAW_TEXTURES || SDL_QueryTexture(texture, NULL, NULL, &w, &h) < 0)
+        return -1;
+
+    Entry           = &list->Textures[list->numTextures];
+    Entry->Texture  = texture;
+    Entry->invW     = 1.0f / w;
+    Entry->invH     = 1.0f / h;
+    Entry->width    = w;
+
+    return list->numTextures++;
+}
+
+static int findBlend(struct DrawList* list, SDL_BlendMode blend)
+{
+    int i;
+
+    for (i = 0; i < list->numBlends; i++)
+        if (list->Blends[i] == blend)
+            return i;
+
+    if (list->numBlends >= MAX_DRAW_BLENDS)
+        return -1;
+
+    list->Blends[list->numBlends] = blend;
+
+    return list->numBlends++;
+}
+
+static struct DrawCommand* newCommand(struct DrawList* list, int type, int layer, SDL_Texture* texture, SDL_BlendMode blend)
+{
+    struct DrawCommand* Command;
+    int textureId = findTexture(list, texture);
+    int blendId   = findBlend(list, blend);
+
+    if (list->numCommands >= MAX_DRAW_COMMANDS || textureId < 0 || blendId < 0)
+    {
+        list->Stats.dropped++;
+
+        return NULL;
+    }
+
+    Command = &list->Commands[list->numCommands];
+    Command->type    = type;
+    Command->layer   = layer;
+    Command->texture = textureId;
+    Command->blend   = blendId;
+    Command->color   = 0xFFFFFF;
+    Command->alpha   = 255;
+
+    // the command index breaks ties, so equal state keeps recording order
+    list->keys[list->numCommands] = ((uint64_t)layer << 56) | ((uint64_t)blendId << 48) | ((uint64_t)textureId << 40) | list->numCommands;
+    list->numCommands++;
+    list->Stats.commands++;
+
+    return Command;
+}
+
+int drawRect(struct DrawList* list, int layer, SDL_Rect dst, uint32_t color, uint8_t alpha, SDL_BlendMode blend)
+{
+    struct DrawCommand* Command = newCommand(list, DRAW_RECT, layer, NULL, blend);
+
+    if (Command == NULL)
+        return 1;
+
+    Command->Dst   = dst;
+    Command->color = color;
+    Command->alpha = alpha;
+
+    return 0;
+}
+
+int drawSprite(struct DrawList* list, int layer, SDL_Texture* texture, SDL_Rect src, SDL_Rect dst, uint32_t color, SDL_BlendMode blend)
+{
+    struct DrawCommand* Command = newCommand(list, DRAW_SPRITE, layer, texture, blend);
+
+    if (Command == NULL)
+        return 1;
+
+    Command->Src   = src;
+    Command->Dst   = dst;
+    Command->color = color;
+
+    return 0;
+}
+
+// x, y in pixels; text wraps after columns and stops after rows, 0 for no limit.
+// The glyph quads come from the text cache, so a string that was drawn last frame isn't laid out again.
+int drawString(struct DrawList* list, int layer, struct Font* font, const char* text, int x, int y, int columns, int rows, uint32_t color)
+{
+    struct DrawCommand* Command;
+    struct TextLayout* Layout;
+    char* copy = NULL;
+    int length;
+
+    columns = columns ? columns : INT32_MAX;
+    rows    = rows    ? rows    : INT32_MAX;
+
+    // cache full of strings drawn this frame: keep a copy and lay it out at submit
+    if ((Layout = getTextLayout(&list->TextCache, font, text, columns, rows)) == NULL)
+    {
+        length = strlen(text) + 1;
+
+        if ((copy = allocDrawData(list, length)) == NULL)
+        {
+            list->Stats.dropped++;
+
+            return 1;
+        }
+
+        memcpy(copy, text, length);
+    }
+
+    if ((Command = newCommand(list, DRAW_TEXT, layer, font->Texture, SDL_BLENDMODE_BLEND)) == NULL)
+        return 1;
+
+    Command->Dst            = (SDL_Rect){x, y, font->width, font->height};
+    Command->color          = color;
+    Command->Text.text      = copy;
+    Command->Text.Font      = font;
+    Command->Text.Layout    = Layout;
+    Command->Text.columns   = columns;
+    Command->Text.rows      = rows;
+
+    return 0;
+}
+
+// A grid of atlas tiles drawn at x, y; DRAW_NO_TILE leaves a hole
+int drawTiles(struct DrawList* list, int layer, SDL_Texture* texture, const uint16_t* tiles, int columns, int rows, int tileSize, int texSize, int x, int y)
+{
+    struct DrawCommand* Command;
+    int size = columns * rows * sizeof(uint16_t);
+    uint16_t* copy = allocDrawData(list, size);
+
+    if (copy == NULL || (Command = newCommand(list, DRAW_TILES, layer, texture, SDL_BLENDMODE_BLEND)) == NULL)
+    {
+        list->Stats.dropped += (copy == NULL);
+
+        return 1;
+    }
+
+    memcpy(copy, tiles, size);
+    Command->Dst            = (SDL_Rect){x, y, columns * tileSize, rows * tileSize};
+    Command->Tiles.tiles    = copy;
+    Command->Tiles.columns  = columns;
+    Command->Tiles.rows     = rows;
+    Command->Tiles.tileSize = tileSize;
+    Command->Tiles.texSize  = texSize;
+
+    return 0;
+}
+
+static void flushBatch(struct DrawList* list, struct DrawBatch* batch)
+{
+    SDL_Texture* Texture;
+
+    if (batch->numQuads == 0)
+        return;
+
+    Texture = list->Textures[batch->texture].Texture;
+
+    if (Texture)
+        SDL_SetTextureBlendMode(Texture, list->Blends[batch->blend]);
+    else
+        SDL_SetRenderDrawBlendMode(batch->Renderer, list->Blends[batch->blend]);
+
+    SDL_RenderGeometry(batch->Renderer, Texture, list->Vertices, batch->numQuads*4, list->indices, batch->numQuads*6);
+    list->Stats.quads += batch->numQuads;
+    list->Stats.batches++;
+    batch->numQuads = 0;
+}
+
+static void addQuad(struct DrawList* list, struct DrawBatch* batch, float x, float y, float w, float h, SDL_Rect* src, SDL_Color color)
+{
+    struct DrawTexture* Texture = &list->Textures[batch->texture];
+    SDL_Vertex* Vertex;
+    float u0 = 0, v0 = 0, u1 = 0, v1 = 0;
+
+    if (batch->numQuads >= DRAW_BATCH_QUADS)
+        flushBatch(list, batch);
+
+    if (src)
+    {
+        u0 = src->x * Texture->invW;
+        v0 = src->y * Texture->invH;
+        u1 = (src->x + src->w) * Texture->invW;
+        v1 = (src->y + src->h) * Texture->invH;
+    }
+
+    Vertex = &list->Vertices[batch->numQuads*4];
+    Vertex[0] = (SDL_Vertex){{x,   y  }, color, {u0, v0}};
+    Vertex[1] = (SDL_Vertex){{x+w, y  }, color, {u1, v0}};
+    Vertex[2] = (SDL_Vertex){{x+w, y+h}, color, {u1, v1}};
+    Vertex[3] = (SDL_Vertex){{x,   y+h}, color, {u0, v1}};
+    batch->numQuads++;
+}
+
+static void addLayout(struct DrawList* list, struct DrawBatch* batch, struct DrawCommand* command, SDL_Color color)
+{
+    struct TextLayout* Layout = command->Text.Layout;
+    SDL_Vertex* Src;
+    SDL_Vertex* Dst;
+    int i, j;
+
+    for (i = 0; i < Layout->numQuads; i++)
+    {
+        if (batch->numQuads >= DRAW_BATCH_QUADS)
+            flushBatch(list, batch);
+
+        Src = &Layout->Vertices[i*4];
+        Dst = &list->Vertices[batch->numQuads*4];
+
+        for (j = 0; j < 4; j++)
+        {
+            Dst[j].position.x = Src[j].position.x + command->Dst.x;
+            Dst[j].position.y = Src[j].position.y + command->Dst.y;
+            Dst[j].color      = color;
+            Dst[j].tex_coord  = Src[j].tex_coord;
+        }
+
+        batch->numQuads++;
+    }
+}
+
+static void addText(struct DrawList* list, struct DrawBatch* batch, struct DrawCommand* command, SDL_Color color)
+{
+    struct Font* Font = command->Text.Font;
+    SDL_Rect Src = {0, 0, Font->width, Font->height};
+    const char* c;
+    int column = 0, row = 0;
+
+    for (c = command->Text.text; *c != '\0'; c++)
+    {
+        if (*c == '\n' || column >= command->Text.columns)
+        {
+            column = 0;
+
+            if (++row >= command->Text.rows)
+                break;
+
+            if (*c == '\n')
+                continue;
+        }
+
+        if (*c != ' ')
+        {
+            Src.x = (*c % 32) * Font->width;
+            Src.y = (*c / 32) * Font->height;
+            addQuad(list, batch, command->Dst.x + column * Font->width, command->Dst.y + row * Font->height, Font->width, Font->height, &Src, color);
+        }
+
+        column++;
+    }
+}
+
+static void addTiles(struct DrawList* list, struct DrawBatch* batch, struct DrawCommand* command, SDL_Color color)
+{
+    const int texSize  = command->Tiles.texSize;
+    const int tileSize = command->Tiles.tileSize;
+    const int columns  = list->Textures[command->texture].width / texSize;
+    SDL_Rect Src = {0, 0, texSize, texSize};
+    uint16_t tile;
+    int x, y;
+
+    for (y = 0; y < command->Tiles.rows; y++)
+    {
+        for (x = 0; x < command->Tiles.columns; x++)
+        {
+            if ((tile = command->Tiles.tiles[y * command->Tiles.columns + x]) == DRAW_NO_TILE)
+                continue;
+
+            Src.x = (tile % columns) * texSize;
+            Src.y = (tile / columns) * texSize;
+            addQuad(list, batch, command->Dst.x + x * tileSize, command->Dst.y + y * tileSize, tileSize, tileSize, &Src, color);
+        }
+    }
+}
+
+static int compareKeys(const void* a, const void* b)
+{
+    uint64_t keyA = *(const uint64_t*)a;
+    uint64_t keyB = *(const uint64_t*)b;
+
+    return (keyA > keyB) - (keyA < keyB);
+}
+
+// Sort by state and submit; consecutive commands with the same texture and blend mode become one SDL_RenderGeometry call
+int submitDrawList(struct DrawList* list, SDL_Renderer* renderer)
+{
+    struct DrawBatch Batch = {renderer, -1, -1, 0};
+    struct DrawCommand* Command;
+    SDL_Color Color;
+    int i;
+
+    qsort(list->keys, list->numCommands, sizeof(uint64_t), compareKeys);
+
+    for (i = 0; i < list->numCommands; i++)
+    {
+        Command = &list->Commands[list->keys[i] & KEY_INDEX_MASK];
+
+        if (Command->texture != Batch.texture || Command->blend != Batch.blend)
+        {
+            flushBatch(list, &Batch);
+            Batch.texture = Command->texture;
+            Batch.blend   = Command->blend;
+            list->Stats.stateChanges++;
+        }
+
+        Color = (SDL_Color){uintToRGB(Command->color), Command->alpha};
+
+        switch (Command->type)
+        {
+            case DRAW_RECT:
+                addQuad(list, &Batch, Command->Dst.x, Command->Dst.y, Command->Dst.w, Command->Dst.h, NULL, Color);
+                break;
+
+            case DRAW_SPRITE:
+                addQuad(list, &Batch, Command->Dst.x, Command->Dst.y, Command->Dst.w, Command->Dst.h, &Command->Src, Color);
+                break;
+
+            case DRAW_TEXT:
+                if (Command->Text.Layout)
+                    addLayout(list, &Batch, Command, Color);
+                else
+                    addText(list, &Batch, Command, Color);
+                break;
+
+            case DRAW_TILES:
+                addTiles(list, &Batch, Command, Color);
+                break;
+        }
+    }
+
+    flushBatch(list, &Batch);
+
+    return 0;
+}
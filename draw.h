@@ -0,0 +1,90 @@
+#ifndef DRAW_H
+#define DRAW_H
+
+#include <SDL2/SDL.h>
+#include <stdint.h>
+#include "text.h"
+#include "memory.h"
+
+#define MAX_DRAW_COMMANDS   4096
+#define MAX_DRAW_TEXTURES   64
+#define MAX_DRAW_BLENDS     8
+#define DRAW_BATCH_QUADS    1024        // quads per SDL_RenderGeometry call
+#define DRAW_NO_TILE        0xFFFF
+
+struct Font;
+
+enum DrawTypes
+{
+    DRAW_RECT,
+    DRAW_SPRITE,
+    DRAW_TEXT,
+    DRAW_TILES
+};
+
+// Sorted by layer first; within a layer by blend mode and texture, so draw order is only kept between layers
+enum DrawLayers
+{
+    LAYER_BACKGROUND,
+    LAYER_WORLD,
+    LAYER_SPRITES,
+    LAYER_HUD,
+    LAYER_MENU,
+    LAYER_CONSOLE
+};
+
+struct DrawCommand
+{
+    uint8_t     type;
+    uint8_t     layer;
+    uint8_t     texture;        // index into DrawList.Textures
+    uint8_t     blend;          // index into DrawList.Blends
+    uint32_t    color;          // 0xRRGGBB
+    uint8_t     alpha;
+    SDL_Rect    Dst;
+
+    union
+    {
+        SDL_Rect Src;
+        struct {const char* text; struct Font* Font; struct TextLayout* Layout; int columns, rows;} Text;   // Layout is NULL if the cache was full
+        struct {const uint16_t* tiles; int columns, rows, tileSize, texSize;} Tiles;   // tile values index texSize squares on the atlas, row-major
+    };
+};
+
+struct DrawTexture
+{
+    SDL_Texture*    Texture;
+    float           invW, invH;     // texel to texture coordinate
+    int             width;          // pixels, for finding tiles on an atlas
+};
+
+struct DrawStats
+{
+    int commands, dropped, quads, batches, stateChanges;
+};
+
+// Retained per-frame command buffer; states record into it, execGraphics() sorts and submits it in batches
+struct DrawList
+{
+    int                 numCommands, numTextures, numBlends;
+    struct DrawCommand  Commands[MAX_DRAW_COMMANDS];
+    uint64_t            keys    [MAX_DRAW_COMMANDS];
+    struct DrawTexture  Textures[MAX_DRAW_TEXTURES];
+    SDL_BlendMode       Blends  [MAX_DRAW_BLENDS];
+    struct Arena*       Frame;      // strings and tile grids copied into commands
+    SDL_Vertex          Vertices[DRAW_BATCH_QUADS*4];
+    int                 indices [DRAW_BATCH_QUADS*6];
+    struct DrawStats    Stats;
+    struct TextCache    TextCache;  // kept across frames
+};
+
+void  initDrawList  (struct DrawList* list, struct Arena* frame);
+void  clearDrawList (struct DrawList* list);
+void* allocDrawData (struct DrawList* list, int size);
+int   drawRect      (struct DrawList* list, int layer, SDL_Rect dst, uint32_t color, uint8_t alpha, SDL_BlendMode blend);
+int   drawSprite    (struct DrawList* list, int layer, SDL_Texture* texture, SDL_Rect src, SDL_Rect dst, uint32_t color, SDL_BlendMode blend);
+int   drawString    (struct DrawList* list, int layer, struct Font* font, const char* text, int x, int y, int columns, int rows, uint32_t color);
+int   drawTiles     (struct DrawList* list, int layer, SDL_Texture* texture, const uint16_t* tiles, int columns, int rows, int tileSize, int texSize, int x, int y);
+int   submitDrawList(struct DrawList* list, SDL_Renderer* renderer);
+
+#endif
@@ -0,0 +1,112 @@
+#include "dynres.h"
+#include <stdio.h>
+
+static void setRenderSize(struct ResolutionScaler* scaler)
+{
+    scaler->renderWidth  = scaler->fullWidth  * (RES_STEP_DIVISOR - scaler->colStep) / RES_STEP_DIVISOR;
+    scaler->renderHeight = scaler->fullHeight * (RES_STEP_DIVISOR - scaler->rowStep) / RES_STEP_DIVISOR;
+    scaler->renderHeight &= ~1;     // the raycaster splits the screen in two halves
+}
+
+void initResolutionScaler(struct ResolutionScaler* scaler, int fullWidth, int fullHeight, float budgetMs, int enable)
+{
+    scaler->enable      = enable;
+    scaler->budgetMs    = budgetMs;
+    scaler->averageMs   = 0;
+    scaler->fullWidth   = fullWidth;
+    scaler->fullHeight  = fullHeight;
+    scaler->colStep     = 0;
+    scaler->rowStep     = 0;
+    scaler->overFrames  = 0;
+    scaler->underFrames = 0;
+    scaler->cooldown    = RES_COOLDOWN;
+    setRenderSize(scaler);
+}
+
+// Columns go first on the way down and rows first on the way back up, so the axes stay within a step of each other
+static void stepDown(int* colStep, int* rowStep)
+{
+    if (*colStep <= *rowStep && *colStep < RES_MAX_STEP)
+        (*colStep)++;
+    else if (*rowStep < RES_MAX_STEP)
+        (*rowStep)++;
+}
+
+static void stepUp(int* colStep, int* rowStep)
+{
+    if (*rowStep >= *colStep && *rowStep > 0)
+        (*rowStep)--;
+    else if (*colStep > 0)
+        (*colStep)--;
+}
+
+static int pixelsAt(struct ResolutionScaler* scaler, int colStep, int rowStep)
+{
+    return (scaler->fullWidth  * (RES_STEP_DIVISOR - colStep) / RES_STEP_DIVISOR)
+         * (scaler->fullHeight * (RES_STEP_DIVISOR - rowStep) / RES_STEP_DIVISOR);
+}
+
+// Feed the time the last frame took to render; returns 1 if renderWidth/renderHeight changed
+int updateResolutionScaler(struct ResolutionScaler* scaler, float renderMs)
+{
+    int colStep = scaler->colStep;
+    int rowStep = scaler->rowStep;
+    float predictedMs;
+
+    if (!scaler->enable)
+    {
+        if (colStep == 0 && rowStep == 0)
+            return 0;
+
+        colStep = rowStep = 0;
+    }
+    else
+    {
+        scaler->averageMs = (scaler->averageMs == 0) ? renderMs : scaler->averageMs + (renderMs - scaler->averageMs) * RES_SMOOTHING;
+
+        if (scaler->cooldown > 0)
+        {
+            scaler->cooldown--;
+
+            return 0;
+        }
+
+        // Over budget for a while: drop a step
+        if (scaler->averageMs > scaler->budgetMs)
+        {
+            scaler->underFrames = 0;
+
+            if (++scaler->overFrames < RES_DOWN_FRAMES)
+                return 0;
+
+            stepDown(&colStep, &rowStep);
+        }
+        // Under budget for longer: raise a step, but only if the predicted cost still leaves headroom, so we don't bounce
+        else
+        {
+            scaler->overFrames = 0;
+
+            if (++scaler->underFrames < RES_UP_FRAMES)
+                return 0;
+
+            stepUp(&colStep, &rowStep);
+            predictedMs = scaler->averageMs * pixelsAt(scaler, colStep, rowStep) / pixelsAt(scaler, scaler->colStep, scaler->rowStep);
+
+            if (predictedMs > scaler->budgetMs * RES_UP_HEADROOM)
+                return 0;
+        }
+
+        if (colStep == scaler->colStep && rowStep == scaler->rowStep)
+            return 0;
+    }
+
+    scaler->colStep     = colStep;
+    scaler->rowStep     = rowStep;
+    scaler->overFrames  = 0;
+    scaler->underFrames = 0;
+    scaler->cooldown    = RES_COOLDOWN;
+    setRenderSize(scaler);
+    printf("updateResolutionScaler(): %.2f ms average, render size now %dx%d\n", scaler->averageMs, scaler->renderWidth, scaler->renderHeight);
+
+    return 1;
+}
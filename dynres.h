@@ -0,0 +1,28 @@
+#ifndef DYNRES_H
+#define DYNRES_H
+
+#define RES_STEP_DIVISOR    8       // each step drops 1/8 of the full resolution on one axis
+#define RES_MAX_STEP        4       // never below half resolution on either axis
+#define RES_SMOOTHING       0.1     // weight of the newest frame in the moving average
+#define RES_DOWN_FRAMES     10      // frames over budget before dropping a step
+#define RES_UP_FRAMES       60      // frames with headroom before raising a step
+#define RES_UP_HEADROOM     0.9     // raise only if the predicted cost at the higher resolution fits in 90% of the budget
+#define RES_COOLDOWN        30      // frames to let the average settle after a change
+
+// Adjusts the internal 3D render resolution from measured render times.
+// Columns drop first (every column is a wall ray plus a floor pixel per row), then rows, alternating.
+struct ResolutionScaler
+{
+    int     enable;
+    float   budgetMs;
+    float   averageMs;
+    int     fullWidth, fullHeight;
+    int     renderWidth, renderHeight;
+    int     colStep, rowStep;
+    int     overFrames, underFrames, cooldown;
+};
+
+void initResolutionScaler   (struct ResolutionScaler* scaler, int fullWidth, int fullHeight, float budgetMs, int enable);
+int  updateResolutionScaler (struct ResolutionScaler* scaler, float renderMs);
+
+#endif
@@ -7,6 +7,23 @@
 #include <string.h>
 #include <ctype.h>
 #include <math.h>
+#include <limits.h>
+
+#include "board.h"
+#include "watch.h"
+#include "config.h"
+#include "dynres.h"
+#include "fastmath.h"
+#include "physics.h"
+#include "mapcache.h"
+#include "jobs.h"
+#include "replay.h"
+#include "rng.h"
+#include "snapshot.h"
+#include "net.h"
+#include "palette.h"
+#include "capture.h"
+#include "ecs.h"
 
 /*********
 * Macros *
@@ -28,15 +45,12 @@
 #define   divideVec2(a,b)               a.x /= b.x,         a.y /= b.y
 #define    scaleVec2(v,scale)           v.x *= scale,       v.y *= scale
 #define    crossVec2(a,b,ab)            ab.x = (a.x)*(b.y), ab.y = -(a.y)*(b.x)
-#define setVec2Angle(v, angle)          v.x = cos(angle),   v.y = -sin(angle)
-#define getVec2Angle(v)                 atan2(v.y, v.x)
-#define getVec2Length(v)                sqrt(pow(v.x,2) + pow(v.y,2))
-#define getVec2LengthSquared(v)              pow(v.x,2) + pow(v.y,2)
-#define getVec2Distance(v1,v2)          sqrt(pow(v1.x-v2.x,2) + pow(v1.y-v2.y,2))
-#define getVec2DistanceSquared(v1,v2)        pow(v1.x-v2.x,2) + pow(v1.y-v2.y,2)
-
-#define tileAt(board,x,y)               board->tileMap[(y) * board->w + (x)]
-#define setTile(board,x,y,tile)         tileAt(board,(x),(y)) = tile
+#define setVec2Angle(v, angle)          v.x = fastCos(angle), v.y = -fastSin(angle)
+#define getVec2Angle(v)                 fastAtan2(v.y, v.x)
+#define getVec2Length(v)                fastLength(v.x, v.y)
+#define getVec2LengthSquared(v)         lengthSquared(v.x, v.y)
+#define getVec2Distance(v1,v2)          fastLength(v1.x-v2.x, v1.y-v2.y)
+#define getVec2DistanceSquared(v1,v2)   lengthSquared(v1.x-v2.x, v1.y-v2.y)
 
 #define setColor(dst,src)               dst[0] = src[0], dst[1] = src[1], dst[2] = src[2], dst[3] = src[3]
 #define colorArg3(array)                array[0], array[1], array[2]
@@ -45,11 +59,8 @@
 /************
 * Constants *
 ************/
-// Basics
-#define BUFFER_SIZE                     64
-
 // Logic & physics
-#define MAX_ENTITIES                    10
+#define MAX_ENTITIES                    16384
 
 #define TILE_SIZE                       16
 #define HALF_TILE                       (TILE_SIZE/2)
@@ -64,6 +75,9 @@
 #define DEFAULT_ANGULAR_ACCELERATION    degToRad(0.5)
 #define DEFAULT_MAX_ANGULAR_VELOCITY    degToRad(4.0)
 
+#define TICK_RATE                       60      // fixed simulation steps per second
+#define MAX_TICKS_PER_UPDATE            5
+
 #define FIRE_COOLDOWN_TIME              3
 #define EXPLOSION_MAGNITUDE             30
 #define INACCURACY                      0.1
@@ -84,18 +98,8 @@
 #define RGBA_DARK_BLUE                  (uint8_t[]) {0,     0,      64,     0   }
 
 // Rendering
-#define FULL_SCREEN                     0
-#define BORDERLESS                      0
-#define RES_SCALE                       1
-#define SCREEN_WIDTH                    320
-#define SCREEN_HEIGHT                   240
-#define SCREEN_RATIO                    ((float)SCREEN_HEIGHT / SCREEN_WIDTH)
-// fov
-#define DEFAULT_FOV                     1.0
-#define DEFAULT_H_FOV                   DEFAULT_FOV
-#define DEFAULT_V_FOV                   DEFAULT_FOV
+// screen size, scale, fov, floor casting and the draw distance cap come from struct Config, see applyRenderConfig()
 // textures
-#define FLOOR_ENABLE                    1
 #define TEX_ENABLE                      1
 #define TEX_SIZE                        64
 // light
@@ -117,6 +121,10 @@
 #define CEILING_COLOR                   RGBA_DARK_BLUE
 #define BACKGROUND_TOP                  1
 #define BACKGROUND_BOTTOM               1
+#define MAX_VIEWS                       4       // split-screen cameras
+#define WALL_CHUNK                      16      // columns per piece of a view's wall job
+#define FLOOR_CHUNK                     8       // rows per piece of its floor job
+#define EXPAND_CHUNK                    16      // rows per piece of the 8-bit frame's palette expansion
 // head bop
 #define BOP_SPEED                       12
 #define BOP_HEIGHT                      1.3
@@ -129,18 +137,20 @@
 #define LIQUID_WAVE_HEIGHT              (TEX_SIZE / 16)
 #define LIQUID_WAVE_WIDTH               (360 / TEX_SIZE)
 #define LIQUID_WAVE_SPEED               5
+// minimap
+#define MINIMAP_DIVISOR                 3       // fraction of the screen it covers on each axis
+#define MINIMAP_MARGIN                  4
 // particle effects etc
 #define FIRE_COLOR1                     RGBA_YELLOW
 #define FIRE_COLOR2                     RGBA_RED
 
-int quit;
 int entityCount = 0;
 
 int texSize       = TEX_SIZE;
 int tileSize      = TILE_SIZE;
 int halfTile      = HALF_TILE;
 int quarterTile   = QUARTER_TILE;
-int floorEnable   = FLOOR_ENABLE;
+int floorEnable;
 int wallTex       = TEX_ENABLE;
 int floorTex      = TEX_ENABLE;
 int ceilingTex    = TEX_ENABLE;
@@ -152,6 +162,8 @@ int minLight      = MIN_LIGHT;
 int maxLight      = MAX_LIGHT;
 int drawDistance  = DRAW_DISTANCE;
 int backClipPlane = BACK_CLIP_PLANE;
+int maxDrawDistance;
+float fov;
 
 int playerId;
 int cameraId;
@@ -161,8 +173,11 @@ int crosshairX, crosshairY;
 
 long long tick;
 
-const int screenWidth   = SCREEN_WIDTH;
-const int screenHeight  = SCREEN_HEIGHT;
+int screenX,    screenY;          // where Video's screen sits in the window, for the mouse
+int screenWidth;
+int screenHeight;
+int resScale;
+int minimapEnable;
 int backgroundTop    = 0;
 int backgroundBottom = 0;
 int backgroundWidth;
@@ -170,29 +185,33 @@ int backgroundHeight;
 SDL_Rect BackgroundSrcRect;
 SDL_Rect BackgroundDstRect;
 
-SDL_Window*     Window2D;
-SDL_Window*     Window3D;
-SDL_Renderer*   Renderer2D;
-SDL_Renderer*   Renderer3D;
-SDL_Texture*    Texture2D;
-SDL_Texture*    Texture3D;
+SDL_Renderer*   Renderer;           // Video's; the game has no window of its own
+SDL_Texture*    AtlasTexture;
 SDL_Texture*    OffScreen3D;
+SDL_Texture*    Frame3D;            // the 3D view renders into its top-left ResScaler.renderWidth x renderHeight, then gets stretched to the screen
+SDL_Texture*    MinimapTexture;     // the 2D view, drawn shrunk into a corner of the screen
 SDL_Texture*    BackgroundTexture;
+SDL_Texture*    PaletteFrame;       // streaming; Frame8 expanded into its top-left when the 8-bit path is on
 
 SDL_BlendMode   FogBlendMode;
 
-enum TILE_TYPES
-{
-    TILE_OBSTACLE    = (1 << 0),
-    TILE_PARTIAL_OBS = (1 << 1),
-    TILE_OCCLUSION   = (1 << 2),
-    TILE_PARTIAL_OCC = (1 << 3),
-    TILE_LIQUID      = (1 << 4),
-    TILE_TOGGLE      = (1 << 5),
-    TILE_UNUSED_FLAG = (1 << 6),
-    TILE_LIT         = (1 << 7),
-    TILE_FLAGS       = 8,
-};
+struct Palette      Palette;
+struct IndexedImage AtlasIndexed;
+struct IndexedImage BackgroundIndexed;
+uint8_t*            Frame8;         // screenWidth x screenHeight palette indices, laid out like Frame3D
+uint32_t*           LockedFrame;    // where the expand job writes; PaletteFrame's pixels, or a plain buffer
+int                 lockedPitch;    // in pixels
+int                 paletteEnable;
+
+#define SCREENSHOT_KEY  SDL_SCANCODE_F12
+#define SEQUENCE_KEY    SDL_SCANCODE_F11    // starts and stops recording every frame
+
+struct Capture      Capture;
+int                 screenshotPending;
+uint8_t             lastScreenshotKey, lastSequenceKey;
+
+struct ResolutionScaler ResScaler;
+struct MapCache MapCache;
 
 enum COMMAND_TYPES
 {
@@ -206,54 +225,34 @@ enum COMMAND_TYPES
     COMMAND_TURN_RIGHT  = 1 << 7,
     COMMAND_MOVE_RUN    = 1 << 8,
     MOVE_COMMANDS       = 0b111111111,
-    COMMAND_FIRE        = 1 << 9
+    COMMAND_FIRE        = 1 << 9,
+    COMMAND_USE         = 1 << 10
 };
 
-#define NUM_INPUT_CHANNELS 1
-
-enum OBJECT_TYPES
-{
-    OBJECT_PLAYER,
-    OBJECT_LIGHT
-};
+#define NUM_INPUT_CHANNELS (1 + NET_MAX_CLIENTS)  // the local player, then one per client slot of a server
 
-struct Object
+// One random stream per system, all seeded from the game's seed
+enum RngStreams
 {
-    char type;
-    int x, y;
-
-    union
-    {
-        struct {float angle;};
-        struct {int brightness, range;};
-    };
+    RNG_WEAPONS,
+    RNG_EFFECTS,
+    RNG_AI,
+    NUM_RNG_STREAMS
 };
 
-struct Board
-{
-    int             w, h, size, numObjects;
-    int             lightEnable, wallTex, floorTex, ceilingTex, wallFog, floorFog, ceilingFog, backgroundTop, backgroundBottom;
-    int             fogDistance, drawDistance, backClipPlane;
-    int             tileSize, texSize, minLight, maxLight;
-    int             wallColor   [3];
-    int             floorColor  [3];
-    int             ceilingColor[3];
-    int             fogColor    [3];
-    char            textureFile [BUFFER_SIZE];
-    char            bgFile      [BUFFER_SIZE];
-    uint16_t*       tileMap;
-    uint8_t*        lightMap;
-    struct Object*  objects;
-};
+struct Rng RngArray[NUM_RNG_STREAMS];
 
-int tileAtPos(struct Board* board_, int x, int y)
+void seedStreams(uint32_t seed)
 {
-    return board_->tileMap[((y/tileSize) * board_->w) + (x/tileSize)];
+    int i;
+
+    for (i = 0; i < NUM_RNG_STREAMS; i++)
+        seedRng(&RngArray[i], seed, i);
 }
 
-float randomFloat(float min, float max)
+float randomFloat(struct Rng* rng, float min, float max)
 {
-    return min + ((float)rand() / (float)RAND_MAX) * (max-min);
+    return rngFloat(rng, min, max);
 }
 
 void addToColor(uint8_t target[], int color[])
@@ -287,7 +286,7 @@ uint32_t blendColors(uint8_t color1[], uint8_t color2[])
     return color.bytes;
 }
 
-uint32_t randomColor()
+uint32_t randomColor(struct Rng* rng)
 {
     union Color
     {
@@ -296,7 +295,7 @@ uint32_t randomColor()
     } color;
 
     for (int i = 0; i < 4; i++)
-        color.values[i] = rand() % 255;
+        color.values[i] = rngBelow(rng, 255);
 
     return color.bytes;
 }
@@ -316,25 +315,26 @@ ZeroVec2 = {0, 0};
 struct Vec2 rotateVec2(const struct Vec2 v, float angle)
 {
     struct Vec2 rotVec;
-    rotVec.x = v.x*cos(angle) - v.y*sin(angle);
-    rotVec.y = v.x*sin(angle) + v.y*cos(angle);
+    const float c = fastCos(angle), s = fastSin(angle);
+    rotVec.x = v.x*c - v.y*s;
+    rotVec.y = v.x*s + v.y*c;
 
     return rotVec;
 }
 
-struct Vec2 randomVec2(float min, float max)
+struct Vec2 randomVec2(struct Rng* rng, float min, float max)
 {
-    struct Vec2 v = {randomFloat(min, max), 0};
-    v = rotateVec2(v, randomFloat(0, 360));
+    struct Vec2 v = {randomFloat(rng, min, max), 0};
+    v = rotateVec2(v, randomFloat(rng, 0, 360));
 
     return v;
 }
 
-struct Vec2 randomVec2Rect(float x, float y)
+struct Vec2 randomVec2Rect(struct Rng* rng, float x, float y)
 {
     struct Vec2 v;
-    v.x = randomFloat(0, x);
-    v.y = randomFloat(0, y);
+    v.x = randomFloat(rng, 0, x);
+    v.y = randomFloat(rng, 0, y);
 
     return v;
 }
@@ -358,16 +358,26 @@ struct Particle
 int numParticles;
 struct Particle* ParticleArray;
 
+struct Memory* GameMemory;      // entities, particles and the map live in its level arena
+
+// Zeroed level memory, from the heap if the arena is full; released as a whole when the level ends
+void* levelAlloc(size_t count, size_t size)
+{
+    void* pointer = GameMemory ? callocArena(&GameMemory->Level, count, size) : NULL;
+
+    return pointer ? pointer : calloc(count, size);
+}
+
 #define maxParticles    1000
 
 int initParticleArray()
 {
     numParticles = 0;
-    ParticleArray = calloc(maxParticles, sizeof(struct Particle));
+    ParticleArray = levelAlloc(maxParticles, sizeof(struct Particle));
 
     if (ParticleArray == NULL)
     {
-        printf("calloc() failed for ParticleArray\n");
+        printf("levelAlloc() failed for ParticleArray\n");
         return 1;
     }
 
@@ -407,9 +417,8 @@ void killParticle(int index)
     }
 }
 
-void renderParticles(SDL_Renderer* renderer, struct Board* board_)
+void doParticles(struct Board* board_)
 {
-    uint8_t newColor[3];
     struct Particle* p;
 
     for (int i = 0; i < numParticles; i++)
@@ -426,35 +435,63 @@ void renderParticles(SDL_Renderer* renderer, struct Board* board_)
 
             addVec2(p->velocity, p->velChange);
             addVec2(p->origin, p->velocity);
-
-            for (int c = 0; c < 3; c++)
-                newColor[c] = (p->lifeLeft * p->color1[c] + (p->lifeTime - p->lifeLeft) * p->color2[c]) / p->lifeTime;
-
-            SDL_SetRenderDrawColor(renderer, colorArg3(newColor), 255);
-            SDL_RenderDrawPoint(renderer, (int)(p->origin.x) + camera2D_X, (int)(p->origin.y) + camera2D_Y);
         }
         else
             killParticle(i);
     }
 }
 
+void renderParticles(SDL_Renderer* renderer)
+{
+    uint8_t newColor[3];
+    struct Particle* p;
+
+    for (int i = 0; i < numParticles; i++)
+    {
+        p = &(ParticleArray[i]);
+
+        for (int c = 0; c < 3; c++)
+            newColor[c] = (p->lifeLeft * p->color1[c] + (p->lifeTime - p->lifeLeft) * p->color2[c]) / p->lifeTime;
+
+        SDL_SetRenderDrawColor(renderer, colorArg3(newColor), 255);
+        SDL_RenderDrawPoint(renderer, (int)(p->origin.x) + camera2D_X, (int)(p->origin.y) + camera2D_Y);
+    }
+}
+
 void spawnFlame(struct Vec2 origin, struct Vec2 moveVector, float scale, float randomness, int life)
 {
     scaleVec2(moveVector, scale);
     struct Vec2 particleVelocity = moveVector;
-    addVec2(particleVelocity, randomVec2(0, randomness));
+    addVec2(particleVelocity, randomVec2(&RngArray[RNG_EFFECTS], 0, randomness));
     makeParticle(origin, particleVelocity, ZeroVec2, FIRE_COLOR1, FIRE_COLOR2, life);
 }
 
+#define SPAWN_BATCH 64
+
+// Speeds, directions and lifetimes are drawn a batch at a time, the directions turned into vectors in one go
 void spawnExplosion(struct Vec2 origin, struct Vec2 moveVector, int magnitude)
 {
+    struct Rng* Rng = &RngArray[RNG_EFFECTS];
     struct Vec2 particleVelocity;
+    float Speeds[SPAWN_BATCH], Angles[SPAWN_BATCH], Cos[SPAWN_BATCH], Sin[SPAWN_BATCH];
+    int Lives[SPAWN_BATCH];
+    int i, done, count;
 
-    for (int i = 0; i < magnitude; i++)
+    for (done = 0; done < magnitude; done += count)
     {
-        particleVelocity = moveVector;
-        addVec2(particleVelocity, randomVec2(magnitude/100.0, 0));
-        makeParticle(origin, particleVelocity, ZeroVec2, FIRE_COLOR1, FIRE_COLOR2, rand() % magnitude);
+        count = min(magnitude - done, SPAWN_BATCH);
+        fillRngFloats   (Rng, Speeds, count, magnitude/100.0, 0);
+        fillRngFloats   (Rng, Angles, count, 0, TWO_PI_F);
+        fillRngInts     (Rng, Lives,  count, magnitude);
+        sinCosBatch     (Angles, Cos, Sin, count);
+
+        for (i = 0; i < count; i++)
+        {
+            particleVelocity = moveVector;
+            particleVelocity.x += Speeds[i] * Cos[i];
+            particleVelocity.y += Speeds[i] * Sin[i];
+            makeParticle(origin, particleVelocity, ZeroVec2, FIRE_COLOR1, FIRE_COLOR2, Lives[i]);
+        }
     }
 }
 
@@ -496,6 +533,9 @@ struct Torque
 }
 TorqueDefault = {0, DEFAULT_MAX_ANGULAR_VELOCITY};
 
+uint16_t InputChannelArray[NUM_INPUT_CHANNELS];
+struct Vec2 InputAimArray[NUM_INPUT_CHANNELS];      // world position the mouse points at, so the simulation never sees the camera
+
 void typeSanityCheck()
 {
     short       shortType;
@@ -544,6 +584,8 @@ struct Control
 {
     uint8_t type, inputChannel;
     uint16_t commands;
+    uint16_t pressed;       // commands that went down this tick
+    uint8_t fireCooldown;   // ticks until it can fire again
 };
 
 struct AI
@@ -574,6 +616,17 @@ struct Visible
     uint16_t frame;
 };
 
+// A view of the world from an entity, into part of the screen
+struct Camera
+{
+    int         entityId;
+    float       angle;          // turned from the entity's facing, for side and rear views
+    SDL_Rect    Viewport;       // on the screen
+    float       fov;            // camera plane length, 0 for the config's
+    float       resolution;     // share of the render resolution it gets, 1 for all of it
+    float       bob;            // head bop, 0 to 1
+};
+
 enum COMPONENT_TYPES
 {
     TYPE_POSITION   = 1 << 1,
@@ -600,21 +653,90 @@ struct Control*     ControlArray;
 struct AI*          AIArray;
 struct Visible*     VisibleArray;
 struct Camera*      CameraArray;
+int                 numCameras = 1;
 
-void initArrays()
+// Everything that moves; nothing without all three of these components can
+#define BODY_MASK (TYPE_POSITION | TYPE_TRANSFORM | TYPE_VELOCITY)
+
+struct Bodies Bodies;
+
+void initBodies()
+{
+    Bodies.count         = 0;
+    Bodies.capacity      = MAX_ENTITIES;
+    Bodies.ids           = levelAlloc(MAX_ENTITIES, sizeof(int));
+    Bodies.rotational    = levelAlloc(MAX_ENTITIES, sizeof(float));
+    Bodies.rotX          = levelAlloc(MAX_ENTITIES, sizeof(float));
+    Bodies.rotY          = levelAlloc(MAX_ENTITIES, sizeof(float));
+    Bodies.forceX        = levelAlloc(MAX_ENTITIES, sizeof(float));
+    Bodies.forceY        = levelAlloc(MAX_ENTITIES, sizeof(float));
+    Bodies.velX          = levelAlloc(MAX_ENTITIES, sizeof(float));
+    Bodies.velY          = levelAlloc(MAX_ENTITIES, sizeof(float));
+    Bodies.maxVelSquared = levelAlloc(MAX_ENTITIES, sizeof(float));
+    Bodies.friction      = levelAlloc(MAX_ENTITIES, sizeof(float));
+    Bodies.transX        = levelAlloc(MAX_ENTITIES, sizeof(float));
+    Bodies.transY        = levelAlloc(MAX_ENTITIES, sizeof(float));
+}
+
+// Dense copy of the moving entities' components, rebuilt every tick since entities come and go
+void gatherBodies()
+{
+    int i, n = 0;
+
+    for (i = 0; i < entityCount; i++)
+    {
+        if ((EntityArray[i] & BODY_MASK) == BODY_MASK)
+        {
+            Bodies.ids          [n] = i;
+            Bodies.rotational   [n] = (EntityArray[i] & TYPE_CONTROL && ControlArray[i].type & CONTROL_ROTATIONAL) ? 1 : 0;
+            Bodies.rotX         [n] = RotationArray[i].x;
+            Bodies.rotY         [n] = RotationArray[i].y;
+            Bodies.forceX       [n] = ForceArray[i].x;
+            Bodies.forceY       [n] = ForceArray[i].y;
+            Bodies.velX         [n] = VelocityArray[i].x;
+            Bodies.velY         [n] = VelocityArray[i].y;
+            Bodies.maxVelSquared[n] = VelocityArray[i].maxVelSquared;
+            Bodies.friction     [n] = VelocityArray[i].friction;
+            n++;
+        }
+    }
+
+    Bodies.count = n;
+}
+
+void scatterBodies(int begin, int end)
 {
-    EntityArray     = calloc(MAX_ENTITIES, sizeof(uint16_t));
-    PositionArray   = calloc(MAX_ENTITIES, sizeof(struct Vec2));
-    TransformArray  = calloc(MAX_ENTITIES, sizeof(struct Vec2));
-    VelocityArray   = calloc(MAX_ENTITIES, sizeof(struct Velocity));
-    RotationArray   = calloc(MAX_ENTITIES, sizeof(struct Rotation));
-    ForceArray      = calloc(MAX_ENTITIES, sizeof(struct Force));
-    TorqueArray     = calloc(MAX_ENTITIES, sizeof(struct Torque));
-    CollidableArray = calloc(MAX_ENTITIES, sizeof(struct Collidable));
-    ControlArray    = calloc(MAX_ENTITIES, sizeof(struct Control));
-    AIArray         = calloc(MAX_ENTITIES, sizeof(struct AI));
-    VisibleArray    = calloc(MAX_ENTITIES, sizeof(struct Visible));
+    int i, id;
+
+    for (i = begin; i < end; i++)
+    {
+        id = Bodies.ids[i];
+        VelocityArray [id].x = Bodies.velX  [i];
+        VelocityArray [id].y = Bodies.velY  [i];
+        TransformArray[id].x = Bodies.transX[i];
+        TransformArray[id].y = Bodies.transY[i];
+    }
+}
 
+void initArrays()
+{
+    EntityArray     = levelAlloc(MAX_ENTITIES, sizeof(uint64_t));
+    PositionArray   = levelAlloc(MAX_ENTITIES, sizeof(struct Vec2));
+    TransformArray  = levelAlloc(MAX_ENTITIES, sizeof(struct Vec2));
+    VelocityArray   = levelAlloc(MAX_ENTITIES, sizeof(struct Velocity));
+    RotationArray   = levelAlloc(MAX_ENTITIES, sizeof(struct Rotation));
+    ForceArray      = levelAlloc(MAX_ENTITIES, sizeof(struct Force));
+    TorqueArray     = levelAlloc(MAX_ENTITIES, sizeof(struct Torque));
+    CollidableArray = levelAlloc(MAX_ENTITIES, sizeof(struct Collidable));
+    ControlArray    = levelAlloc(MAX_ENTITIES, sizeof(struct Control));
+    AIArray         = levelAlloc(MAX_ENTITIES, sizeof(struct AI));
+    VisibleArray    = levelAlloc(MAX_ENTITIES, sizeof(struct Visible));
+    CameraArray     = levelAlloc(MAX_VIEWS,    sizeof(struct Camera));
+
+    for (int i = 0; i < MAX_VIEWS; i++)
+        CameraArray[i].resolution = 1;
+
+    initBodies();
     initParticleArray();
 }
 
@@ -671,8 +793,8 @@ void renderCrosshair(SDL_Renderer* renderer_, int i)
 
     if (ControlArray[i].type & CONTROL_MOUSELOOK)
     {
-        crosshairX = mouseX/RES_SCALE;
-        crosshairY = mouseY/RES_SCALE;
+        crosshairX = mouseX;
+        crosshairY = mouseY;
     }
     else
     {
@@ -687,75 +809,43 @@ void renderCrosshair(SDL_Renderer* renderer_, int i)
     SDL_RenderDrawLine(renderer_, crosshairX, crosshairY+gap, crosshairX, crosshairY+length+gap);
 }
 
-void doVelocity()
-{
-    int i;
-    float angle, excessVel, excessVelSquared;
-    struct Vec2 friction = ZeroVec2;
-
-    for (i = 0; i < entityCount; i++)
-    {
-        if (EntityArray[i] & TYPE_VELOCITY)
-        {
-            if (EntityArray[i] & TYPE_CONTROL && ControlArray[i].type & CONTROL_ROTATIONAL)
-            {
-                VelocityArray[i].x += RotationArray[i].x * -(ForceArray[i].y) + RotationArray[i].y * -(ForceArray[i].x);
-                VelocityArray[i].y += RotationArray[i].y * -(ForceArray[i].y) + RotationArray[i].x * ForceArray[i].x;
-            }
-            else
-            {
-                VelocityArray[i].x += ForceArray[i].x;
-                VelocityArray[i].y += ForceArray[i].y;
-            }
-
-            if (VelocityArray[i].x || VelocityArray[i].y)
-            {
-                angle            = getVec2Angle(VelocityArray[i]);
-                friction         = newVec2(VelocityArray[i].friction, angle);
-                excessVelSquared = pow(VelocityArray[i].x, 2) + pow(VelocityArray[i].y, 2) - VelocityArray[i].maxVelSquared;
-
-                if (excessVelSquared > 0)
-                {
-                    excessVel = sqrt(excessVelSquared);
-                    addVec2(friction, newVec2(excessVel, angle));
-                }
-
-                subtractVec2(VelocityArray[i], friction);
-
-                if (fabs(VelocityArray[i].x) < fabs(friction.x))
-                    VelocityArray[i].x = 0;
-
-                if (fabs(VelocityArray[i].y) < fabs(friction.y))
-                    VelocityArray[i].y = 0;
-            }
-        }
-    }
-}
-
+// Angles are updated first, then every direction vector is rebuilt in one sinCosBatch() call
 void doRotationAndTorque()
 {
-    int i;
+    static int   Ids   [MAX_ENTITIES];
+    static float Angles[MAX_ENTITIES];
+    static float Cos   [MAX_ENTITIES];
+    static float Sin   [MAX_ENTITIES];
+    int i, count = 0;
 
     for (i = 0; i < entityCount; i++)
     {
         if (EntityArray[i] & TYPE_ROTATION)
         {
-            if (ControlArray[i].type & CONTROL_MOUSELOOK && i == playerId)   // were not even checking if the entity has control tho, also reading mouse input shouldnt be here
+            if (ControlArray[i].type & CONTROL_MOUSELOOK)   // were not even checking if the entity has control tho, also reading mouse input shouldnt be here
             {
                 RotationArray[i].angle = getVec2Angle(((struct Vec2)
                 {
-                    mouseX/RES_SCALE - camera2D_X - PositionArray[i].x,
-                    -(mouseY/RES_SCALE - camera2D_Y - PositionArray[i].y)
+                    InputAimArray[ControlArray[i].inputChannel].x - PositionArray[i].x,
+                    -(InputAimArray[ControlArray[i].inputChannel].y - PositionArray[i].y)
                 }));
             }
             else if (EntityArray[i] & TYPE_TORQUE)
                 RotationArray[i].angle += TorqueArray[i].angVel;
 
-            //RotationArray[i].x      =  cos(RotationArray[i].angle);
-            //RotationArray[i].y      = -sin(RotationArray[i].angle);
-            setVec2Angle(RotationArray[i], RotationArray[i].angle);
+            Ids   [count] = i;
+            Angles[count] = RotationArray[i].angle;
+            count++;
         }
     }
+
+    sinCosBatch(Angles, Cos, Sin, count);
+
+    for (i = 0; i < count; i++)
+    {
+        RotationArray[Ids[i]].x =  Cos[i];
+        RotationArray[Ids[i]].y = -Sin[i];
+    }
 }
 
 uint8_t collisionTestTileX(struct Board* board_, float x, float y, uint8_t dirX)
@@ -845,12 +935,13 @@ uint8_t collideTile(struct Board* board_, int i)
 
 void doCollidable(struct Board* board_)
 {
-    uint16_t componentMask = TYPE_COLLIDABLE | TYPE_TRANSFORM;
-    int i, collision;
+    int i, j, collision;
 
-    for (i = 0; i < entityCount; i++)
+    for (j = 0; j < Bodies.count; j++)
     {
-        if ((EntityArray[i] & componentMask) == componentMask && (TransformArray[i].x || TransformArray[i].y))
+        i = Bodies.ids[j];
+
+        if (EntityArray[i] & TYPE_COLLIDABLE && (TransformArray[i].x || TransformArray[i].y))
         {
             CollidableArray[i].collision = 0;
 
@@ -870,33 +961,12 @@ void doCollidable(struct Board* board_)
     }
 }
 
-void doTransform()
-{
-    uint16_t componentMask = TYPE_TRANSFORM | TYPE_VELOCITY;
-    int i;
-
-    for (i = 0; i < entityCount; i++)
-    {
-        if ((EntityArray[i] & componentMask) == componentMask)
-        {
-            if (PHYS_SCALE == 1)
-                setVec2(TransformArray[i], VelocityArray[i]);
-            else
-                scaleVec2(TransformArray[i], PHYS_SCALE);
-        }
-    }
-}
-
 void doPosition()
 {
-    uint16_t componentMask = TYPE_POSITION | TYPE_TRANSFORM;
     int i;
 
-    for (i = 0; i < entityCount; i++)
-    {
-        if ((EntityArray[i] & componentMask) == componentMask)
-            addVec2(PositionArray[i], TransformArray[i]);
-    }
+    for (i = 0; i < Bodies.count; i++)
+        addVec2(PositionArray[Bodies.ids[i]], TransformArray[Bodies.ids[i]]);
 }
 
 struct TileType
@@ -911,22 +981,24 @@ struct TileTypeArray
     struct TileType* TileTypes;
 };
 
-void loadTileTypes(FILE* mapData_, struct TileTypeArray* TileTypeArray_)
+// One type per line: symbol, graphic, flags, then optionally the wall's top and base in HEIGHT_STEPS.
+// Heights go by graphic, so types that share one share them too.
+void loadTileTypes(FILE* mapData_, struct TileTypeArray* TileTypeArray_, struct Board* board_)
 {
     long typeDataOffset;
-    int i, tileGfxId = 0;
+    int i, tileGfxId = 0, top, base;
     char buffer[BUFFER_SIZE];
     char tileFlags[TILE_FLAGS];
     uint8_t flagBits = 0;
     char* c;
 
-    fgetc(mapData_);
+    fgets(buffer, BUFFER_SIZE, mapData_);
     typeDataOffset = ftell(mapData_);
     TileTypeArray_->numTypes = 0;
 
     while (fgets(buffer, BUFFER_SIZE, mapData_) != NULL)
     {
-        if (buffer[0] == '\n')
+        if (buffer[0] == '\n' || buffer[0] == '\r')
             break;
         else
             TileTypeArray_->numTypes++;
@@ -938,8 +1010,11 @@ void loadTileTypes(FILE* mapData_, struct TileTypeArray* TileTypeArray_)
     for (i = 0; i < TileTypeArray_->numTypes; i++)
     {
         flagBits = 0;
+        top      = HEIGHT_STEPS;
+        base     = 0;
         memset(tileFlags, 0, TILE_FLAGS);
-        fscanf(mapData_, "%c %d %s\n", &(TileTypeArray_->TileTypes[i].symbol), &tileGfxId, tileFlags);
+        fgets(buffer, BUFFER_SIZE, mapData_);
+        sscanf(buffer, "%c %d %7s %d %d", &(TileTypeArray_->TileTypes[i].symbol), &tileGfxId, tileFlags, &top, &base);
 
         for (c = tileFlags; *c != '\0'; c++)
         {
@@ -951,16 +1026,36 @@ void loadTileTypes(FILE* mapData_, struct TileTypeArray* TileTypeArray_)
             case 'o':
                 flagBits |= TILE_OCCLUSION;
                 break;
+            case 'p':
+                flagBits |= TILE_PARTIAL_OCC;
+                break;
             case 'l':
                 flagBits |= TILE_LIQUID;
                 break;
+            case 't':
+                flagBits |= TILE_TOGGLE;
+                break;
+            case 'd':
+                flagBits |= TILE_BREAKABLE;
+                break;
             default:
                 break;
             }
         }
 
+        tileGfxId &= MAX_TILE_GRAPHICS-1;
         TileTypeArray_->TileTypes[i].data = (tileGfxId << TILE_FLAGS) + flagBits;
 
+        if (top < 1 || top > 255 || base < 0 || base >= top)
+        {
+            printf("Error - loadTileTypes() bad height %d %d for '%c'\n", top, base, TileTypeArray_->TileTypes[i].symbol);
+            top  = HEIGHT_STEPS;
+            base = 0;
+        }
+
+        board_->wallTop [tileGfxId] = top;
+        board_->wallBase[tileGfxId] = base;
+
         printf("Symbol: %c\t", TileTypeArray_->TileTypes[i].symbol);
         printf("Graphic: %d\t", TileTypeArray_->TileTypes[i].data >> TILE_FLAGS);
         printf("Flags: %d\n", (TileTypeArray_->TileTypes[i].data & ((1 << TILE_FLAGS)-1)));
@@ -998,11 +1093,13 @@ void loadTileMap(FILE* mapData_, struct TileTypeArray* TileTypeArray_, struct Bo
             putchar('\n');
             i--;
         }
+        else if (c == '\r')
+            i--;
         else
         {
             putchar(c);
             tileType = getTileType(c, TileTypeArray_);
-            board_->tileMap[i] = tileType;
+            writeTile(board_, i % board_->w, i / board_->w, tileType);
         }
     }
     putchar('\n');
@@ -1034,7 +1131,7 @@ void loadObjects(FILE* mapData_, struct Board* board_)
     }
 
     printf("Objects: %d\n", board_->numObjects);
-    board_->objects = calloc(board_->numObjects, sizeof(struct Object));
+    board_->objects = boardAlloc(board_, board_->numObjects * sizeof(struct Object));
     fseek(mapData_, objectDataOffset, SEEK_SET);
     i = 0;
 
@@ -1063,14 +1160,28 @@ void loadObjects(FILE* mapData_, struct Board* board_)
     }
 }
 
-struct Board* loadMap(char* filename)
+// memory is NULL for boards that don't belong to the level arena, e.g. hot reloads parsed on the watcher thread
+struct Board* loadMap(char* filename, struct Memory* memory)
 {
-    FILE* MapData                           = fopen(filename, "r");
-    struct Board* newBoard                  = calloc(1, sizeof(struct Board));
-    struct TileTypeArray* newTileTypeArray  = calloc(1, sizeof(struct TileTypeArray));
+    FILE* MapData;
+    struct Board* newBoard;
+    struct TileTypeArray* newTileTypeArray;
     char buffer[BUFFER_SIZE];
     char c;
 
+    if (isCompiledMap(filename))
+        return loadCompiledMap(filename, memory);
+
+    if ((MapData = fopen(filename, "r")) == NULL)
+    {
+        printf("Error - loadMap() could not open %s\n", filename);
+
+        return NULL;
+    }
+
+    newBoard         = createBoard(memory);
+    newTileTypeArray = calloc(1, sizeof(struct TileTypeArray));
+
     setColor(newBoard->wallColor,       WALL_COLOR);
     setColor(newBoard->floorColor,      FLOOR_COLOR);
     setColor(newBoard->ceilingColor,    CEILING_COLOR);
@@ -1091,6 +1202,8 @@ struct Board* loadMap(char* filename)
     newBoard->backgroundBottom        = BACKGROUND_BOTTOM;
     newBoard->tileSize                = TILE_SIZE;
     newBoard->texSize                 = TEX_SIZE;
+    memset(newBoard->wallTop,  HEIGHT_STEPS, MAX_TILE_GRAPHICS);
+    memset(newBoard->wallBase, 0,            MAX_TILE_GRAPHICS);
 
     while ((c = fgetc(MapData)) != EOF)
     {
@@ -1148,13 +1261,12 @@ struct Board* loadMap(char* filename)
             else if (!strcmp(buffer, "tilesize"))
                 fscanf(MapData, "%d", &(newBoard->tileSize));
             else if (!strcmp(buffer, "tiletypes"))
-                loadTileTypes(MapData, newTileTypeArray);
+                loadTileTypes(MapData, newTileTypeArray, newBoard);
             else if (!strcmp(buffer, "mapsize") && newBoard->size == 0)
             {
                 fscanf(MapData, "%d %d", &(newBoard->w), &(newBoard->h));
                 newBoard->size = newBoard->w * newBoard->h;
-                newBoard->tileMap = malloc(sizeof(uint16_t) * newBoard->size);
-                newBoard->lightMap = malloc(sizeof(uint8_t) * newBoard->size);
+                allocChunks(newBoard, 1);
             }
             else if (!strcmp(buffer, "tilemap"))
                 loadTileMap(MapData, newTileTypeArray, newBoard);
@@ -1165,26 +1277,37 @@ struct Board* loadMap(char* filename)
 
     free(newTileTypeArray->TileTypes);
     free(newTileTypeArray);
-    //fclose(filename);
+    fclose(MapData);
+    buildVisibility(newBoard);
 
     return newBoard;
 }
 
+// lighting only adds to tiles inside the clip rect, so a region can be relit without touching its surroundings
+struct LightClip
+{
+    int minX, minY, maxX, maxY;
+}
+LightClip = {0, 0, INT_MAX, INT_MAX};
+
 int lightTile(struct Board* board_, int x, int y, int brightness, float dist, float range)
 {
     int newBrightness;
     uint16_t* tile;
 
+    if (!inBoard(board_, x, y))
+        return 1;
+
     tile = &(tileAt(board_, x, y));
 
-    if (((*tile) & TILE_LIT) == 0)
+    if (((*tile) & TILE_LIT) == 0 && x >= LightClip.minX && x < LightClip.maxX && y >= LightClip.minY && y < LightClip.maxY)
     {
-        newBrightness = board_->lightMap[y*board_->w + x] + ((range-dist) / range) * brightness;
+        newBrightness = lightAt(board_, x, y) + ((range-dist) / range) * brightness;
 
         if (newBrightness > maxLight)
             newBrightness = maxLight;
 
-        board_->lightMap[y*board_->w + x] = newBrightness;
+        lightAt(board_, x, y) = newBrightness;
         (*tile) |= TILE_LIT;
     }
 
@@ -1215,11 +1338,11 @@ void lightRay(struct Board* board_, int ax, int ay, int bx, int by, int brightne
 	{
 		for (i = 0; i <= dx_abs; i++)
 		{
-            if ((dist = sqrt(pow(ax-px, 2) + pow(ay-py, 2))) > range)
+            if ((dist = fastLength(ax-px, ay-py)) > range)
                 break;
             if (lightTile(board_, px, py, brightness, dist, range))
                 break;
-            if (((tileAt(board_, px+x_sign, py)) & TILE_OCCLUSION) && ((tileAt(board_, px, py+y_sign)) & TILE_OCCLUSION))
+            if (occludesAtSafe(board_, px+x_sign, py) && occludesAtSafe(board_, px, py+y_sign))
                 break;
 
 			y += dy_abs;
@@ -1236,11 +1359,11 @@ void lightRay(struct Board* board_, int ax, int ay, int bx, int by, int brightne
 	{
 		for (i = 0; i <= dy_abs; i++)
 		{
-            if ((dist = sqrt(pow(ax-px, 2) + pow(ay-py, 2))) > range)
+            if ((dist = fastLength(ax-px, ay-py)) > range)
                 break;
             if (lightTile(board_, px, py, brightness, dist, range))
                 break;
-            if (((tileAt(board_, px+x_sign, py)) & TILE_OCCLUSION) && ((tileAt(board_, px, py+y_sign)) & TILE_OCCLUSION))
+            if (occludesAtSafe(board_, px+x_sign, py) && occludesAtSafe(board_, px, py+y_sign))
                 break;
 
 			x += dx_abs;
@@ -1268,7 +1391,7 @@ void lightSpot(struct Board* board_, const int x, const int y, const int brightn
     {
         for (ix = minX; ix < maxX; ix++)
         {
-            board_->tileMap[iy*board_->w + ix] &= (~TILE_LIT);
+            tileAt(board_, ix, iy) &= (~TILE_LIT);
         }
     }
 
@@ -1291,7 +1414,12 @@ void lightBoard(struct Board* board_)
 {
     int i;
 
-    memset(board_->lightMap, minLight, board_->w*board_->h);
+    // streamed maps carry the light baked in when they were compiled
+    if (board_->Streamer)
+        return;
+
+    for (i = 0; i < board_->numChunks; i++)
+        memset(board_->chunkTable[i]->light, minLight, CHUNK_AREA);
 
     if (lightEnable)
     {
@@ -1301,15 +1429,124 @@ void lightBoard(struct Board* board_)
                 lightSpot(board_, board_->objects[i].x, board_->objects[i].y, board_->objects[i].brightness, board_->objects[i].range);
         }
     }
+    invalidateMapCacheAll(&MapCache);
 }
 
-uint16_t InputChannelArray[NUM_INPUT_CHANNELS];
+int lightReaches(struct Object* light, int minX, int minY, int maxX, int maxY)
+{
+    return light->type == OBJECT_LIGHT
+        && light->x + light->range > minX && light->x - light->range < maxX
+        && light->y + light->range > minY && light->y - light->range < maxY;
+}
+
+// Recompute the lightmap for tiles changed within [min, max). Every light that reaches the changed tiles
+// is recomputed in full, so the region grows to cover those lights; tiles outside it are left alone.
+void relightRegion(struct Board* board_, int minX, int minY, int maxX, int maxY)
+{
+    int i, x, y;
+    struct Object* light;
+    struct LightClip Region = {minX, minY, maxX, maxY};
+
+    if (board_->Streamer)
+        return;
+
+    for (i = 0; i < board_->numObjects; i++)
+    {
+        light = &board_->objects[i];
+
+        if (lightReaches(light, minX, minY, maxX, maxY))
+        {
+            Region.minX = min(Region.minX, light->x - light->range);
+            Region.minY = min(Region.minY, light->y - light->range);
+            Region.maxX = max(Region.maxX, light->x + light->range);
+            Region.maxY = max(Region.maxY, light->y + light->range);
+        }
+    }
+
+    Region.minX = max(Region.minX, 0);
+    Region.minY = max(Region.minY, 0);
+    Region.maxX = min(Region.maxX, board_->w);
+    Region.maxY = min(Region.maxY, board_->h);
+
+    for (y = Region.minY; y < Region.maxY; y++)
+    {
+        for (x = Region.minX; x < Region.maxX; x++)
+            lightAt(board_, x, y) = minLight;
+    }
+
+    if (lightEnable)
+    {
+        LightClip = Region;
+
+        for (i = 0; i < board_->numObjects; i++)
+        {
+            light = &board_->objects[i];
+
+            if (lightReaches(light, Region.minX, Region.minY, Region.maxX, Region.maxY))
+                lightSpot(board_, light->x, light->y, light->brightness, light->range);
+        }
+
+        LightClip = (struct LightClip){0, 0, INT_MAX, INT_MAX};
+    }
+
+    invalidateMapCache(&MapCache, Region.minX, Region.minY, Region.maxX, Region.maxY);
+}
 
-void getInput(uint8_t channel, uint8_t controlType)
+// Catches the light and the cached chunk textures up with the tick's setTile() calls; the occlusion bits are
+// up to date already. Light only changes where a tile started or stopped blocking it, and nearby changes share one
+// relight, so a door costs the lights that reach it. The others only need their texture redrawn.
+void applyTileChanges(struct Board* board_)
 {
-    SDL_Event event;
-    const uint8_t* keyState;
+    static struct TileChange Changes[MAX_TILE_CHANGES];
+    struct LightClip Region = {0, 0, 0, 0};
+    struct TileChange* Change;
+    int i, count, lost, relight = 0;
+
+    count = takeTileChanges(board_, Changes, &lost);
+
+    if (lost)   // more than a tick's worth of changes; cheaper to redo the lot
+    {
+        lightBoard(board_);
+        invalidateMapCacheAll(&MapCache);
+
+        return;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        Change = &Changes[i];
+
+        // streamed maps have their light baked in
+        if (board_->Streamer || ((Change->before ^ Change->after) & TILE_OCCLUSION) == 0)
+        {
+            invalidateMapCache(&MapCache, Change->x, Change->y, Change->x + 1, Change->y + 1);
+            continue;
+        }
+
+        if (relight && Change->x >= Region.minX - CHUNK_SIZE && Change->x < Region.maxX + CHUNK_SIZE
+                    && Change->y >= Region.minY - CHUNK_SIZE && Change->y < Region.maxY + CHUNK_SIZE)
+        {
+            Region.minX = min(Region.minX, Change->x);
+            Region.minY = min(Region.minY, Change->y);
+            Region.maxX = max(Region.maxX, Change->x + 1);
+            Region.maxY = max(Region.maxY, Change->y + 1);
+            continue;
+        }
+
+        if (relight)
+            relightRegion(board_, Region.minX, Region.minY, Region.maxX, Region.maxY);
+
+        Region  = (struct LightClip){Change->x, Change->y, Change->x + 1, Change->y + 1};
+        relight = 1;
+    }
 
+    if (relight)
+        relightRegion(board_, Region.minX, Region.minY, Region.maxX, Region.maxY);
+}
+
+// Keys come from System's Input, which has already polled the events this frame; Escape is handled there too
+void getInput(const uint8_t* keyState, uint8_t channel, uint8_t controlType)
+{
     uint8_t inputLeft   = 0;
     uint8_t inputRight  = 0;
     uint8_t inputUp     = 0;
@@ -1317,18 +1554,14 @@ void getInput(uint8_t channel, uint8_t controlType)
     uint8_t inputRun    = 0;
     uint8_t inputStrafe = 0;
     uint8_t inputFire   = 0;
+    uint8_t inputUse    = 0;
 
-    static uint8_t mouseLeftDown  = 0;
-    static uint8_t mouseRightDown = 0;
+    uint8_t mouseLeftDown;
+    uint8_t mouseRightDown;
+    uint32_t mouseButtons;
+    int x, y;
 
     InputChannelArray[channel] = 0;
-    keyState = SDL_GetKeyboardState(NULL);
-
-    if (keyState[SDL_SCANCODE_ESCAPE])
-    {
-        quit = 1;
-        return;
-    }
 
     // temporary camera/control switching function
 /*
@@ -1349,26 +1582,17 @@ void getInput(uint8_t channel, uint8_t controlType)
         playerId = 1;
     }
 */
-    while (SDL_PollEvent(&event) != 0)
-    {
-        if (event.type == SDL_MOUSEBUTTONDOWN)
-        {
-            if (event.button.button == SDL_BUTTON_LEFT)
-                mouseLeftDown = 1;
-            else if (event.button.button == SDL_BUTTON_RIGHT)
-                mouseRightDown = 1;
-        }
-        else if (event.type == SDL_MOUSEBUTTONUP)
-        {
-            if (event.button.button == SDL_BUTTON_LEFT)
-                mouseLeftDown = 0;
-            else if (event.button.button == SDL_BUTTON_RIGHT)
-                mouseRightDown = 0;
-        }
-    }
+    mouseButtons   = SDL_GetMouseState(&x, &y);
+    mouseLeftDown  = (mouseButtons & SDL_BUTTON(SDL_BUTTON_LEFT))  != 0;
+    mouseRightDown = (mouseButtons & SDL_BUTTON(SDL_BUTTON_RIGHT)) != 0;
 
+    // window pixels to the screen the 2D view is laid out on
     if (controlType & CONTROL_MOUSELOOK)
-        SDL_GetMouseState(&mouseX, &mouseY);
+    {
+        mouseX = x/resScale - screenX;
+        mouseY = y/resScale - screenY;
+        InputAimArray[channel] = (struct Vec2){mouseX - camera2D_X, mouseY - camera2D_Y};
+    }
 
     if (controlType & CONTROL_KEYBOARD)
     {
@@ -1379,6 +1603,7 @@ void getInput(uint8_t channel, uint8_t controlType)
         inputRun    |= keyState[SDL_SCANCODE_RSHIFT] | keyState[SDL_SCANCODE_LSHIFT];
         inputStrafe |= keyState[SDL_SCANCODE_RALT]   | keyState[SDL_SCANCODE_LALT]  | mouseRightDown;
         inputFire   |= keyState[SDL_SCANCODE_RCTRL]  | keyState[SDL_SCANCODE_LCTRL] | mouseLeftDown;
+        inputUse    |= keyState[SDL_SCANCODE_E]      | keyState[SDL_SCANCODE_SPACE];
     }
 
     if (inputUp)        InputChannelArray[channel] |= COMMAND_MOVE_UP;
@@ -1397,6 +1622,7 @@ void getInput(uint8_t channel, uint8_t controlType)
     }
 
     if (inputFire)      InputChannelArray[channel] |= COMMAND_FIRE;
+    if (inputUse)       InputChannelArray[channel] |= COMMAND_USE;
 }
 
 enum AI_STATE
@@ -1492,18 +1718,21 @@ void doControl()
 {
     int i;
     uint8_t channel;
+    uint16_t previous;
 
     for (i = 0; i < entityCount; i++)
     {
         if (EntityArray[i] & TYPE_CONTROL)
         {
-            channel = ControlArray[i].inputChannel;
+            channel  = ControlArray[i].inputChannel;
+            previous = ControlArray[i].commands;
 
             if (ControlArray[i].type & CONTROL_AI)
                 ControlArray[i].commands = AIArray[i].commands;
             else if (ControlArray[i].type & CONTROL_KEYBOARD)
                 ControlArray[i].commands = InputChannelArray[channel];
 
+            ControlArray[i].pressed = ControlArray[i].commands & ~previous;
             controlEntity(i);
         }
     }
@@ -1512,10 +1741,16 @@ void doControl()
 struct Vec2 shootRay(struct Board* board_, struct Vec2 origin, struct Vec2 direction)
 {
     struct Vec2 ray = origin;
+    int skip;
 
-    while (1)   // This will CRASH if it goes into infinity
+    while (1)   // terminates at the map edge at the latest, everything outside the board is solid
     {
-        if (tileAtPos(board_, ray.x, ray.y) & TILE_OBSTACLE)
+        if ((skip = emptyBlockSteps(board_, ray.x, ray.y, direction.x, direction.y, TILE_OBSTACLE)) > 0)
+        {
+            ray.x += direction.x * skip;
+            ray.y += direction.y * skip;
+        }
+        else if (tileAtPos(board_, ray.x, ray.y) & TILE_OBSTACLE)
             return ray;
 
         else
@@ -1523,650 +1758,2525 @@ struct Vec2 shootRay(struct Board* board_, struct Vec2 origin, struct Vec2 direc
     }
 }
 
-void raycast(struct Board* board_, int camId)
+void setBackgroundSrcRect(int w, int h)
 {
-    const int      halfScreenH       = screenHeight/2;
-    const int      floorTex_         = floorTex;
-    const int      ceilingTex_       = ceilingTex;
-    const int      wallTex_          = wallTex;                           // same
-    const int      lightEnable_      = lightEnable;                         // same
-    const int      wallFog_          = wallFog;
-    const int      floorFog_         = floorFog;
-    const int      ceilingFog_       = ceilingFog;
-    const int      backgroundTop_    = backgroundTop;
-    const int      backgroundBottom_ = backgroundBottom;
-    const int      backClipPlane_    = backClipPlane;
-    const int      drawDistance_     = drawDistance;
-    const int      underwater        = UNDERWATER;                           // dunno
-    const int      hRatio            = (screenWidth*halfTile)/DEFAULT_V_FOV; // /planeVert;    // should be calculated here
-    const int      debug2D           = 1;
-    const float    planeHorz         = DEFAULT_H_FOV;                        // camera property too
-    const float    planeVert         = DEFAULT_V_FOV;                        // same
-    const float    xInc              = 2.0/screenWidth;
-    const float    distInc           = 0.1;
-    const float    liquidWaveHeight  = LIQUID_WAVE_HEIGHT;
-    const float    liquidWaveWidth   = LIQUID_WAVE_WIDTH;
-    const float    liquidWaveSpeed   = LIQUID_WAVE_SPEED;
-    const struct   Vec2 CamPos       = PositionArray[camId];
-    const struct   Vec2 CamDir       = {RotationArray[camId].x, RotationArray[camId].y};
-    const struct   Vec2 CamPlane     = {-(CamDir.y)*planeHorz, (CamDir.x)*planeHorz};
-    const SDL_Rect ScreenRect        = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
-
-    int i, y, height, halfHeight, offset, bottom, alpha;
-    float x, z, zInc, dist;
-    static float zFactor;
-    uint16_t tileType;
-    struct Vec2 RayPos;
-    struct Vec2 RayDir;
-    struct Vec3 RayPos2;
-    SDL_Rect SrcRect, DstRect;
-
-    // headbop
-    if ((ForceArray[playerId].x || ForceArray[playerId].y) && zFactor < 1)
-        zFactor += BOP_Z_INC;
-    else if (zFactor > 0)
-    {
-        zFactor -= BOP_Z_INC;
-
-        if (zFactor < BOP_Z_INC)
-            zFactor = 0;
-    }
-
-    if (zFactor)
-        z = zFactor * sin(degToRad((int)(tick * BOP_SPEED) % 360)) * BOP_HEIGHT;
-    else
-        z = 0;
-
+    BackgroundSrcRect.x = 0;
+    BackgroundSrcRect.w = w / 4;
+    BackgroundSrcRect.y = (!backgroundTop && backgroundBottom) ? h/2 : 0;
+    BackgroundSrcRect.h = ( backgroundTop && backgroundBottom) ? h   : h/2;
+}
 
+void setBackgroundDstRect(int w, int h)
+{
+    BackgroundDstRect.x = 0;
+    BackgroundDstRect.w = w;
+    BackgroundDstRect.y = (!backgroundTop && backgroundBottom) ? h/2 : 0;
+    BackgroundDstRect.h = ( backgroundTop && backgroundBottom) ? h   : h/2;
+}
 
+// wall hits of the first view, in 2D view coordinates, for the minimap
+#define MAX_RAY_HITS 2048
+SDL_Point RayHits[MAX_RAY_HITS];
+int numRayHits;
 
+#define MAX_COLUMN_HITS 8      // walls one column can show through see-through tiles and over low walls
 
-    // Floors & ceiling
-    SDL_SetRenderTarget       (Renderer3D, NULL);
-    SDL_SetRenderDrawBlendMode(Renderer3D, SDL_BLENDMODE_NONE);
-    setVec2(RayDir, CamDir);
+// A wall as one screen column sees it, already clipped by the walls in front
+struct ColumnHit
+{
+    uint16_t    tile;
+    int         top, bottom;
+    int         floorY, scale;      // screen row of the floor under it, and pixels per tile of height
+    int         texX;
+    uint8_t     light, fog;
+};
 
-    if (wallFog_)
+// Opaque walls are lit and fogged with lines over them, as before; see-through ones would darken and fog
+// whatever shows through that way, so they take the light as a color mod and fade out into the fog instead
+void drawColumnHit(struct Board* board_, struct ColumnHit* Hit, int i, int wallTex_)
+{
+    const int seeThrough = !(Hit->tile & TILE_OCCLUSION);
+    const int gfxY       = texSize * (Hit->tile >> TILE_FLAGS);
+    int layer, y0, y1, srcTop, srcSpan;
+    float layerY;
+    SDL_Rect SrcRect = {Hit->texX, 0, 1, 0};
+    SDL_Rect DstRect = {i, 0, 1, 0};
+
+    if (!wallTex_)
     {
-        SDL_SetRenderDrawColor(Renderer3D, colorArg3(board_->fogColor), 255);
-        SDL_RenderClear       (Renderer3D);
+        SDL_SetRenderDrawBlendMode(Renderer, seeThrough ? SDL_BLENDMODE_BLEND : SDL_BLENDMODE_NONE);
+        SDL_SetRenderDrawColor    (Renderer, colorArg3(board_->wallColor), seeThrough ? 128 : 255);
+        SDL_RenderDrawLine        (Renderer, i, Hit->top, i, Hit->bottom-1);
     }
-    else if (backClipPlane_)
+    else
     {
-        SDL_SetRenderDrawColor(Renderer3D, colorArg4(RGBA_BLACK));
-        SDL_RenderClear       (Renderer3D);
-    }
-
+        srcTop  = 0;
+        srcSpan = texSize;
 
+        if (Hit->tile & TILE_LIQUID)
+        {
+            srcTop  = sinDeg(tick * LIQUID_WAVE_SPEED + Hit->texX * LIQUID_WAVE_WIDTH) * LIQUID_WAVE_HEIGHT + LIQUID_WAVE_HEIGHT;
+            srcSpan = texSize - (LIQUID_WAVE_HEIGHT * 2);
+        }
 
-#define CORRECTION -1
-
-    // Background
-    if (backgroundTop_ || backgroundBottom_)
-    {
-        float bgX;
-        int bgAngle = radToDeg(RotationArray[camId].angle);
-        if (bgAngle < 0) bgAngle + 360;
-        bgAngle = bgAngle % 360;
+        if (seeThrough)
+        {
+            SDL_SetTextureColorMod(AtlasTexture, Hit->light, Hit->light, Hit->light);
+            SDL_SetTextureAlphaMod(AtlasTexture, 255 - Hit->fog);
+        }
 
-        for (i = 0; i < 4; i++)
+        // one copy per tile of height, since the texture doesn't repeat by itself
+        for (layer = max(0, (Hit->floorY - Hit->bottom) / Hit->scale); Hit->floorY - layer*Hit->scale > Hit->top; layer++)
         {
-            bgX = (((unsigned)(bgAngle + (i*90)) % 360) / 360.0) - 0.25;
-            BackgroundSrcRect.x = i * BackgroundSrcRect.w;
-            BackgroundDstRect.x = bgX * (screenWidth * 4);
+            layerY = Hit->floorY - (layer+1)*Hit->scale;
+            y0     = max(Hit->top,    (int)layerY);
+            y1     = min(Hit->bottom, (int)layerY + Hit->scale);
 
-            if (BackgroundDstRect.x >= screenWidth || BackgroundDstRect.x <= -screenWidth)
+            if (y1 <= y0)
                 continue;
 
-            SDL_RenderCopy(Renderer3D, BackgroundTexture, &BackgroundSrcRect, &BackgroundDstRect);
+            SrcRect.y = min(srcSpan-1, (int)((y0 - layerY) * srcSpan / Hit->scale));
+            SrcRect.h = max(1, (int)((y1 - layerY) * srcSpan / Hit->scale) - SrcRect.y);
+            SrcRect.y += gfxY + srcTop;
+            DstRect.y = y0;
+            DstRect.h = y1 - y0;
+
+            SDL_RenderCopy(Renderer, AtlasTexture, &SrcRect, &DstRect);
         }
-    }
 
+        if (seeThrough)
+        {
+            SDL_SetTextureColorMod(AtlasTexture, 255, 255, 255);
+            SDL_SetTextureAlphaMod(AtlasTexture, 255);
+            return;
+        }
+    }
 
+    if (Hit->light < 255 && !seeThrough)
+    {
+        SDL_SetRenderDrawBlendMode(Renderer, SDL_BLENDMODE_MOD);
+        SDL_SetRenderDrawColor    (Renderer, Hit->light, Hit->light, Hit->light, 255);
+        SDL_RenderDrawLine        (Renderer, i, Hit->top, i, Hit->bottom-1);
+    }
 
+    if (Hit->fog && !seeThrough)
+    {
+        SDL_SetRenderDrawBlendMode(Renderer, FogBlendMode);
+        SDL_SetRenderDrawColor    (Renderer, colorArg3(board_->fogColor), Hit->fog);
+        SDL_RenderDrawLine        (Renderer, i, Hit->top, i, Hit->bottom-1);
+    }
+}
 
-    // Floor
-    setVec2(RayPos2, CamPos);
+struct FloorSample
+{
+    int16_t     srcX, srcY;         // texel in the atlas; srcX is -1 where a wall stands on that bit of floor
+    uint8_t     light;
+};
 
-    for (y = 1; y <= halfScreenH; y++)
+// One camera's frame. The jobs walk its rays into here, then drawView() turns it into draw calls on the main
+// thread, since the renderer can't be used from the others. Sized for the whole screen at full resolution.
+struct View
+{
+    struct Board*       Board;
+    struct Camera*      Camera;
+    SDL_Rect            Rect;               // where it renders in Frame3D
+    struct Vec2         Pos, Dir, Plane;
+    float               angle, z;           // facing in radians, head bop
+    int                 hRatio, maxTop, rows;
+    struct ColumnHit*   Hits;               // MAX_COLUMN_HITS per column
+    uint8_t*            numHits;
+    SDL_Point*          FirstHit;           // per column, for the minimap; x is INT_MIN where nothing was hit
+    float*              floorDist;          // per row under the horizon, 0 where the floor is out of reach
+    float*              ceilingDist;        // per row over it, likewise
+    struct FloorSample* Floor;              // per row under the horizon, per column
+    uint8_t             clearIndex, floorIndex, ceilingIndex, wallIndex;   // the board's flat colors, for the 8-bit path
+};
+
+// Graph resources of the render jobs, three per view
+#define VIEW_HITS(i)                    (1 << (3*(i)))
+#define VIEW_FLOOR(i)                   (1 << (3*(i)+1))
+#define VIEW_PIXELS(i)                  (1 << (3*(i)+2))
+
+struct JobScheduler Scheduler;
+struct View Views[MAX_VIEWS];
+struct JobGraph RenderGraph;
+
+void freeViews()
+{
+    int i;
+
+    for (i = 0; i < MAX_VIEWS; i++)
+    {
+        free(Views[i].Hits);
+        free(Views[i].numHits);
+        free(Views[i].FirstHit);
+        free(Views[i].floorDist);
+        free(Views[i].ceilingDist);
+        free(Views[i].Floor);
+        memset(&Views[i], 0, sizeof(struct View));
+    }
+}
+
+void createViews()
+{
+    const int rows = screenHeight/2 + 1;
+    int i;
+
+    freeViews();
+
+    for (i = 0; i < MAX_VIEWS; i++)
+    {
+        Views[i].Hits        = malloc(screenWidth * MAX_COLUMN_HITS * sizeof(struct ColumnHit));
+        Views[i].numHits     = malloc(screenWidth * sizeof(uint8_t));
+        Views[i].FirstHit    = malloc(screenWidth * sizeof(SDL_Point));
+        Views[i].floorDist   = malloc(rows * sizeof(float));
+        Views[i].ceilingDist = malloc(rows * sizeof(float));
+        Views[i].Floor       = malloc(rows * screenWidth * sizeof(struct FloorSample));
+    }
+}
+
+// One view fills the screen, two split it side by side, three or four take a quarter each. The first camera
+// follows the player and the others the other players in entity order; past those, the player looking behind
+// and to the sides.
+void layoutCameras(int count)
+{
+    const int halfW = screenWidth/2;
+    const int halfH = screenHeight/2;
+    int i, e = -1;
+    struct Camera* Cam;
+
+    for (i = 0; i < count; i++)
+    {
+        Cam           = &CameraArray[i];
+        Cam->entityId = cameraId;
+        Cam->angle    = 0;
+
+        if (count == 1)
+            Cam->Viewport = (SDL_Rect){0, 0, screenWidth, screenHeight};
+        else if (count == 2)
+            Cam->Viewport = (SDL_Rect){i * halfW, 0, halfW, screenHeight};
+        else
+            Cam->Viewport = (SDL_Rect){(i % 2) * halfW, (i / 2) * halfH, halfW, halfH};
+
+        if (i == 0)
+            continue;
+
+        for (e++; e < entityCount && (e == cameraId || !(EntityArray[e] & TYPE_CONTROL)); e++);
+
+        if (e < entityCount)
+            Cam->entityId = e;
+        else
+            Cam->angle = i * TWO_PI_F / count;
+    }
+}
+
+float bopCamera(struct Camera* Cam)
+{
+    const int id = Cam->entityId;
+
+    if ((ForceArray[id].x || ForceArray[id].y) && Cam->bob < 1)
+        Cam->bob += BOP_Z_INC;
+    else if (Cam->bob > 0)
+    {
+        Cam->bob -= BOP_Z_INC;
+
+        if (Cam->bob < BOP_Z_INC)
+            Cam->bob = 0;
+    }
+
+    if (Cam->bob)
+        return Cam->bob * sinDeg(tick * BOP_SPEED) * BOP_HEIGHT;
+    else
+        return 0;
+}
+
+void setupView(struct View* View, struct Board* board_, struct Camera* Cam)
+{
+    const float resolution  = max(0.1f, min(Cam->resolution, 1.0f));
+    const float planeLength = Cam->fov > 0 ? Cam->fov : fov;
+    const int   id          = Cam->entityId;
+    int h;
+
+    View->Board  = board_;
+    View->Camera = Cam;
+    View->Rect.x = Cam->Viewport.x * ResScaler.renderWidth  / screenWidth;
+    View->Rect.y = Cam->Viewport.y * ResScaler.renderHeight / screenHeight;
+    View->Rect.w = max(1, (int)(Cam->Viewport.w * ResScaler.renderWidth  / screenWidth  * resolution));
+    View->Rect.h = max(2, (int)(Cam->Viewport.h * ResScaler.renderHeight / screenHeight * resolution));
+    View->rows   = View->Rect.h/2;
+    View->Pos    = PositionArray[id];
+    View->angle  = RotationArray[id].angle + Cam->angle;
+    View->z      = bopCamera(Cam);
+    View->hRatio = (Cam->Viewport.w*halfTile)/planeLength * View->Rect.h/Cam->Viewport.h;
+
+    if (Cam->angle)
+        setVec2Angle(View->Dir, View->angle);
+    else
+        View->Dir = (struct Vec2){RotationArray[id].x, RotationArray[id].y};
+
+    View->Plane  = (struct Vec2){-(View->Dir.y)*planeLength, (View->Dir.x)*planeLength};
+    View->maxTop = 0;
+
+    View->clearIndex   = wallFog ? nearestIndex(&Palette, colorArg3(board_->fogColor)) : nearestIndex(&Palette, 0, 0, 0);
+    View->floorIndex   = nearestIndex(&Palette, colorArg3(board_->floorColor));
+    View->ceilingIndex = nearestIndex(&Palette, colorArg3(board_->ceilingColor));
+    View->wallIndex    = nearestIndex(&Palette, colorArg3(board_->wallColor));
+
+    for (h = 0; h < MAX_TILE_GRAPHICS; h++)
+        View->maxTop = max(View->maxTop, board_->wallTop[h]);
+}
+
+// Walls; each column is walked front to back, clipping each wall to what the ones in front left open, until
+// nothing is. Only reads the board, so the columns of every view can go at once.
+void wallJob(void* data, int begin, int end)
+{
+    struct View*   View          = data;
+    struct Board*  board_        = View->Board;
+    const int      halfScreenH   = View->Rect.h/2;
+    const int      lightEnable_  = lightEnable;
+    const int      wallFog_      = wallFog;
+    const int      drawDistance_ = drawDistance;
+    const int      underwater    = UNDERWATER;
+    const int      hRatio        = View->hRatio;
+    const float    xInc          = 2.0/View->Rect.w;
+    const float    distInc       = 0.1;
+    const float    z             = View->z;
+
+    int i, height, offset, skip, top, base;
+    int numHits, clipTop, clipBottom, wallTop, wallBottom, tileX, tileY, lastX, lastY;
+    float x, dist;
+    uint16_t tileType;
+    struct ColumnHit* Hits;
+    struct ColumnHit* Hit;
+    struct Vec2 RayPos;
+    struct Vec2 RayDir;
+
+    for (i = begin; i < end; i++)
+    {
+        x          = -1 + i*xInc;
+        Hits       = &View->Hits[i * MAX_COLUMN_HITS];
+        RayPos     = View->Pos;
+        RayDir     = (struct Vec2){(View->Dir.x + x*View->Plane.x)*distInc, (View->Dir.y + x*View->Plane.y)*distInc};
+        dist       = 0;
+        numHits    = 0;
+        clipTop    = 0;
+        clipBottom = View->Rect.h;
+        lastX      = lastY = INT_MIN;
+
+        View->FirstHit[i].x = INT_MIN;
+
+        while (dist < drawDistance_ && clipTop < clipBottom && numHits < MAX_COLUMN_HITS)
+        {
+            // cross empty 8x8 blocks in one go, on the same sample lattice as single steps
+            if ((skip = emptyBlockSteps(board_, RayPos.x, RayPos.y, RayDir.x, RayDir.y, TILE_PARTIAL_OCC)) > 0)
+            {
+                skip     = min(skip, (int)((drawDistance_ - dist) / distInc));
+                RayPos.x += RayDir.x * skip;
+                RayPos.y += RayDir.y * skip;
+                dist     += distInc  * skip;
+            }
+
+            addVec2(RayPos, RayDir);
+            dist += distInc;
+
+            if (!wallAtPos(board_, RayPos.x, RayPos.y))
+                continue;
+
+            // a tile counts once, at the face the ray went in by
+            tileX = (int)floorf(RayPos.x / tileSize);
+            tileY = (int)floorf(RayPos.y / tileSize);
+
+            if (tileX == lastX && tileY == lastY)
+                continue;
+
+            lastX    = tileX;
+            lastY    = tileY;
+            tileType = tileAtPos(board_, RayPos.x, RayPos.y);
+
+            if (View->FirstHit[i].x == INT_MIN)
+                View->FirstHit[i] = (SDL_Point){camera2D_X+RayPos.x, camera2D_Y+RayPos.y};
+
+            height = (int)(hRatio/dist) & ~1;
+            offset = z * (((hRatio)/dist)/tileSize);
+
+            if (underwater)
+                offset += sinDeg((int)(i + tick*WAVE_SPEED + View->angle) * WAVE_WIDTH) * WAVE_HEIGHT;
+
+            // off the map and unloaded chunks are full height whatever graphic 0 is
+            if (tileType == TILE_SOLID)
+            {
+                top  = View->maxTop;
+                base = 0;
+            }
+            else
+            {
+                top  = board_->wallTop [tileType >> TILE_FLAGS];
+                base = board_->wallBase[tileType >> TILE_FLAGS];
+            }
+
+            wallTop    = halfScreenH + height/2 + offset - height * top  / HEIGHT_STEPS;
+            wallBottom = halfScreenH + height/2 + offset - height * base / HEIGHT_STEPS;
+
+            Hit         = &Hits[numHits];
+            Hit->tile   = tileType;
+            Hit->floorY = halfScreenH + height/2 + offset;
+            Hit->scale  = height;
+            Hit->top    = max(clipTop,    wallTop);
+            Hit->bottom = min(clipBottom, wallBottom);
+
+            // what's behind an opaque wall is nearer the horizon; one that stands on the floor hides everything
+            // below its top, and one as tall as the tallest hides everything above its base
+            if (tileType & TILE_OCCLUSION)
+            {
+                if (base == 0)
+                    clipBottom = min(clipBottom, max(wallTop, clipTop));
+
+                if (top >= View->maxTop)
+                    clipTop = max(clipTop, min(wallBottom, clipBottom));
+            }
+
+            if (Hit->top >= Hit->bottom)
+                continue;
+
+            Hit->texX  = (int)((((float)(RayPos.x + RayPos.y)) / tileSize) * texSize) % texSize;
+            Hit->light = 255;
+            Hit->fog   = 0;
+
+            if (lightEnable_)
+                Hit->light = lightAtPos(board_, RayPos.x - RayDir.x, RayPos.y - RayDir.y);
+
+            if (wallFog_)
+                Hit->fog = min(255, (int)(255 * (dist/board_->fogDistance)));
+
+            numHits++;
+        }
+
+        View->numHits[i] = numHits;
+    }
+}
+
+// Where each row under the horizon meets the floor, and what every column finds there; and where each row over
+// it meets the ceiling, which is flat, so a whole tile per step does
+void floorJob(void* data, int begin, int end)
+{
+    struct View*   View          = data;
+    struct Board*  board_        = View->Board;
+    const int      renderW       = View->Rect.w;
+    const int      floorTex_     = floorTex && floorEnable;
+    const int      drawDistance_ = drawDistance;
+    const int      halfScreenH   = View->Rect.h/2;
+    const float    xInc          = 2.0/renderW;
+
+    int i, y;
+    float x, zInc, dist;
+    uint16_t tileType;
+    struct FloorSample* Sample;
+    struct Vec2 RayPos;
+    struct Vec3 RayPos2;
+
+    for (y = begin+1; y <= end; y++)
     {
         dist        = 0;
-        setVec2(RayPos2, CamPos);
-        RayPos2.z   = halfTile+z;
-        zInc        = 1.5*((float)y/screenHeight);
+        setVec2(RayPos2, View->Pos);
+        RayPos2.z   = halfTile+View->z;
+        zInc        = 1.5*((float)y/View->Rect.h);
+
+        View->floorDist[y-1] = 0;
 
         while (dist < drawDistance_)
         {
             dist += 1               * 0.1;  // temp
             RayPos2.z -= zInc       * 0.1;
-            //addVec2(RayPos2, RayDir);
-            RayPos2.x += RayDir.x * 0.1;
-            RayPos2.y += RayDir.y * 0.1;
+            RayPos2.x += View->Dir.x * 0.1;
+            RayPos2.y += View->Dir.y * 0.1;
 
             if (RayPos2.z < 0)
             {
-                if (!backgroundBottom_)
+                View->floorDist[y-1] = dist;
+                break;
+            }
+        }
+
+        if (floorTex_ && View->floorDist[y-1])
+        {
+            Sample = &View->Floor[(y-1) * renderW];
+            x      = -1;
+
+            for (i = 0; i < renderW; i++)
+            {
+                RayPos.x = RayPos2.x + (View->Plane.x * dist * x);
+                RayPos.y = RayPos2.y + (View->Plane.y * dist * x);
+
+                tileType       = tileAtPos(board_, RayPos.x, RayPos.y);
+                Sample[i].srcX = -1;
+
+                if ((tileType & TILE_OCCLUSION) == 0)
+                {
+                    Sample[i].srcX  = (int)(RayPos.x * 4.0) % texSize;
+                    Sample[i].srcY  = (int)(RayPos.y * 4.0) % texSize + (texSize * (tileType >> TILE_FLAGS));
+                    Sample[i].light = lightAtPos(board_, RayPos.x, RayPos.y);
+                }
+
+                x += xInc;
+            }
+        }
+
+        // the ceiling has a row less
+        dist        = 0;
+        setVec2(RayPos2, View->Pos);
+        RayPos2.z   = halfTile+View->z;
+
+        View->ceilingDist[y-1] = 0;
+
+        while (y < halfScreenH && dist < drawDistance_)
+        {
+            dist += 1;
+            RayPos2.z += (float)y/halfScreenH;
+            addVec2(RayPos2, View->Dir);
+
+            if (RayPos2.z > tileSize)
+            {
+                View->ceilingDist[y-1] = dist;
+                break;
+            }
+        }
+    }
+}
+
+#define CORRECTION -1
+
+// Draws what the jobs found into the view's part of Frame3D; walls are drawn back to front, so see-through
+// ones land on top of what they show
+void drawView(struct View* View)
+{
+    struct Board*  board_            = View->Board;
+    const int      renderW           = View->Rect.w;
+    const int      renderH           = View->Rect.h;
+    const int      halfScreenH       = renderH/2;
+    const int      floorTex_         = floorTex && floorEnable;
+    const int      wallTex_          = wallTex;
+    const int      floorFog_         = floorFog;
+    const int      ceilingFog_       = ceilingFog;
+    const int      backgroundTop_    = backgroundTop;
+    const int      backgroundBottom_ = backgroundBottom;
+
+    int i, h, y, row, alpha;
+    float dist;
+    struct FloorSample* Sample;
+    struct ColumnHit* Hits;
+    SDL_Rect SrcRect = {0, 0, 1, 1};
+    SDL_Rect DstRect = {0, 0, 1, 1};
+
+    SDL_SetRenderTarget       (Renderer, Frame3D);
+    SDL_RenderSetViewport     (Renderer, &View->Rect);
+    SDL_SetRenderDrawBlendMode(Renderer, SDL_BLENDMODE_NONE);
+
+    // Background
+    if (backgroundTop_ || backgroundBottom_)
+    {
+        float bgX;
+        int bgAngle = radToDeg(View->angle);
+        setBackgroundDstRect(renderW, renderH);
+        if (bgAngle < 0) bgAngle + 360;
+        bgAngle = bgAngle % 360;
+
+        for (i = 0; i < 4; i++)
+        {
+            bgX = (((unsigned)(bgAngle + (i*90)) % 360) / 360.0) - 0.25;
+            BackgroundSrcRect.x = i * BackgroundSrcRect.w;
+            BackgroundDstRect.x = bgX * (renderW * 4);
+
+            if (BackgroundDstRect.x >= renderW || BackgroundDstRect.x <= -renderW)
+                continue;
+
+            SDL_RenderCopy(Renderer, BackgroundTexture, &BackgroundSrcRect, &BackgroundDstRect);
+        }
+    }
+
+    // Floor
+    for (y = 1; y <= halfScreenH; y++)
+    {
+        if (!(dist = View->floorDist[y-1]))
+            continue;
+
+        row = halfScreenH+(y-1)+CORRECTION;
+
+        if (!backgroundBottom_)
+        {
+            SDL_SetRenderDrawColor(Renderer, colorArg3(board_->floorColor), 255);
+            SDL_RenderDrawLine    (Renderer, 0, row, renderW-1, row);
+        }
+
+        if (floorTex_)
+        {
+            Sample = &View->Floor[(y-1) * renderW];
+
+            for (i = 0; i < renderW; i++)
+            {
+                if (Sample[i].srcX < 0)
+                    continue;
+
+                SrcRect.x = Sample[i].srcX;
+                SrcRect.y = Sample[i].srcY;
+                DstRect.x = i;
+                DstRect.y = row;
+
+                SDL_RenderCopy(Renderer, AtlasTexture, &SrcRect, &DstRect);
+                alpha = 255 - Sample[i].light;
+                SDL_SetRenderDrawColor(Renderer, 0, 0, 0, alpha);
+                SDL_RenderDrawPoint(Renderer, DstRect.x, DstRect.y);
+            }
+        }
+
+        if (floorFog_)
+        {
+            if ((alpha = 255 * (dist/board_->fogDistance)) > 255)
+                alpha = 255;
+
+            SDL_SetRenderDrawBlendMode(Renderer, SDL_BLENDMODE_BLEND);
+            SDL_SetRenderDrawColor(Renderer, colorArg3(board_->fogColor), alpha);
+            SDL_RenderDrawLine    (Renderer, 0, row, renderW-1, row);
+        }
+    }
+    SDL_SetRenderDrawBlendMode(Renderer, SDL_BLENDMODE_NONE);
+
+    // Ceiling
+    for (y = 1; y < halfScreenH; y++)
+    {
+        if (!(dist = View->ceilingDist[y-1]))
+            continue;
+
+        if ((alpha = 255 * (dist/board_->fogDistance)) > 255)
+            alpha = 255;
+
+        row = (halfScreenH-1)-(y-1)-CORRECTION;
+
+        if (!backgroundTop_)
+        {
+            SDL_SetRenderDrawColor(Renderer, colorArg3(board_->ceilingColor), 255);
+            SDL_RenderDrawLine    (Renderer, 0, row, renderW-1, row);
+        }
+
+        if (ceilingFog_)
+        {
+            SDL_SetRenderDrawBlendMode(Renderer, SDL_BLENDMODE_BLEND);
+            SDL_SetRenderDrawColor(Renderer, colorArg3(board_->fogColor), alpha);
+            SDL_RenderDrawLine    (Renderer, 0, row, renderW-1, row);
+        }
+    }
+    SDL_SetRenderDrawBlendMode(Renderer, SDL_BLENDMODE_NONE);
+
+    // Walls
+    if (wallTex_)
+    {
+        SDL_SetRenderTarget   (Renderer, OffScreen3D);
+        SDL_SetRenderDrawColor(Renderer, 0, 0, 0, 0);
+        SDL_RenderClear       (Renderer);
+        SDL_RenderSetViewport (Renderer, &View->Rect);
+    }
+
+    for (i = 0; i < renderW; i++)
+    {
+        Hits = &View->Hits[i * MAX_COLUMN_HITS];
+
+        for (h = View->numHits[i]-1; h >= 0; h--)
+            drawColumnHit(board_, &Hits[h], i, wallTex_);
+
+        SDL_SetRenderDrawBlendMode(Renderer, SDL_BLENDMODE_NONE);
+    }
+
+    if (wallTex_)
+    {
+        SDL_SetRenderTarget(Renderer, Frame3D);
+        SDL_RenderCopy     (Renderer, OffScreen3D, &View->Rect, &View->Rect);
+    }
+}
+
+// The 8-bit drawColumnHit(); light and fog go through the colormaps, see-through walls only let what's behind
+// show through their clear texels, and a flat one through every other row
+void drawColumnHit8(struct ColumnHit* Hit, uint8_t* column, int pitch, int wallTex_, uint8_t wallIndex)
+{
+    const int      seeThrough = !(Hit->tile & TILE_OCCLUSION);
+    const uint8_t* light      = Palette.Light[Hit->light >> COLORMAP_SHIFT];
+    const uint8_t* fog        = Palette.Fog  [Hit->fog   >> COLORMAP_SHIFT];
+    int y, layerY, srcY, srcTop, srcSpan, gfxY;
+    uint8_t texel;
+
+    if (!wallTex_)
+    {
+        for (y = Hit->top; y < Hit->bottom; y++)
+            if (!seeThrough || (y & 1))
+                column[y * pitch] = seeThrough ? wallIndex : fog[light[wallIndex]];
+
+        return;
+    }
+
+    srcTop  = 0;
+    srcSpan = texSize;
+
+    if (Hit->tile & TILE_LIQUID)
+    {
+        srcTop  = sinDeg(tick * LIQUID_WAVE_SPEED + Hit->texX * LIQUID_WAVE_WIDTH) * LIQUID_WAVE_HEIGHT + LIQUID_WAVE_HEIGHT;
+        srcSpan = texSize - (LIQUID_WAVE_HEIGHT * 2);
+    }
+
+    if ((gfxY = texSize * (Hit->tile >> TILE_FLAGS) + srcTop) + srcSpan > AtlasIndexed.h)
+        return;
+
+    // the texture repeats once per tile of height, counted up from the floor
+    for (y = Hit->top; y < Hit->bottom; y++)
+    {
+        layerY = Hit->floorY - ((Hit->floorY - y - 1) / Hit->scale + 1) * Hit->scale;
+        srcY   = min(srcSpan-1, (y - layerY) * srcSpan / Hit->scale);
+        texel  = AtlasIndexed.pixels[(gfxY + srcY) * AtlasIndexed.w + Hit->texX];
+
+        if (texel != PALETTE_CLEAR)
+            column[y * pitch] = fog[light[texel]];
+    }
+}
+
+// What drawView() does, a column at a time into Frame8, in the same order; no renderer involved, so the
+// views' columns are drawn on the job threads too
+void pixelJob(void* data, int begin, int end)
+{
+    struct View*   View              = data;
+    struct Board*  board_            = View->Board;
+    const int      pitch             = screenWidth;
+    const int      renderW           = View->Rect.w;
+    const int      renderH           = View->Rect.h;
+    const int      halfScreenH       = renderH/2;
+    const int      floorTex_         = floorTex && floorEnable;
+    const int      wallTex_          = wallTex;
+    const int      floorFog_         = floorFog;
+    const int      ceilingFog_       = ceilingFog;
+    const int      backgroundTop_    = backgroundTop && BackgroundIndexed.pixels;
+    const int      backgroundBottom_ = backgroundBottom && BackgroundIndexed.pixels;
+    const int      bgTop             = (!backgroundTop_ && backgroundBottom_) ? renderH/2 : 0;
+    const int      bgHeight          = ( backgroundTop_ && backgroundBottom_) ? renderH   : renderH/2;
+    const float    bgTurn            = 0.25f - radToDeg(View->angle) / 360.0f;
+
+    int i, h, y, row, srcX, alpha;
+    float dist, bgX;
+    uint8_t* column;
+    uint8_t* pixel;
+    uint8_t texel;
+    struct FloorSample* Sample;
+    struct ColumnHit* Hits;
+
+    for (i = begin; i < end; i++)
+    {
+        column = Frame8 + View->Rect.y * pitch + View->Rect.x + i;
+
+        if (wallFog || backClipPlane)
+            for (y = 0; y < renderH; y++)
+                column[y * pitch] = View->clearIndex;
+
+        // Background; its four quarters go round the view once every four view widths
+        if (backgroundTop_ || backgroundBottom_)
+        {
+            bgX  = (float)i / (renderW * 4) + bgTurn;
+            srcX = (int)((bgX - floorf(bgX)) * BackgroundIndexed.w) % BackgroundIndexed.w;
+
+            for (y = bgTop; y < bgTop + bgHeight; y++)
+            {
+                texel = BackgroundIndexed.pixels[(BackgroundSrcRect.y + (y - bgTop) * BackgroundSrcRect.h / bgHeight) * BackgroundIndexed.w + srcX];
+
+                if (texel != PALETTE_CLEAR)
+                    column[y * pitch] = texel;
+            }
+        }
+
+        // Floor
+        for (y = 1; y <= halfScreenH; y++)
+        {
+            if (!(dist = View->floorDist[y-1]))
+                continue;
+
+            row   = halfScreenH+(y-1)+CORRECTION;
+            pixel = &column[row * pitch];
+
+            if (!backgroundBottom_)
+                *pixel = View->floorIndex;
+
+            if (floorTex_)
+            {
+                Sample = &View->Floor[(y-1) * renderW + i];
+
+                if (Sample->srcX >= 0)
                 {
-                    SDL_SetRenderDrawColor(Renderer3D, colorArg3(board_->floorColor), 255);
-                    SDL_RenderDrawLine    (Renderer3D, 0, halfScreenH+(y-1)+CORRECTION, screenWidth-1, halfScreenH+(y-1)+CORRECTION);
+                    texel  = AtlasIndexed.pixels[Sample->srcY * AtlasIndexed.w + Sample->srcX];
+                    *pixel = Palette.Light[Sample->light >> COLORMAP_SHIFT][texel != PALETTE_CLEAR ? texel : *pixel];
                 }
+            }
+
+            if (floorFog_)
+            {
+                if ((alpha = 255 * (dist/board_->fogDistance)) > 255)
+                    alpha = 255;
+
+                *pixel = Palette.Fog[alpha >> COLORMAP_SHIFT][*pixel];
+            }
+        }
+
+        // Ceiling
+        for (y = 1; y < halfScreenH; y++)
+        {
+            if (!(dist = View->ceilingDist[y-1]))
+                continue;
+
+            row   = (halfScreenH-1)-(y-1)-CORRECTION;
+            pixel = &column[row * pitch];
+
+            if (!backgroundTop_)
+                *pixel = View->ceilingIndex;
+
+            if (ceilingFog_)
+            {
+                if ((alpha = 255 * (dist/board_->fogDistance)) > 255)
+                    alpha = 255;
+
+                *pixel = Palette.Fog[alpha >> COLORMAP_SHIFT][*pixel];
+            }
+        }
+
+        // Walls
+        Hits = &View->Hits[i * MAX_COLUMN_HITS];
+
+        for (h = View->numHits[i]-1; h >= 0; h--)
+            drawColumnHit8(&Hits[h], column, pitch, wallTex_, View->wallIndex);
+    }
+}
+
+void expandJob(void* data, int begin, int end)
+{
+    expandPalette(Palette.Colors, Frame8 + begin * screenWidth, screenWidth, LockedFrame + begin * lockedPitch, lockedPitch, ResScaler.renderWidth, end - begin);
+}
+
+// Every camera's rays are walked on the job threads at once. Given pixels, pitch in pixels, the views are
+// drawn through the 8-bit path and expanded into them on the job threads as well.
+void runRenderGraph(struct Board* board_, uint32_t* pixels, int pitch)
+{
+    const struct JobStats TickStats = Scheduler.Stats;     // printJobStats() is about the ticks
+    const uint32_t fogColor         = 0xFF000000 | board_->fogColor[0] << 16 | board_->fogColor[1] << 8 | board_->fogColor[2];
+    uint32_t drawn = 0;
+    int i;
+
+    LockedFrame = pixels;
+    lockedPitch = pitch;
+
+    if (pixels && Palette.fogColor != fogColor)
+        buildColormaps(&Palette, colorArg3(board_->fogColor));
+
+    clearJobGraph(&RenderGraph);
+
+    for (i = 0; i < numCameras; i++)
+    {
+        setupView (&Views[i], board_, &CameraArray[i]);
+        addJobLoop(&RenderGraph, "walls", wallJob,  &Views[i], &Views[i].Rect.w, WALL_CHUNK,  0, VIEW_HITS(i));
+        addJobLoop(&RenderGraph, "floor", floorJob, &Views[i], &Views[i].rows,   FLOOR_CHUNK, 0, VIEW_FLOOR(i));
+
+        if (pixels)
+            addJobLoop(&RenderGraph, "pixels", pixelJob, &Views[i], &Views[i].Rect.w, WALL_CHUNK, VIEW_HITS(i) | VIEW_FLOOR(i), VIEW_PIXELS(i));
+
+        drawn |= VIEW_PIXELS(i);
+    }
+
+    if (pixels)
+        addJobLoop(&RenderGraph, "expand", expandJob, NULL, &ResScaler.renderHeight, EXPAND_CHUNK, drawn, 0);
+
+    runJobGraph(&Scheduler, &RenderGraph);
+    Scheduler.Stats = TickStats;
+    LockedFrame     = NULL;
+
+    numRayHits = 0;
+
+    for (i = 0; i < Views[0].Rect.w && numRayHits < MAX_RAY_HITS; i++)
+        if (Views[0].FirstHit[i].x != INT_MIN)
+            RayHits[numRayHits++] = Views[0].FirstHit[i];
+}
+
+// The views are drawn one after the other once their rays are in; the 8-bit path only uploads here.
+// Returns the texture the frame ended up in.
+SDL_Texture* renderViews(struct Board* board_)
+{
+    const SDL_Rect RenderRect = {0, 0, ResScaler.renderWidth, ResScaler.renderHeight};
+    int i, pitch;
+    void* locked;
+
+    if (paletteEnable && AtlasIndexed.pixels && Frame8 && SDL_LockTexture(PaletteFrame, &RenderRect, &locked, &pitch) == 0)
+    {
+        runRenderGraph(board_, locked, pitch / sizeof(uint32_t));
+        SDL_UnlockTexture(PaletteFrame);
+
+        return PaletteFrame;
+    }
+
+    runRenderGraph(board_, NULL, 0);
+
+    // the same board for every view, so one clear does
+    SDL_SetRenderTarget(Renderer, Frame3D);
+
+    if (wallFog)
+    {
+        SDL_SetRenderDrawColor(Renderer, colorArg3(board_->fogColor), 255);
+        SDL_RenderClear       (Renderer);
+    }
+    else if (backClipPlane)
+    {
+        SDL_SetRenderDrawColor(Renderer, colorArg4(RGBA_BLACK));
+        SDL_RenderClear       (Renderer);
+    }
+
+    for (i = 0; i < numCameras; i++)
+        drawView(&Views[i]);
+
+    SDL_SetRenderTarget(Renderer, NULL);
+
+    return Frame3D;
+}
+
+// Copies the frame renderViews() finished for the encoder, when a screenshot or a sequence wants it. The 8-bit
+// path expands Frame8 again rather than reading back the texture it went to.
+void captureFrame(SDL_Texture* frame)
+{
+    const SDL_Rect RenderRect = {0, 0, ResScaler.renderWidth, ResScaler.renderHeight};
+    uint32_t* pixels          = acquireCaptureFrame(&Capture, RenderRect.w, RenderRect.h, screenshotPending);
+
+    screenshotPending = 0;
+
+    if (pixels == NULL)
+        return;
+
+    if (frame == PaletteFrame)
+        expandPalette(Palette.Colors, Frame8, screenWidth, pixels, RenderRect.w, RenderRect.w, RenderRect.h);
+    else
+    {
+        SDL_SetRenderTarget(Renderer, frame);
+
+        if (SDL_RenderReadPixels(Renderer, &RenderRect, SDL_PIXELFORMAT_ARGB8888, pixels, RenderRect.w * sizeof(uint32_t)))
+        {
+            printf("Error - captureFrame() could not read the frame back: %s\n", SDL_GetError());
+            SDL_SetRenderTarget(Renderer, NULL);
+
+            return;
+        }
+
+        SDL_SetRenderTarget(Renderer, NULL);
+    }
+
+    submitCaptureFrame(&Capture);
+}
+
+void handleCaptureKeys(const uint8_t* keyState)
+{
+    uint8_t screenshotKey = keyState ? keyState[SCREENSHOT_KEY] : 0;
+    uint8_t sequenceKey   = keyState ? keyState[SEQUENCE_KEY]   : 0;
+
+    if (screenshotKey && !lastScreenshotKey)
+        screenshotPending = 1;
+
+    if (sequenceKey && !lastSequenceKey)
+    {
+        if (Capture.recording)
+            stopCaptureSequence(&Capture);
+        else
+            startCaptureSequence(&Capture);
+    }
+
+    lastScreenshotKey = screenshotKey;
+    lastSequenceKey   = sequenceKey;
+}
+
+struct Vec2 TracerFrom, TracerTo;
+int tracerVisible;      // set by doFire(), until the next renderTracer()
+
+// Every entity holding COMMAND_FIRE shoots, each on its own cooldown, so a server runs its clients' shots too.
+// Walls only break where the tiles are decided, so a client leaves that to the server's next snapshot.
+void doFire(struct Board* board_, int breakWalls)
+{
+    struct Vec2 hit, direction;
+    uint16_t tile;
+    int i;
+
+    for (i = 0; i < entityCount; i++)
+    {
+        if ((EntityArray[i] & TYPE_CONTROL) == 0)
+            continue;
+
+        if (ControlArray[i].fireCooldown > 0)
+        {
+            ControlArray[i].fireCooldown--;
+            continue;
+        }
+
+        if ((ControlArray[i].commands & COMMAND_FIRE) == 0)
+            continue;
+
+        setVec2(direction, RotationArray[i]);
+        addVec2(direction, randomVec2(&RngArray[RNG_WEAPONS], 0, INACCURACY));
+        hit = shootRay(board_, PositionArray[i], direction);
+
+        // the ray stops inside the tile it hit; a breakable one is left as floor with its texture on it
+        if (breakWalls && (tile = tileAtPos(board_, hit.x, hit.y)) & TILE_BREAKABLE)
+            setTile(board_, hit.x / tileSize, hit.y / tileSize, tile & ~(TILE_DOOR | TILE_BREAKABLE));
+
+        subtractVec2(hit, direction);
+
+        setVec2(TracerFrom, PositionArray[i]);
+        setVec2(TracerTo, hit);
+        tracerVisible = 1;
+        spawnExplosion(hit, ZeroVec2, EXPLOSION_MAGNITUDE);
+        ControlArray[i].fireCooldown = FIRE_COOLDOWN_TIME;
+    }
+}
+
+// Whether any collidable entity overlaps tile x, y
+int tileOccupied(int x, int y)
+{
+    const float centerX = (x + 0.5f) * tileSize;
+    const float centerY = (y + 0.5f) * tileSize;
+    int i;
+
+    for (i = 0; i < entityCount; i++)
+    {
+        if ((EntityArray[i] & TYPE_COLLIDABLE)
+        &&  fabsf(PositionArray[i].x - centerX) < (CollidableArray[i].w + tileSize) / 2.0f
+        &&  fabsf(PositionArray[i].y - centerY) < (CollidableArray[i].h + tileSize) / 2.0f)
+            return 1;
+    }
+
+    return 0;
+}
+
+// Pressing COMMAND_USE opens or closes the door a tile ahead; a door won't close on anyone standing in it
+void doUse(struct Board* board_)
+{
+    int i, x, y;
+    uint16_t tile;
+
+    for (i = 0; i < entityCount; i++)
+    {
+        if ((EntityArray[i] & TYPE_CONTROL) == 0 || (ControlArray[i].pressed & COMMAND_USE) == 0)
+            continue;
+
+        x    = (int)floorf((PositionArray[i].x + RotationArray[i].x * tileSize) / tileSize);
+        y    = (int)floorf((PositionArray[i].y + RotationArray[i].y * tileSize) / tileSize);
+        tile = tileAtSafe(board_, x, y);
+
+        if ((tile & TILE_TOGGLE) == 0 || ((tile & TILE_DOOR) == 0 && tileOccupied(x, y)))
+            continue;
+
+        setTile(board_, x, y, tile ^ TILE_DOOR);
+    }
+}
+
+void renderTracer(SDL_Renderer* renderer_)
+{
+    if (tracerVisible == 0)
+        return;
+
+    SDL_SetRenderDrawColor(renderer_, colorArg4(FIRE_COLOR1));
+    SDL_RenderDrawLine
+    (
+       renderer_,
+       TracerFrom.x+camera2D_X,
+       TracerFrom.y+camera2D_Y,
+       TracerTo.x+camera2D_X,
+       TracerTo.y+camera2D_Y
+    );
+    tracerVisible = 0;
+}
+
+// The map comes from chunk textures with the light baked in; only chunks whose tiles or light changed get re-rendered
+void renderBoard(struct Board* board_)
+{
+    renderMapCache(&MapCache, board_, Renderer, AtlasTexture, lightEnable, camera2D_X, camera2D_Y, screenWidth, screenHeight);
+}
+
+void centerCamera(int cameraId)
+{
+    camera2D_X = screenWidth/2 -  PositionArray[cameraId].x;
+    camera2D_Y = screenHeight/2 - PositionArray[cameraId].y;
+}
+
+void spawnPlayer(int x, int y, float angle_, uint8_t color_[])
+{
+    if (entityCount >= MAX_ENTITIES)
+    {
+        printf("Error - spawnPlayer(): more than %d entities\n", MAX_ENTITIES);
+
+        return;
+    }
+
+    EntityArray[entityCount] =
+      TYPE_POSITION
+    | TYPE_TRANSFORM
+    | TYPE_VELOCITY
+    | TYPE_FORCE
+    | TYPE_ROTATION
+    | TYPE_TORQUE
+    | TYPE_COLLIDABLE
+    | TYPE_CONTROL
+    | TYPE_VISIBLE;
+
+    PositionArray             [entityCount]              = (struct Vec2)       {.x = halfTile + tileSize*x, .y = halfTile + tileSize*x};
+    TransformArray            [entityCount]              = ZeroVec2;
+    VelocityArray             [entityCount]              = VelocityDefault;
+    ForceArray                [entityCount]              = ForceDefault;
+    RotationArray             [entityCount].angle        = degToRad(angle_);
+    setVec2Angle(RotationArray[entityCount], angle_);
+    TorqueArray               [entityCount]              = TorqueDefault;
+    CollidableArray           [entityCount]              = (struct Collidable) {.w = tileSize, .h = tileSize};
+    VisibleArray              [entityCount]              = (struct Visible)    {.type = VISIBLE_HITBOX, .animation = 0, .frame = 0};
+    ControlArray              [entityCount].type         = CONTROL_ROTATIONAL | CONTROL_KEYBOARD;// | CONTROL_MOUSELOOK;
+    ControlArray              [entityCount].inputChannel = 0;
+    ControlArray              [entityCount].fireCooldown = 0;
+    setColor(VisibleArray     [entityCount].color, color_);
+    playerId = entityCount;
+
+    entityCount++;
+    printf("entityCount: %d\n", entityCount);
+}
+
+SDL_Surface* AtlasSurface;    // CPU copy of the texture atlas, kept to diff against on hot reload
+
+SDL_Surface* loadAtlas(const char* filename)
+{
+    uint8_t transColor[3] = {152, 0, 136};
+    SDL_Surface* TempSurface = IMG_Load(filename);
+    SDL_Surface* Atlas;
+
+    if (TempSurface == NULL)
+    {
+        printf("Error - loadAtlas() could not load %s\n", filename);
+
+        return NULL;
+    }
+
+    // a fixed format, so pages of a reloaded atlas can be uploaded straight into the existing textures
+    SDL_SetColorKey(TempSurface, SDL_TRUE, SDL_MapRGB(TempSurface->format, transColor[0], transColor[1], transColor[2]));
+    Atlas = SDL_ConvertSurfaceFormat(TempSurface, SDL_PIXELFORMAT_ARGB8888, 0);
+    SDL_FreeSurface(TempSurface);
+
+    return Atlas;
+}
+
+// Everything the game renders into before it's drawn on the screen, sized by the screen
+void createRenderTargets()
+{
+    SDL_DestroyTexture(OffScreen3D);
+    SDL_DestroyTexture(Frame3D);
+    SDL_DestroyTexture(MinimapTexture);
+    SDL_DestroyTexture(PaletteFrame);
+    free(Frame8);
+
+    OffScreen3D     = SDL_CreateTexture(Renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, screenWidth, screenHeight);
+    Frame3D         = SDL_CreateTexture(Renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, screenWidth, screenHeight);
+    MinimapTexture  = SDL_CreateTexture(Renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, screenWidth, screenHeight);
+    PaletteFrame    = SDL_CreateTexture(Renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, screenWidth, screenHeight);
+    Frame8          = calloc((size_t)screenWidth * screenHeight, 1);
+    SDL_SetTextureBlendMode(OffScreen3D, SDL_BLENDMODE_BLEND);
+    createViews();
+    resizeCapture(&Capture, screenWidth, screenHeight);
+}
+
+// What the 8-bit path draws from, quantised to one palette; built whether it's on or not, so it can be
+// switched to at any time
+void initPalette(SDL_Surface* background)
+{
+    SDL_Surface* Background = background ? SDL_ConvertSurfaceFormat(background, SDL_PIXELFORMAT_ARGB8888, 0) : NULL;
+    SDL_Surface* Images[2]  = {AtlasSurface, Background};
+
+    if (buildPalette(&Palette, Images, 2) == 0)
+    {
+        quantiseImage(&Palette, AtlasSurface, &AtlasIndexed);
+
+        if (Background)
+            quantiseImage(&Palette, Background, &BackgroundIndexed);
+    }
+
+    SDL_FreeSurface(Background);
+}
+
+void initRenderer(struct Board* board_, SDL_Renderer* renderer)
+{
+    SDL_Surface* TempSurface;
+
+    Renderer      = renderer;
+    AtlasSurface  = loadAtlas(board_->textureFile);
+    AtlasTexture  = SDL_CreateTextureFromSurface(Renderer, AtlasSurface);
+    FogBlendMode  = SDL_ComposeCustomBlendMode(SDL_BLENDFACTOR_SRC_ALPHA, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD, SDL_BLENDFACTOR_ZERO, SDL_BLENDFACTOR_DST_ALPHA, SDL_BLENDOPERATION_ADD);
+    createRenderTargets();
+    initMapCache(&MapCache, board_);
+
+    TempSurface         = IMG_Load(board_->bgFile);
+    BackgroundTexture   = SDL_CreateTextureFromSurface(Renderer, TempSurface);
+
+    setBackgroundSrcRect(TempSurface->w, TempSurface->h);
+    setBackgroundDstRect(screenWidth, screenHeight);
+    initPalette(TempSurface);
+    SDL_FreeSurface(TempSurface);
+    initCapture(&Capture, screenWidth, screenHeight);
+}
+
+// Just what the 8-bit path draws from, for rendering without a window; killRenderer() frees it all the same
+int initSoftwareRenderer(struct Board* board_)
+{
+    SDL_Surface* TempSurface;
+
+    if ((AtlasSurface = loadAtlas(board_->textureFile)) == NULL)
+        return 1;
+
+    if ((TempSurface = IMG_Load(board_->bgFile)) != NULL)
+        setBackgroundSrcRect(TempSurface->w, TempSurface->h);
+
+    initPalette(TempSurface);
+    SDL_FreeSurface(TempSurface);
+    createViews();
+
+    free(Frame8);
+    Frame8 = calloc((size_t)screenWidth * screenHeight, 1);
+
+    return Frame8 == NULL || AtlasIndexed.pixels == NULL;
+}
+
+void killRenderer()
+{
+    SDL_DestroyTexture(AtlasTexture);
+    SDL_DestroyTexture(BackgroundTexture);
+    SDL_DestroyTexture(OffScreen3D);
+    SDL_DestroyTexture(Frame3D);
+    SDL_DestroyTexture(MinimapTexture);
+    SDL_DestroyTexture(PaletteFrame);
+    SDL_FreeSurface   (AtlasSurface);
+    killMapCache      (&MapCache);
+    freeViews         ();
+    freeIndexedImage  (&AtlasIndexed);
+    freeIndexedImage  (&BackgroundIndexed);
+    free              (Frame8);
+    killCapture       (&Capture);
+
+    AtlasTexture = BackgroundTexture = OffScreen3D = Frame3D = MinimapTexture = PaletteFrame = NULL;
+    AtlasSurface = NULL;
+    Frame8       = NULL;
+    Renderer     = NULL;
+}
+
+// Pick up quality settings from the config; only what depends on a changed setting is reallocated.
+// The game view fills Video's screen, so the window and render scale are Video's business.
+// Cheap enough to call every update; safe to call before initRenderer(), the renderer just doesn't exist yet.
+void applyRenderConfig(struct Config* config, struct Board* board_, SDL_Rect screen)
+{
+    const int resized  = screen.w != screenWidth || screen.h != screenHeight;
+    const int rescaler = resized || config->dynamicRes != ResScaler.enable || ResScaler.fullWidth == 0;
+
+    screenX         = screen.x;
+    screenY         = screen.y;
+    screenWidth     = screen.w;
+    screenHeight    = screen.h;
+    resScale        = config->resScale;
+    floorEnable     = config->floorEnable;
+    fov             = config->fov;
+    maxDrawDistance = config->drawDistance;
+    drawDistance    = min(board_->drawDistance, maxDrawDistance);
+    minimapEnable   = config->minimap;
+    numCameras      = max(1, min(config->views, MAX_VIEWS));
+    paletteEnable   = config->palette;
+    setCaptureOptions(&Capture, config->capturePrefix, strcmp(config->captureFormat, "y4m") ? CAPTURE_PNG : CAPTURE_Y4M);
+
+    if (rescaler)
+        initResolutionScaler(&ResScaler, screenWidth, screenHeight, config->frameBudget, config->dynamicRes);
+    else
+        ResScaler.budgetMs = config->frameBudget;
+
+    if (Renderer && resized)
+    {
+        createRenderTargets();
+        setBackgroundDstRect(screenWidth, screenHeight);
+    }
+}
+
+void spawnObjects(struct Board* board_)
+{
+    int i;
+
+    for (i = 0; i < board_->numObjects; i++)
+    {
+        switch (board_->objects[i].type)
+        {
+        case OBJECT_PLAYER:
+            spawnPlayer(board_->objects[i].x, board_->objects[i].y, board_->objects[i].angle, RGBA_GREEN);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void getSettings(struct Board* board_)
+{
+    texSize          = board_->texSize;
+    tileSize         = board_->tileSize;
+    halfTile         = tileSize/2;
+    quarterTile      = tileSize/4;
+    wallFog          = board_->wallFog;
+    floorFog         = board_->floorFog;
+    ceilingFog       = board_->ceilingFog;
+    wallTex          = board_->wallTex;
+    floorTex         = board_->floorTex;
+    ceilingTex       = board_->ceilingTex;
+    lightEnable      = board_->lightEnable;
+    minLight         = board_->minLight;
+    maxLight         = board_->maxLight;
+    drawDistance     = min(board_->drawDistance, maxDrawDistance);
+    backClipPlane    = board_->backClipPlane;
+    backgroundTop    = board_->backgroundTop;
+    backgroundBottom = board_->backgroundBottom;
+
+    if (maxLight > 255) maxLight = 255;
+}
+
+/*
+void replaceColor(SDL_Surface* surface_, SDL_Color DstColor, SDL_Color SrcColor)
+{
+    int i, j;
+    int numColors = surface_->format->palette->ncolors;
+
+    for (i = 0; i < numColors; i++)
+    {
+        if (surface_->format->palette->ncolors[i].r != DstColor.r) break;
+        if (surface_->format->palette->ncolors[i].g != DstColor.g) break;
+        if (surface_->format->palette->ncolors[i].b != DstColor.b) break;
+
+        surface_->format->palette->ncolors[i] = SrcColor;
+    }
+}
+*/
+
+/*************
+* Hot reload *
+*************/
+struct HotReload
+{
+    SDL_mutex*      Lock;
+    struct Watcher  Watcher;
+    struct Board*   PendingBoard;   // parsed on the watcher thread, swapped in by applyHotReload() between frames
+    SDL_Surface*    PendingAtlas;
+}
+HotReload;
+
+int reloadMap(const char* path, void* data)
+{
+    struct Board* newBoard = loadMap((char*)path, NULL);
+
+    SDL_LockMutex(HotReload.Lock);
+    freeBoard(HotReload.PendingBoard);
+    HotReload.PendingBoard = newBoard;
+    SDL_UnlockMutex(HotReload.Lock);
+
+    return newBoard == NULL;
+}
+
+int reloadAtlas(const char* path, void* data)
+{
+    SDL_Surface* newAtlas = loadAtlas(path);
+
+    SDL_LockMutex(HotReload.Lock);
+
+    if (HotReload.PendingAtlas)
+        SDL_FreeSurface(HotReload.PendingAtlas);
+
+    HotReload.PendingAtlas = newAtlas;
+    SDL_UnlockMutex(HotReload.Lock);
+
+    return newAtlas == NULL;
+}
+
+void initHotReload(char* mapFile, char* textureFile)
+{
+    HotReload.Lock = SDL_CreateMutex();
+
+    if (initWatcher(&HotReload.Watcher) == 0)
+    {
+        watchFile(&HotReload.Watcher, mapFile,     reloadMap,   NULL);
+        watchFile(&HotReload.Watcher, textureFile, reloadAtlas, NULL);
+    }
+}
+
+void killHotReload()
+{
+    killWatcher(&HotReload.Watcher);
+    freeBoard(HotReload.PendingBoard);
+
+    if (HotReload.PendingAtlas)
+        SDL_FreeSurface(HotReload.PendingAtlas);
+
+    if (HotReload.Lock)
+        SDL_DestroyMutex(HotReload.Lock);
+
+    memset(&HotReload, 0, sizeof(HotReload));
+}
+
+// Bring board_ up to date with newBoard, rebuilding only what changed. Returns 1 if the two can't be patched.
+int patchBoard(struct Board* board_, struct Board* newBoard)
+{
+    int x, y, changed = 0;
+    int minX = board_->w, minY = board_->h, maxX = 0, maxY = 0;
+    int relightAll = 0;
+    uint16_t tile;
+    struct Object* oldObjects;
+
+    if (newBoard->w != board_->w || newBoard->h != board_->h || newBoard->tileSize != board_->tileSize || board_->Streamer || newBoard->Streamer)
+        return 1;
+
+    if (!sameSettings(board_, newBoard))
+    {
+        copySettings(board_, newBoard);
+        getSettings(board_);
+        relightAll = 1;
+    }
+
+    if (newBoard->numObjects != board_->numObjects || memcmp(newBoard->objects, board_->objects, board_->numObjects * sizeof(struct Object)))
+    {
+        oldObjects           = board_->objects;
+        board_->objects      = newBoard->objects;
+        board_->numObjects   = newBoard->numObjects;
+        newBoard->objects    = oldObjects;
+        newBoard->numObjects = 0;
+        relightAll = 1;
+    }
+
+    // writeTile keeps the occlusion bitmaps in step, tile by tile
+    for (y = 0; y < board_->h; y++)
+    {
+        for (x = 0; x < board_->w; x++)
+        {
+            tile = tileAt(newBoard, x, y);
+
+            if ((tileAt(board_, x, y) & ~TILE_LIT) != tile)
+            {
+                writeTile(board_, x, y, tile);
+                minX = min(minX, x);
+                minY = min(minY, y);
+                maxX = max(maxX, x+1);
+                maxY = max(maxY, y+1);
+                changed++;
+            }
+        }
+    }
+
+    if (relightAll)
+        lightBoard(board_);
+    else if (changed)
+        relightRegion(board_, minX, minY, maxX, maxY);
+
+    if (changed)
+        buildVisibility(board_);
+
+    printf("patchBoard(): %d tiles changed in %d,%d - %d,%d%s\n", changed, minX, minY, maxX, maxY, relightAll ? ", full relight" : "");
+
+    return 0;
+}
+
+// Upload only the atlas pages (one texSize x texSize tile graphic each) whose pixels changed
+void patchAtlas(SDL_Surface* newAtlas)
+{
+    int page, numPages, changed = 0;
+    size_t pageBytes;
+    uint8_t* oldPixels;
+    uint8_t* newPixels;
+    SDL_Rect Page;
+
+    if (AtlasSurface == NULL || newAtlas->w != AtlasSurface->w || newAtlas->h != AtlasSurface->h || newAtlas->pitch != AtlasSurface->pitch)
+    {
+        SDL_DestroyTexture(AtlasTexture);
+        AtlasTexture = SDL_CreateTextureFromSurface(Renderer, newAtlas);
+        printf("patchAtlas(): atlas size changed, texture recreated\n");
+    }
+    else
+    {
+        numPages  = newAtlas->h / texSize;
+        pageBytes = (size_t)newAtlas->pitch * texSize;
+        oldPixels = AtlasSurface->pixels;
+        newPixels = newAtlas->pixels;
+
+        for (page = 0; page < numPages; page++)
+        {
+            if (memcmp(oldPixels + page*pageBytes, newPixels + page*pageBytes, pageBytes))
+            {
+                Page = (SDL_Rect){0, page*texSize, newAtlas->w, texSize};
+                SDL_UpdateTexture(AtlasTexture, &Page, newPixels + page*pageBytes, newAtlas->pitch);
+                changed++;
+            }
+        }
+
+        printf("patchAtlas(): %d of %d pages updated\n", changed, numPages);
+    }
+
+    if (AtlasSurface)
+        SDL_FreeSurface(AtlasSurface);
+
+    AtlasSurface = newAtlas;
+    invalidateMapCacheAll(&MapCache);
+
+    // the palette stays, new colors go to the nearest there is
+    if (AtlasIndexed.pixels)
+        quantiseImage(&Palette, AtlasSurface, &AtlasIndexed);
+}
+
+void applyHotReload(struct Board** board_)
+{
+    struct Board* newBoard;
+    SDL_Surface* newAtlas;
+
+    if (HotReload.Lock == NULL)
+        return;
+
+    SDL_LockMutex(HotReload.Lock);
+    newBoard = HotReload.PendingBoard;
+    newAtlas = HotReload.PendingAtlas;
+    HotReload.PendingBoard = NULL;
+    HotReload.PendingAtlas = NULL;
+    SDL_UnlockMutex(HotReload.Lock);
+
+    if (newBoard)
+    {
+        if (patchBoard(*board_, newBoard))
+        {
+            printf("applyHotReload(): map layout changed, swapping in the whole board\n");
+            freeBoard(*board_);     // both are on the heap, see initGame()
+            *board_ = newBoard;
+            getSettings(*board_);
+            initMapCache(&MapCache, *board_);
+            lightBoard(*board_);
+        }
+        else
+            freeBoard(newBoard);
+    }
+
+    if (newAtlas)
+        patchAtlas(newAtlas);
+}
+
+struct Board* MainBoard;
+double tickTime;        // dt not yet consumed by fixed ticks
+
+// What the tick's systems share; each job declares what it reads and writes, and the scheduler
+// runs side by side whatever doesn't conflict
+enum Resources
+{
+    RES_ENTITY      = 1 << 0,
+    RES_POSITION    = 1 << 1,
+    RES_TRANSFORM   = 1 << 2,
+    RES_VELOCITY    = 1 << 3,
+    RES_ROTATION    = 1 << 4,
+    RES_FORCE       = 1 << 5,
+    RES_TORQUE      = 1 << 6,
+    RES_COLLIDABLE  = 1 << 7,
+    RES_CONTROL     = 1 << 8,
+    RES_AI          = 1 << 9,
+    RES_VISIBLE     = 1 << 10,
+    RES_INPUT       = 1 << 11,
+    RES_BODIES      = 1 << 12,
+    RES_PARTICLES   = 1 << 13,
+    RES_BOARD       = 1 << 14,
+    RES_EFFECTS     = 1 << 15
+};
+
+#define INTEGRATE_CHUNK 1024    // bodies per piece of the integrate job
+
+struct JobGraph TickGraph;
+const uint8_t* TickKeys;
+
+struct Replay Replay;
+char RecordFile[CONFIG_STRING_SIZE];    // where the recording goes when the game ends
+
+enum NetRoles
+{
+    NET_ROLE_LOCAL,
+    NET_ROLE_SERVER,
+    NET_ROLE_CLIENT
+};
+
+int netRole;
+int localChannel;       // the input channel the keyboard drives: 0, or the client's slot + 1
+int resimulating;       // running our unacknowledged inputs again on top of a server snapshot
+
+// A replay stands in for the keyboard and mouse; otherwise whatever they gave is recorded, if anything is
+void inputJob(void* data, int begin, int end)
+{
+    struct ReplayInput Input;
+    int channel;
+
+    if (netRole == NET_ROLE_SERVER || resimulating)     // the channels were filled in before the tick
+        return;
+
+    if (Replay.mode == REPLAY_PLAYING)
+    {
+        for (channel = 0; channel < REPLAY_MAX_CHANNELS; channel++)
+        {
+            playInput(&Replay, tick, channel, &Input);
+            InputChannelArray[channel] = Input.commands;
+            InputAimArray[channel]     = (struct Vec2){Input.aimX, Input.aimY};
+        }
+
+        return;
+    }
+
+    if (TickKeys)
+        getInput(TickKeys, localChannel, ControlArray[playerId].type);
+    else
+        InputChannelArray[localChannel] = 0;
+
+    for (channel = 0; channel < REPLAY_MAX_CHANNELS; channel++)
+        recordInput(&Replay, tick, channel, (struct ReplayInput){InputChannelArray[channel], InputAimArray[channel].x, InputAimArray[channel].y});
+}
+
+uint64_t hashBytes(uint64_t hash, const void* data, size_t size)
+{
+    const uint8_t* bytes = data;
+    size_t i;
+
+    for (i = 0; i < size; i++)
+        hash = (hash ^ bytes[i]) * 1099511628211ull;    // FNV-1a
+
+    return hash;
+}
+
+// Everything the simulation carries from tick to tick; render-side state is left out
+uint64_t hashGameState()
+{
+    uint64_t hash = 14695981039346656037ull;
+    int i;
+
+    hash = hashBytes(hash, &tick,           sizeof(tick));
+    hash = hashBytes(hash, &entityCount,    sizeof(entityCount));
+    hash = hashBytes(hash, EntityArray,     entityCount * sizeof(uint64_t));
+    hash = hashBytes(hash, PositionArray,   entityCount * sizeof(struct Vec2));
+    hash = hashBytes(hash, VelocityArray,   entityCount * sizeof(struct Velocity));
+    hash = hashBytes(hash, RotationArray,   entityCount * sizeof(struct Rotation));
+    hash = hashBytes(hash, TorqueArray,     entityCount * sizeof(struct Torque));
+    hash = hashBytes(hash, RngArray,        sizeof(RngArray));
+    hash = hashBytes(hash, &numParticles,   sizeof(numParticles));
+    hash = hashBytes(hash, ParticleArray,   numParticles * sizeof(struct Particle));
+
+    // doors and broken walls; a streamed map's chunks come and go, so only resident maps count
+    if (MainBoard && MainBoard->Streamer == NULL)
+    {
+        for (i = 0; i < MainBoard->numChunks; i++)
+            hash = hashBytes(hash, MainBoard->chunkTable[i]->tiles, sizeof(MainBoard->chunkTable[i]->tiles));
+    }
+
+    return hash;
+}
+
+// Reached the end of the replay: tell whether the state came out as recorded, and hand the controls back
+int endReplay()
+{
+    int differs = hashGameState() != Replay.checksum;
+
+    if (differs)
+        printf("Error - endReplay(): state after %lld ticks differs from the recording\n", tick);
+    else
+        printf("endReplay(): state after %lld ticks matches the recording\n", tick);
+
+    killReplay(&Replay);
+
+    return differs;
+}
+
+void particlesJob(void* data, int begin, int end)
+{
+    doParticles(data);
+}
+
+void aiJob(void* data, int begin, int end)
+{
+    doAI(data);
+}
+
+void controlJob(void* data, int begin, int end)
+{
+    doControl();
+}
+
+void useJob(void* data, int begin, int end)
+{
+    doUse(data);
+}
+
+void rotationJob(void* data, int begin, int end)
+{
+    doRotationAndTorque();
+}
+
+void gatherJob(void* data, int begin, int end)
+{
+    gatherBodies();
+}
+
+void collisionJob(void* data, int begin, int end)
+{
+    doCollidable(data);
+}
+
+void positionJob(void* data, int begin, int end)
+{
+    doPosition();
+}
+
+void fireJob(void* data, int begin, int end)
+{
+    doFire(data, netRole != NET_ROLE_CLIENT);
+}
+
+void integrateJob(void* data, int begin, int end)
+{
+    integrateBodies(&Bodies, begin, end, PHYS_SCALE);
+    scatterBodies(begin, end);
+}
+
+void streamJob(void* data, int begin, int end)
+{
+    streamChunks(data, PositionArray[cameraId].x, PositionArray[cameraId].y);
+}
+
+// One fixed step of the simulation; keyState is NULL while something else, e.g. the console, takes the keyboard.
+// Jobs are added in the order they used to run, which is the order conflicting ones keep: rotation before the
+// forces that rotational bodies are pushed along, collision correcting the transform before anything moves.
+// Particles only touch their own array, so they run alongside AI, control and physics. Ticks run again for
+// prediction leave out effects and streaming, and AI and doors are the server's alone.
+void tickGame(const uint8_t* keyState)
+{
+    if (Replay.mode == REPLAY_PLAYING && tick >= Replay.numTicks)
+        endReplay();
+
+    TickKeys = keyState;
+    clearJobGraph(&TickGraph);
+
+    addJob(&TickGraph, "input", inputJob, NULL, 0, RES_INPUT);
+
+    if (!resimulating)
+        addJob(&TickGraph, "particles", particlesJob, MainBoard, RES_BOARD, RES_PARTICLES);
+
+    if (tick % 31 == 0 && netRole != NET_ROLE_CLIENT) // solve issue with this not working if it runs too frequently
+        addJob(&TickGraph, "ai", aiJob, MainBoard, RES_ENTITY | RES_CONTROL | RES_POSITION | RES_COLLIDABLE | RES_BOARD, RES_AI | RES_VISIBLE);
+
+    addJob      (&TickGraph, "control", controlJob, NULL, RES_ENTITY | RES_AI | RES_INPUT, RES_CONTROL | RES_FORCE | RES_TORQUE);
+
+    if (!resimulating && netRole != NET_ROLE_CLIENT)
+        addJob  (&TickGraph, "use", useJob, MainBoard, RES_ENTITY | RES_CONTROL | RES_POSITION | RES_ROTATION | RES_COLLIDABLE, RES_BOARD);
+
+    addJob      (&TickGraph, "rotation", rotationJob, NULL, RES_ENTITY | RES_CONTROL | RES_TORQUE | RES_POSITION | RES_INPUT, RES_ROTATION);
+    addJob      (&TickGraph, "gather", gatherJob, NULL, RES_ENTITY | RES_CONTROL | RES_ROTATION | RES_FORCE | RES_VELOCITY, RES_BODIES);
+    addJobLoop  (&TickGraph, "integrate", integrateJob, NULL, &Bodies.count, INTEGRATE_CHUNK, RES_BODIES, RES_BODIES | RES_VELOCITY | RES_TRANSFORM);
+    addJob      (&TickGraph, "collision", collisionJob, MainBoard, RES_ENTITY | RES_BODIES | RES_BOARD, RES_TRANSFORM | RES_VELOCITY | RES_COLLIDABLE);
+    addJob      (&TickGraph, "position", positionJob, NULL, RES_BODIES | RES_TRANSFORM, RES_POSITION);
+
+    if (!resimulating)
+    {
+        addJob  (&TickGraph, "stream", streamJob, MainBoard, RES_POSITION, RES_BOARD);
+        addJob  (&TickGraph, "fire", fireJob, MainBoard, RES_ENTITY | RES_ROTATION | RES_POSITION, RES_CONTROL | RES_BOARD | RES_PARTICLES | RES_EFFECTS);
+    }
+
+    runJobGraph(&Scheduler, &TickGraph);
+    applyTileChanges(MainBoard);
+
+    tick++;
+}
+
+#define QUICKSAVE_KEY   SDL_SCANCODE_F5
+#define QUICKLOAD_KEY   SDL_SCANCODE_F9
+#define REWIND_KEY      SDL_SCANCODE_BACKSPACE      // held, steps back a tick per tick
+
+struct Snapshot         Quicksave;
+struct RewindBuffer     Rewind;
+struct SnapshotRegion*  SnapshotRegions;
+int numSnapshotRegions, maxSnapshotRegions, firstChunkRegion;
+uint8_t lastQuicksaveKey, lastQuickloadKey;
+
+void addSnapshotRegion(void* data, uint32_t size, uint32_t capacity)
+{
+    SnapshotRegions[numSnapshotRegions++] = (struct SnapshotRegion){data, size, capacity, 0};
+}
+
+// Everything the simulation carries between ticks, in a fixed order, then the tiles and light of every chunk.
+// Streamed maps leave the board out; their chunks come and go, and nothing changes them in place.
+int setSnapshotRegions(struct Board* board_)
+{
+    struct SnapshotRegion* grown;
+    int i, needed = 24 + (board_->Streamer ? 0 : 2 * board_->numChunks);
+
+    if (needed > maxSnapshotRegions)
+    {
+        if ((grown = realloc(SnapshotRegions, needed * sizeof(struct SnapshotRegion))) == NULL)
+        {
+            printf("Error - setSnapshotRegions(): out of memory\n");
+
+            return 1;
+        }
+
+        SnapshotRegions    = grown;
+        maxSnapshotRegions = needed;
+    }
+
+    numSnapshotRegions = 0;
+    addSnapshotRegion(&tick,                sizeof(tick),                   sizeof(tick));
+    addSnapshotRegion(&entityCount,         sizeof(entityCount),            sizeof(entityCount));
+    addSnapshotRegion(&numParticles,        sizeof(numParticles),           sizeof(numParticles));
+    addSnapshotRegion(RngArray,             sizeof(RngArray),               sizeof(RngArray));
+    addSnapshotRegion(InputChannelArray,    sizeof(InputChannelArray),      sizeof(InputChannelArray));
+    addSnapshotRegion(InputAimArray,        sizeof(InputAimArray),          sizeof(InputAimArray));
+    addSnapshotRegion(EntityArray,          entityCount * sizeof(uint64_t),             MAX_ENTITIES * sizeof(uint64_t));
+    addSnapshotRegion(PositionArray,        entityCount * sizeof(struct Vec2),          MAX_ENTITIES * sizeof(struct Vec2));
+    addSnapshotRegion(TransformArray,       entityCount * sizeof(struct Vec2),          MAX_ENTITIES * sizeof(struct Vec2));
+    addSnapshotRegion(VelocityArray,        entityCount * sizeof(struct Velocity),      MAX_ENTITIES * sizeof(struct Velocity));
+    addSnapshotRegion(RotationArray,        entityCount * sizeof(struct Rotation),      MAX_ENTITIES * sizeof(struct Rotation));
+    addSnapshotRegion(ForceArray,           entityCount * sizeof(struct Force),         MAX_ENTITIES * sizeof(struct Force));
+    addSnapshotRegion(TorqueArray,          entityCount * sizeof(struct Torque),        MAX_ENTITIES * sizeof(struct Torque));
+    addSnapshotRegion(CollidableArray,      entityCount * sizeof(struct Collidable),    MAX_ENTITIES * sizeof(struct Collidable));
+    addSnapshotRegion(ControlArray,         entityCount * sizeof(struct Control),       MAX_ENTITIES * sizeof(struct Control));
+    addSnapshotRegion(AIArray,              entityCount * sizeof(struct AI),            MAX_ENTITIES * sizeof(struct AI));
+    addSnapshotRegion(VisibleArray,         entityCount * sizeof(struct Visible),       MAX_ENTITIES * sizeof(struct Visible));
+    addSnapshotRegion(ParticleArray,        numParticles * sizeof(struct Particle),     maxParticles * sizeof(struct Particle));
+    firstChunkRegion = numSnapshotRegions;
+
+    for (i = 0; i < board_->numChunks && board_->Streamer == NULL; i++)
+    {
+        addSnapshotRegion(board_->chunkTable[i]->tiles, sizeof(SolidChunk.tiles), sizeof(SolidChunk.tiles));
+        addSnapshotRegion(board_->chunkTable[i]->light, sizeof(SolidChunk.light), sizeof(SolidChunk.light));
+    }
+
+    return 0;
+}
+
+// Chunks that came back different get their derived bits and map cache tiles rebuilt; nothing else derives from the state
+void refreshRestored(struct Board* board_)
+{
+    int i, index, cx, cy;
+
+    for (i = firstChunkRegion; i < numSnapshotRegions; i += 2)
+    {
+        if (SnapshotRegions[i].changed || SnapshotRegions[i+1].changed)
+        {
+            index = (i - firstChunkRegion) / 2;
+            cx    = index % board_->chunksW;
+            cy    = index / board_->chunksW;
+            updateChunkBits(board_->chunkTable[index]);
+            invalidateMapCache(&MapCache, cx * CHUNK_SIZE, cy * CHUNK_SIZE, (cx+1) * CHUNK_SIZE, (cy+1) * CHUNK_SIZE);
+        }
+    }
+}
+
+double msSince(Uint64 start)
+{
+    return (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+void quickSave()
+{
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    if (setSnapshotRegions(MainBoard) == 0 && takeSnapshot(&Quicksave, SnapshotRegions, numSnapshotRegions) == 0)
+        printf("quickSave(): tick %lld, %u bytes in %.3f ms\n", tick, Quicksave.size, msSince(start));
+}
+
+void quickLoad()
+{
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    if (Quicksave.size == 0)
+    {
+        printf("quickLoad(): nothing saved yet\n");
+
+        return;
+    }
+
+    if (setSnapshotRegions(MainBoard) == 0 && restoreSnapshot(&Quicksave, SnapshotRegions, numSnapshotRegions) == 0)
+    {
+        refreshRestored(MainBoard);
+        printf("quickLoad(): back to tick %lld in %.3f ms\n", tick, msSince(start));
+    }
+}
+
+// Keys act on the frame they go down; a replay, or a recording in progress, can't have the state jump around,
+// and neither can a game the server owns
+void handleSnapshotKeys(const uint8_t* keyState)
+{
+    uint8_t quicksaveKey = keyState ? keyState[QUICKSAVE_KEY] : 0;
+    uint8_t quickloadKey = keyState ? keyState[QUICKLOAD_KEY] : 0;
+
+    if (Replay.mode == REPLAY_OFF && netRole == NET_ROLE_LOCAL)
+    {
+        if (quicksaveKey && !lastQuicksaveKey)
+            quickSave();
+
+        if (quickloadKey && !lastQuickloadKey)
+            quickLoad();
+    }
+
+    lastQuicksaveKey = quicksaveKey;
+    lastQuickloadKey = quickloadKey;
+}
+
+/**********
+* Network *
+**********/
+struct NetServer     Server;
+struct NetConnection Connection;
+struct NetBots       Bots;
+
+int16_t clamp16(float value)
+{
+    long rounded = lrintf(value);
+
+    return rounded > INT16_MAX ? INT16_MAX : rounded < INT16_MIN ? INT16_MIN : (int16_t)rounded;
+}
+
+// The first NET_MAX_ENTITIES entities, quantised for the server to send. Commands are what the entity's
+// channel or AI gives it, since controlEntity() clears the movement ones from its own copy.
+void gatherNetSnapshot(struct NetSnapshot* snapshot)
+{
+    struct NetEntity* E;
+    int i;
+
+    snapshot->tick  = tick;
+    snapshot->count = min(entityCount, NET_MAX_ENTITIES);
+
+    for (i = 0; i < snapshot->count; i++)
+    {
+        E = &snapshot->Entities[i];
+
+        E->present  = 1;
+        E->type     = (uint32_t)EntityArray[i];
+        E->control  = ControlArray[i].type;
+        E->channel  = ControlArray[i].inputChannel;
+        E->x        = (int32_t)lrintf(PositionArray[i].x * NET_POSITION_SCALE);
+        E->y        = (int32_t)lrintf(PositionArray[i].y * NET_POSITION_SCALE);
+        E->velX     = clamp16(VelocityArray[i].x * NET_VELOCITY_SCALE);
+        E->velY     = clamp16(VelocityArray[i].y * NET_VELOCITY_SCALE);
+        E->angle    = (uint16_t)lrintf(RotationArray[i].angle * NET_ANGLE_SCALE);
+        E->angVel   = clamp16(TorqueArray[i].angVel * NET_ANGLE_SCALE);
+        E->commands = (E->control & CONTROL_AI) ? AIArray[i].commands : E->channel < NUM_INPUT_CHANNELS ? InputChannelArray[E->channel] : 0;
+        memcpy(&E->color, VisibleArray[i].color, 4);
+    }
+}
+
+// Every tile the game has changed since the map loaded, for the server to send clients what's newer than they hold
+void gatherNetTiles(struct NetServer* server, struct Board* board_)
+{
+    int i;
+
+    if (reserveNetTiles(server, board_->numEdits))
+        return;     // the ones that fit last time go out again, and the rest wait
+
+    for (i = 0; i < board_->numEdits; i++)
+        server->Tiles[i] = (struct NetTile){board_->edits[i].x, board_->edits[i].y, board_->edits[i].tile, board_->edits[i].serial};
+
+    server->numTiles   = board_->numEdits;
+    server->tileSerial = board_->editSerial;
+}
+
+// Each client only hears about the entities its player could see; the rest stay where it last saw them. A client
+// that draws further than the visible sets reach gets everything.
+void cullNetEntities(struct NetServer* server, struct Board* board_)
+{
+    struct NetClient* Client;
+    int slot, i, x, y;
+
+    for (slot = 0; slot < NET_MAX_CLIENTS; slot++)
+    {
+        Client = &server->Clients[slot];
+        memset(Client->hidden, 0, sizeof(Client->hidden));
+
+        if (!Client->connected || Client->entity < 0 || Client->entity >= entityCount || drawDistance > pvsReach(board_))
+            continue;
+
+        x = PositionArray[Client->entity].x / tileSize;
+        y = PositionArray[Client->entity].y / tileSize;
+
+        for (i = 0; i < server->Current.count; i++)
+        {
+            if (!regionSees(board_, x, y, PositionArray[i].x / tileSize, PositionArray[i].y / tileSize))
+                Client->hidden[i >> 3] |= 1 << (i & 7);
+        }
+    }
+}
+
+// The server's word on every entity it sent; ones we haven't seen are made from the player template first.
+// Other players keep pressing what they last pressed until the next snapshot says otherwise.
+void applyNetSnapshot(const struct NetSnapshot* snapshot)
+{
+    const struct NetEntity* E;
+    int i;
+
+    while (entityCount < snapshot->count && entityCount < MAX_ENTITIES)
+        spawnPlayer(0, 0, 0, RGBA_GREEN);
+
+    for (i = 0; i < snapshot->count; i++)
+    {
+        E = &snapshot->Entities[i];
+
+        if (!E->present)
+            continue;
+
+        EntityArray[i]                  = E->type;
+        ControlArray[i].type            = E->control;
+        ControlArray[i].inputChannel    = E->channel;
+        PositionArray[i]                = (struct Vec2){E->x / NET_POSITION_SCALE, E->y / NET_POSITION_SCALE};
+        TransformArray[i]               = ZeroVec2;
+        VelocityArray[i].x              = E->velX / NET_VELOCITY_SCALE;
+        VelocityArray[i].y              = E->velY / NET_VELOCITY_SCALE;
+        RotationArray[i].angle          = E->angle / NET_ANGLE_SCALE;
+        TorqueArray[i].angVel           = E->angVel / NET_ANGLE_SCALE;
+        setVec2Angle(RotationArray[i], RotationArray[i].angle);
+        memcpy(VisibleArray[i].color, &E->color, 4);
+
+        if (E->control & CONTROL_AI)
+            AIArray[i].commands = E->commands;
+        else if (E->channel != localChannel && E->channel < NUM_INPUT_CHANNELS)
+            InputChannelArray[E->channel] = E->commands;
+    }
+
+    if (Connection.entity >= 0 && Connection.entity < entityCount)
+        playerId = cameraId = Connection.entity;
+}
 
-                if (floorTex_)
-                {
-                    x = -1;
+// The client runs ahead of the server by the inputs the server hasn't run yet: each tick is predicted from our
+// own input and sent off, and when a snapshot comes in everything goes back to where the server had it and those
+// inputs are run again on top
+void clientStep(const uint8_t* keyState)
+{
+    struct NetSnapshot* Latest;
+    struct NetInput* Input;
+    uint32_t seq;
+    int i;
 
-                    for (i = 0; i < screenWidth; i++)
-                    {
-                        RayPos.x = RayPos2.x + (CamPlane.x * dist * x);// * x);
-                        RayPos.y = RayPos2.y + (CamPlane.y * dist * x);// * x);
+    if (pollClient(&Connection) && (Latest = latestSnapshot(&Connection)))
+    {
+        for (i = 0; i < Connection.numTiles; i++)
+            setTile(MainBoard, Connection.Tiles[i].x, Connection.Tiles[i].y, Connection.Tiles[i].tile);
 
-                        tileType = tileAtPos(board_, RayPos.x, RayPos.y);
+        Connection.numTiles = 0;
+        applyNetSnapshot(Latest);
+        tick         = Latest->tick;
+        resimulating = 1;
 
-                        if ((tileType & TILE_OCCLUSION) == 0)
-                        {
+        for (seq = Connection.lastProcessed + 1; seq <= Connection.inputSeq; seq++)
+        {
+            if (seq + NET_INPUT_QUEUE <= Connection.inputSeq)
+                continue;   // older than the queue holds
 
-                            int texX = (int)(RayPos.x * 4.0) % texSize;
-                            int texY = (int)(RayPos.y * 4.0) % texSize;
+            Input = &Connection.Pending[seq % NET_INPUT_QUEUE];
+            InputChannelArray[localChannel] = Input->commands;
+            InputAimArray[localChannel]     = (struct Vec2){Input->aimX, Input->aimY};
+            tickGame(NULL);
+        }
 
-                            SrcRect.x = texX;
-                            SrcRect.y = texY + (texSize * (tileType >> TILE_FLAGS));
-                            SrcRect.w = 1;
-                            SrcRect.h = 1;
+        resimulating = 0;
+    }
 
-                            DstRect.x = i;
-                            DstRect.y = halfScreenH+(y-1)+CORRECTION;
-                            DstRect.w = 1;
-                            DstRect.h = 1;
+    if (Connection.slot < 0)
+        return;     // not let in yet
 
-                            SDL_RenderCopy(Renderer3D, Texture3D, &SrcRect, &DstRect);
-                            alpha = 255 - board_->lightMap[board_->w * (int)(RayPos.y/tileSize) + (int)(RayPos.x/tileSize)];
-                            SDL_SetRenderDrawColor(Renderer3D, 0, 0, 0, alpha);
-                            SDL_RenderDrawPoint(Renderer3D, DstRect.x, DstRect.y);
+    localChannel = Connection.slot + 1;
+    tickGame(keyState);
+    sendClientInput(&Connection, (struct NetInput)
+    {
+        InputChannelArray[localChannel],
+        clamp16(InputAimArray[localChannel].x),
+        clamp16(InputAimArray[localChannel].y)
+    });
+}
 
+// A player for a client that just got in, at the map's first player start, driven by the client's channel
+int spawnClientPlayer(int slot, void* data)
+{
+    struct Board* Board = data;
+    uint8_t color[4] = {255 - slot * 3, 64 + slot * 3, (slot * 37) & 0xFF, 255};
+    int i, keepPlayer = playerId;
 
+    if (entityCount >= NET_MAX_ENTITIES)
+        return -1;
 
-                            //SDL_SetRenderDrawColor      (Renderer2D, colorArg4(RGBA_GREEN));
-                            //SDL_RenderDrawPoint         (Renderer2D, camera2D_X+RayPos.x, camera2D_Y+RayPos.y);
-                        }
+    for (i = 0; i < Board->numObjects && Board->objects[i].type != OBJECT_PLAYER; i++);
 
-                        x += xInc;
-                    }
-                }
+    if (i < Board->numObjects)
+        spawnPlayer(Board->objects[i].x, Board->objects[i].y, Board->objects[i].angle, color);
+    else
+        spawnPlayer(1, 1, 0, color);
 
-                if (floorFog_)
-                {
-                    if ((alpha = 255 * (dist/board_->fogDistance)) > 255)
-                        alpha = 255;
+    ControlArray[entityCount - 1].inputChannel = slot + 1;
+    playerId = keepPlayer;
 
-                    SDL_SetRenderDrawBlendMode(Renderer3D, SDL_BLENDMODE_BLEND);
-                    SDL_SetRenderDrawColor(Renderer3D, colorArg3(board_->fogColor), alpha);
-                    SDL_RenderDrawLine    (Renderer3D, 0, halfScreenH+(y-1)+CORRECTION, screenWidth-1, halfScreenH+(y-1)+CORRECTION);
-                }
+    return entityCount - 1;
+}
 
-                break;
-            }
-        }
+// One tick forward and into the rewind history, or one tick back out of it while REWIND_KEY is held
+void stepGame(const uint8_t* keyState)
+{
+    if (netRole == NET_ROLE_CLIENT)
+    {
+        clientStep(keyState);
+        return;
     }
-    SDL_SetRenderDrawBlendMode(Renderer3D, SDL_BLENDMODE_NONE);
 
-    // Ceiling
-    for (y = 1; y < halfScreenH; y++)
+    if (Replay.mode != REPLAY_OFF || Rewind.budget == 0)
     {
-        dist        = 0;
-        setVec2(RayPos2, CamPos);
-        RayPos2.z   = halfTile+z;
-        zInc        = (float)y/halfScreenH;
-
-        while (dist < drawDistance_)
-        {
-            dist += 1;// * 0.1;
-            RayPos2.z += zInc;// * 0.1;
-            addVec2(RayPos2, RayDir);
+        tickGame(keyState);
+        return;
+    }
 
-            if (RayPos2.z > tileSize)
-            {
-                if ((alpha = 255 * (dist/board_->fogDistance)) > 255)
-                    alpha = 255;
+    if (setSnapshotRegions(MainBoard))
+        return;
 
-                if (!backgroundTop_)
-                {
-                    SDL_SetRenderDrawColor(Renderer3D, colorArg3(board_->ceilingColor), 255);
-                    SDL_RenderDrawLine    (Renderer3D, 0, (halfScreenH-1)-(y-1)-CORRECTION, screenWidth-1, (halfScreenH-1)-(y-1)-CORRECTION);
-                }
-/*
-                if (ceilingtex_)
-                {
-                    x = -1;
+    if (keyState && keyState[REWIND_KEY])
+    {
+        if (popRewind(&Rewind, SnapshotRegions, numSnapshotRegions) == 0)
+            refreshRestored(MainBoard);
 
-                    for (i = 0; i < screenWidth; i++)
-                    {
-                        RayPos.x = RayPos2.x + (CamPlane.x * dist * x);// * x);
-                        RayPos.y = RayPos2.y + (CamPlane.y * dist * x);// * x);
+        return;
+    }
 
-                        tileType = tileAtPos(board_, RayPos.x, RayPos.y);
-                        int texX = (((int)(RayPos2.x/tileSize) % tileSize) / tileSize) * texSize;
-                        int texY = (((int)(RayPos2.y/tileSize) % tileSize) / tileSize) * texSize;
+    tickGame(keyState);
+    setSnapshotRegions(MainBoard);
+    pushRewind(&Rewind, SnapshotRegions, numSnapshotRegions);
+}
 
-                        SrcRect.x = texX;
-                        SrcRect.y = texY + texSize * (tileType >> TILE_FLAGS);
-                        SrcRect.w = 1;
-                        SrcRect.h = 1;
+// The 2D view, rendered into MinimapTexture
+void renderMinimap()
+{
+    SDL_SetRenderTarget     (Renderer, MinimapTexture);
+    SDL_SetRenderDrawColor  (Renderer, 0, 0, 0, 255);
+    SDL_RenderClear         (Renderer);
+    renderBoard             (MainBoard);
+    SDL_SetRenderDrawColor  (Renderer, colorArg4(RGBA_GREEN));
+    SDL_RenderDrawPoints    (Renderer, RayHits, numRayHits);
+    renderVisible           (Renderer);
+    renderTracer            (Renderer);
+    renderParticles         (Renderer);
+    renderCrosshair         (Renderer, playerId);
+    SDL_SetRenderTarget     (Renderer, NULL);
+}
 
-                        DstRect.x = i;
-                        DstRect.y = (halfScreenH-1)-(y-1)-CORRECTION;
-                        DstRect.w = 1;
-                        DstRect.h = 1;
+// video is NULL when running headless: the simulation only, nothing to draw with
+int initGame(struct Config* config, struct Memory* memory, struct Video* video)
+{
+    char* map     = config->map;
+    uint32_t seed = (uint32_t)SDL_GetPerformanceCounter();
+    char compiled[CONFIG_STRING_SIZE + sizeof(MAP_FILE_EXTENSION)];
+    int reloading;
+
+    GameMemory   = memory;
+    entityCount  = 0;
+    tick         = 0;
+    tickTime     = 0;
+    localChannel = 0;
+    memset(InputChannelArray, 0, sizeof(InputChannelArray));
+    memset(InputAimArray,     0, sizeof(InputAimArray));
+    initFastMath();
+    initArrays();
 
-                        SDL_RenderCopy(Renderer3D, Texture3D, &SrcRect, &DstRect);
+    if (netRole != NET_ROLE_SERVER)
+        netRole = config->connect[0] ? NET_ROLE_CLIENT : NET_ROLE_LOCAL;
 
-                        SDL_SetRenderDrawColor      (Renderer2D, colorArg4(RGBA_GREEN));
-                        SDL_RenderDrawPoint         (Renderer2D, camera2D_X+RayPos.x, camera2D_Y+RayPos.y);
+    // recordings, replays and rewinding are for games that run on their own
+    if (netRole == NET_ROLE_LOCAL && config->replay[0] && loadReplay(&Replay, config->replay) == 0)
+    {
+        map  = Replay.map;
+        seed = Replay.seed;
+    }
+    else if (netRole == NET_ROLE_LOCAL && config->record[0])
+    {
+        startRecording(&Replay, config->map, seed);
+        strcpy(RecordFile, config->record);
+    }
 
-                        x += xInc;
-                    }
-                }
-                */
+    seedStreams(seed);
 
-                if (ceilingFog_)
-                {
-                    SDL_SetRenderDrawBlendMode(Renderer3D, SDL_BLENDMODE_BLEND);
-                    SDL_SetRenderDrawColor(Renderer3D, colorArg3(board_->fogColor), alpha);
-                    SDL_RenderDrawLine    (Renderer3D, 0, (halfScreenH-1)-(y-1)-CORRECTION, screenWidth-1, (halfScreenH-1)-(y-1)-CORRECTION);
-                }
+    if (initJobScheduler(&Scheduler, config->workers) || initRewind(&Rewind, netRole == NET_ROLE_LOCAL ? (uint32_t)config->rewindMB << 20 : 0))
+    {
+        killJobScheduler(&Scheduler);
+        killRewind(&Rewind);
+        killReplay(&Replay);
 
-                break;
-            }
-        }
+        return 1;
     }
-    SDL_SetRenderDrawBlendMode(Renderer3D, SDL_BLENDMODE_NONE);
-
-    // Walls
-    x       = -1;
-    SrcRect = (SDL_Rect){.x = 0, .y = 0, .w = 1, .h = texSize};
-    DstRect = (SDL_Rect){.x = 0, .y = 0, .w = 1, .h = 0};
 
-    if (wallTex_)
+    if (netRole == NET_ROLE_CLIENT && (initNet() || connectClient(&Connection, config->connect)))
     {
-        SDL_SetRenderTarget   (Renderer3D, OffScreen3D);
-        SDL_SetRenderDrawColor(Renderer3D, 0, 0, 0, 0);
-        SDL_RenderClear       (Renderer3D);
+        printf("Error - initGame() could not connect to %s\n", config->connect);
+        killJobScheduler(&Scheduler);
+        killRewind(&Rewind);
+        killReplay(&Replay);
+        killNet();
+
+        return 1;
     }
 
-    for (i = 0; i < screenWidth; i++)
+    // an up to date compiled copy is streamed instead; the text map is still there if it won't load
+    MainBoard = findCompiledMap(map, compiled, sizeof(compiled)) ? loadMap(compiled, memory) : NULL;
+
+    // an edited map mid-run would make the recording useless. A board a reload may swap out is on the heap,
+    // like the boards that replace it, so freeBoard() gives it back rather than it staying in the level arena
+    reloading = config->hotReload && Replay.mode == REPLAY_OFF;
+
+    if (MainBoard == NULL && (MainBoard = loadMap(map, reloading ? NULL : memory)) == NULL)
     {
-        RayPos  = CamPos;
-        RayDir  = (struct Vec2){(CamDir.x + x*CamPlane.x)*distInc, (CamDir.y + x*CamPlane.y)*distInc};
-        dist    = 0;
+        printf("Error - initGame() could not load %s\n", map);
+        resetArena(&memory->Level);
+        killJobScheduler(&Scheduler);
+        killRewind(&Rewind);
+        killReplay(&Replay);
 
-        while (dist < drawDistance_)
+        if (netRole == NET_ROLE_CLIENT)
         {
-            addVec2(RayPos, RayDir);
-            dist += distInc;
+            disconnectClient(&Connection);
+            killNet();
+        }
 
-            if ((tileType = tileAtPos(board_, RayPos.x, RayPos.y)) & TILE_OCCLUSION)
-            {
-                if (debug2D)
-                {
-                    SDL_SetRenderDrawColor      (Renderer2D, colorArg4(RGBA_GREEN));
-                    SDL_RenderDrawPoint         (Renderer2D, camera2D_X+RayPos.x, camera2D_Y+RayPos.y);
-                }
+        return 1;
+    }
 
-                height     = (int)(hRatio/dist) & ~1;
-                halfHeight = height/2;
-                offset     = z * (((hRatio)/dist)/tileSize);
+    applyRenderConfig(config, MainBoard, video ? video->Screen : (SDL_Rect){0, 0, config->screenWidth, config->screenHeight});
+    getSettings(MainBoard);
+    lightBoard(MainBoard);
+    spawnObjects(MainBoard);
+    cameraId = playerId;
 
-                if (underwater)
-                    offset += sin(degToRad((int)(i + tick*WAVE_SPEED + RotationArray[camId].angle) * WAVE_WIDTH % 360)) * WAVE_HEIGHT;
+    if (video)
+    {
+        IMG_Init(IMG_INIT_PNG);
+        initRenderer(MainBoard, video->Renderer);
+    }
 
-                DstRect.x  = i;
-                DstRect.y  = halfScreenH - halfHeight + offset;
-                DstRect.h  = height;
-                bottom     = DstRect.y + DstRect.h;
+    // a streamed map is never all there to patch
+    if (reloading && MainBoard->Streamer == NULL)
+        initHotReload(config->map, MainBoard->textureFile);
 
-                if (wallTex_)
-                {
-                    SrcRect.x = (int)((((float)(RayPos.x + RayPos.y)) / tileSize) * texSize) % texSize;
-                    SrcRect.y = texSize * (tileType >> TILE_FLAGS);
+    return 0;
+}
 
-                    if (tileType & TILE_LIQUID)
-                    {
-                        SrcRect.y += sin(degToRad((int)(tick * liquidWaveSpeed + SrcRect.x * liquidWaveWidth) % 360)) * liquidWaveHeight + liquidWaveHeight;
-                        SrcRect.h = texSize - (liquidWaveHeight * 2);
-                    }
-                    else
-                        SrcRect.h = texSize;
+void killGame(struct Memory* memory)
+{
+    if (Replay.mode == REPLAY_RECORDING)
+        saveReplay(&Replay, RecordFile, tick, hashGameState());
 
-                    SDL_RenderCopy(Renderer3D, Texture3D, &SrcRect, &DstRect);
-                }
-                else
-                {
-                    SDL_SetRenderDrawColor(Renderer3D, colorArg3(board_->wallColor), 255);
-                    SDL_RenderDrawLine    (Renderer3D, i, DstRect.y, i, bottom-1);
-                }
+    if (netRole == NET_ROLE_CLIENT)
+    {
+        disconnectClient(&Connection);
+        killNet();
+    }
 
-                if (lightEnable_)
-                {
-                    subtractVec2(RayPos, RayDir);
-                    alpha = board_->lightMap[(int)RayPos.y/tileSize * board_->w + (int)RayPos.x/tileSize];
+    killReplay      (&Replay);
+    killRewind      (&Rewind);
+    killSnapshot    (&Quicksave);
+    free            (SnapshotRegions);
+    printJobStats   (&Scheduler, &TickGraph);
+    killJobScheduler(&Scheduler);
+
+    SnapshotRegions    = NULL;
+    maxSnapshotRegions = 0;
+    killHotReload   ();
+    freeBoard       (MainBoard);
+    resetArena      (&memory->Level);     // the map, entities and particles go all at once
+    killRenderer    ();
+    IMG_Quit        ();
+
+    MainBoard = NULL;
+    netRole   = NET_ROLE_LOCAL;
+}
 
-                    SDL_SetRenderDrawBlendMode(Renderer3D, SDL_BLENDMODE_MOD);
-                    SDL_SetRenderDrawColor    (Renderer3D, alpha, alpha, alpha, 255);
-                    SDL_RenderDrawLine        (Renderer3D, i, DstRect.y, i, bottom-1);
-                }
+// Runs as many fixed ticks as dt covers, so the simulation speed doesn't depend on the frame rate
+void updateGame(struct Config* config, struct Input* input, SDL_Rect screen, double dt)
+{
+    const uint8_t* keyState = input->TextField ? NULL : input->Keys;
+    struct Board* lastBoard = MainBoard;
+    int ticks;
 
-                if (wallFog_)
-                {
-                    if ((alpha = 255 * (dist/board_->fogDistance)) > 255)
-                        alpha = 255;
+    applyHotReload(&MainBoard);
+    applyRenderConfig(config, MainBoard, screen);
 
-                    SDL_SetRenderDrawBlendMode(Renderer3D, FogBlendMode);
-                    SDL_SetRenderDrawColor    (Renderer3D, colorArg3(board_->fogColor), alpha);
-                    SDL_RenderDrawLine        (Renderer3D, i, DstRect.y, i, bottom-1);
-                }
-                break;
-            }
-        }
-        x += xInc;
-        SDL_SetRenderDrawBlendMode(Renderer3D, SDL_BLENDMODE_NONE);
+    if (MainBoard != lastBoard)     // the history and the quicksave hold chunks of the old board
+    {
+        clearRewind(&Rewind);
+        killSnapshot(&Quicksave);
     }
 
-    if (wallTex_)
+    handleSnapshotKeys(keyState);
+    handleCaptureKeys (keyState);
+    tickTime += dt;
+
+    for (ticks = 0; tickTime >= 1.0/TICK_RATE && ticks < MAX_TICKS_PER_UPDATE; ticks++)
     {
-        SDL_SetRenderTarget(Renderer3D, NULL);
-        SDL_RenderCopy     (Renderer3D, OffScreen3D, &ScreenRect, &ScreenRect);
+        stepGame(keyState);
+        tickTime -= 1.0/TICK_RATE;
     }
 
-    SDL_RenderPresent(Renderer3D);
+    if (ticks == MAX_TICKS_PER_UPDATE) // too far behind to catch up; drop the time instead of spiralling
+        tickTime = 0;
 }
 
-void doFire(SDL_Renderer* renderer_, struct Board* board_, int i)
+// The 3D views go in the world layer under everything else, each stretched over its camera's viewport, the
+// minimap over them in a corner
+void drawGame(struct DrawList* list)
 {
-    struct Vec2 hit, direction;
-    static int cooldown = 0;
+    const SDL_Rect ScreenRect = {0, 0, screenWidth, screenHeight};
+    SDL_Rect MinimapRect;
+    SDL_Texture* Frame;
+    Uint64 renderStart;
+    int i;
 
-    if (cooldown > 0)
-        cooldown--;
+    centerCamera            (cameraId);
+    layoutCameras           (numCameras);
+    renderStart = SDL_GetPerformanceCounter();
+    Frame       = renderViews(MainBoard);
+    updateResolutionScaler  (&ResScaler, (SDL_GetPerformanceCounter() - renderStart) * 1000.0 / SDL_GetPerformanceFrequency());
+    captureFrame            (Frame);
 
-    else if (ControlArray[i].commands & COMMAND_FIRE)
+    for (i = 0; i < numCameras; i++)
+        drawSprite(list, LAYER_WORLD, Frame, Views[i].Rect, CameraArray[i].Viewport, 0xFFFFFF, SDL_BLENDMODE_NONE);
+
+    if (minimapEnable)
     {
-        setVec2(direction, RotationArray[i]);
-        addVec2(direction, randomVec2(0, INACCURACY));
-        hit = shootRay(board_, PositionArray[i], direction);
-        subtractVec2(hit, direction);
+        MinimapRect.w = screenWidth  / MINIMAP_DIVISOR;
+        MinimapRect.h = screenHeight / MINIMAP_DIVISOR;
+        MinimapRect.x = screenWidth - MinimapRect.w - MINIMAP_MARGIN;
+        MinimapRect.y = MINIMAP_MARGIN;
 
-        SDL_SetRenderDrawColor(renderer_, colorArg4(FIRE_COLOR1));
-        SDL_RenderDrawLine
-        (
-           renderer_,
-           PositionArray[i].x+camera2D_X,
-           PositionArray[i].y+camera2D_Y,
-           hit.x+camera2D_X,
-           hit.y+camera2D_Y
-        );
-        spawnExplosion(hit, ZeroVec2, EXPLOSION_MAGNITUDE);
-        cooldown = FIRE_COOLDOWN_TIME;
+        renderMinimap();
+        drawSprite(list, LAYER_HUD, MinimapTexture, ScreenRect, MinimapRect, 0xFFFFFF, SDL_BLENDMODE_NONE);
     }
+    else
+        tracerVisible = 0;
 }
 
-void renderBoard(struct Board* board_)
+// Renders where the replay ended through the 8-bit path, the one that needs no window and draws the same on
+// any machine, and checks it against config->reference; a missing reference is written instead
+int compareReference(struct Config* config)
 {
-    int x, y, minY, maxY, minX, maxX;
-    uint16_t tileType;
+    SDL_Surface* Loaded;
+    SDL_Surface* Reference;
+    uint32_t* pixels;
+    int w, h, mismatched, maxDifference, error;
+    float percent;
+
+    if (initSoftwareRenderer(MainBoard))
+    {
+        printf("Error - compareReference() could not set up the renderer\n");
 
-    SDL_Rect SrcRect = (SDL_Rect){.x = 0, .y = 0, .w = texSize, .h = texSize};
-    SDL_Rect DstRect = (SDL_Rect){.x = 0, .y = 0, .w = tileSize, .h = tileSize};
+        return 1;
+    }
 
-    minX = -camera2D_X/tileSize;
-    maxX = (-camera2D_X + screenWidth)/tileSize+1;
-    minY = -camera2D_Y/tileSize;
-    maxY = (-camera2D_Y + screenHeight)/tileSize+1;
+    w      = ResScaler.renderWidth;
+    h      = ResScaler.renderHeight;
+    pixels = malloc((size_t)w * h * sizeof(uint32_t));
+
+    if (pixels == NULL)
+        return 1;
 
-    if (minX < 0)
-        minX = 0;
-    if (minY < 0)
-        minY = 0;
-    if (maxX > board_->w)
-        maxX = board_->w;
-    if (maxY > board_->h)
-        maxY = board_->h;
+    centerCamera  (cameraId);
+    layoutCameras (numCameras);
+    runRenderGraph(MainBoard, pixels, w);
 
-    for (y = minY; y < maxY; y++)
+    if ((Loaded = IMG_Load(config->reference)) == NULL)
     {
-        DstRect.y = y*tileSize + camera2D_Y;
+        error = savePNG(pixels, w, h, config->reference);
 
-        for (x = minX; x < maxX; x++)
-        {
-            tileType = tileAt(board_, x, y);
-            DstRect.x = x*tileSize + camera2D_X;
-            SrcRect.x = 0;
-            SrcRect.y = texSize * (tileType >> TILE_FLAGS);
-            SDL_RenderCopy(Renderer2D, Texture2D, &SrcRect, &DstRect);
+        if (!error)
+            printf("compareReference(): no %s yet, wrote this frame to it\n", config->reference);
 
-            if (lightEnable)
-            {
-                SDL_SetRenderDrawBlendMode(Renderer2D, SDL_BLENDMODE_BLEND);
-                SDL_SetRenderDrawColor(Renderer2D, 0, 0, 0, 255 - board_->lightMap[y*board_->w + x]);
-                SDL_RenderFillRect(Renderer2D, &DstRect);
-                SDL_SetRenderDrawBlendMode(Renderer2D, SDL_BLENDMODE_NONE);
-            }
-        }
+        free(pixels);
+
+        return error;
     }
-}
 
-void centerCamera(int cameraId)
-{
-    camera2D_X = screenWidth/2 -  PositionArray[cameraId].x;
-    camera2D_Y = screenHeight/2 - PositionArray[cameraId].y;
-}
+    Reference = SDL_ConvertSurfaceFormat(Loaded, SDL_PIXELFORMAT_ARGB8888, 0);
+    error     = compareImage(pixels, w, h, Reference, &mismatched, &maxDifference);
 
-void spawnPlayer(int x, int y, float angle_, uint8_t color_[])
-{
-    EntityArray[entityCount] =
-      TYPE_POSITION
-    | TYPE_TRANSFORM
-    | TYPE_VELOCITY
-    | TYPE_FORCE
-    | TYPE_ROTATION
-    | TYPE_TORQUE
-    | TYPE_COLLIDABLE
-    | TYPE_CONTROL
-    | TYPE_VISIBLE;
+    if (!error)
+    {
+        percent = mismatched * 100.0f / (w * h);
+        error   = percent > config->referenceTolerance;
 
-    PositionArray             [entityCount]              = (struct Vec2)       {.x = halfTile + tileSize*x, .y = halfTile + tileSize*x};
-    TransformArray            [entityCount]              = ZeroVec2;
-    VelocityArray             [entityCount]              = VelocityDefault;
-    ForceArray                [entityCount]              = ForceDefault;
-    RotationArray             [entityCount].angle        = degToRad(angle_);
-    setVec2Angle(RotationArray[entityCount], angle_);
-    TorqueArray               [entityCount]              = TorqueDefault;
-    CollidableArray           [entityCount]              = (struct Collidable) {.w = tileSize, .h = tileSize};
-    VisibleArray              [entityCount]              = (struct Visible)    {.type = VISIBLE_HITBOX, .animation = 0, .frame = 0};
-    ControlArray              [entityCount].type         = CONTROL_ROTATIONAL | CONTROL_KEYBOARD;// | CONTROL_MOUSELOOK;
-    ControlArray              [entityCount].inputChannel = 0;
-    setColor(VisibleArray     [entityCount].color, color_);
-    playerId = entityCount;
+        printf("compareReference(): %d of %d pixels differ from %s (%.2f%%, %.2f%% allowed), largest difference %d - %s\n",
+               mismatched, w * h, config->reference, percent, config->referenceTolerance, maxDifference, error ? "FAILED" : "ok");
+    }
 
-    entityCount++;
-    printf("entityCount: %d\n", entityCount);
+    SDL_FreeSurface(Reference);
+    SDL_FreeSurface(Loaded);
+    free(pixels);
+
+    return error;
 }
 
-void initRenderer(struct Board* board_)
+// Plays config->replay through without a window or any drawing, as fast as the simulation goes; then, given
+// config->reference, checks the last frame against it
+int runHeadless(struct Config* config, struct Memory* memory)
 {
-    uint8_t transColor[3] = {152, 0, 136};
-    SDL_Surface* TempSurface = IMG_Load(board_->textureFile);
-    SDL_SetColorKey(TempSurface, SDL_TRUE, SDL_MapRGB(TempSurface->format, transColor[0], transColor[1], transColor[2]));
+    Uint64 start;
+    double ms;
+    int error;
 
-    Window2D      = SDL_CreateWindow("lol", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, SCREEN_WIDTH * RES_SCALE, SCREEN_HEIGHT * RES_SCALE, SDL_WINDOW_SHOWN | (BORDERLESS ? SDL_WINDOW_BORDERLESS : 0));
-    Window3D      = SDL_CreateWindow("lol3D", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, SCREEN_WIDTH * RES_SCALE, SCREEN_HEIGHT * RES_SCALE, SDL_WINDOW_SHOWN | (BORDERLESS ? SDL_WINDOW_BORDERLESS : 0) | (FULL_SCREEN ? SDL_WINDOW_FULLSCREEN : 0));
-    Renderer2D    = SDL_CreateRenderer(Window2D, -1, SDL_RENDERER_ACCELERATED);
-    Renderer3D    = SDL_CreateRenderer(Window3D, -1, SDL_RENDERER_ACCELERATED);
-    Texture2D     = SDL_CreateTextureFromSurface(Renderer2D, TempSurface);
-    Texture3D     = SDL_CreateTextureFromSurface(Renderer3D, TempSurface);
-    OffScreen3D   = SDL_CreateTexture(Renderer3D, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, SCREEN_WIDTH, SCREEN_HEIGHT);
-    SDL_SetTextureBlendMode(OffScreen3D, SDL_BLENDMODE_BLEND);
-    FogBlendMode  = SDL_ComposeCustomBlendMode(SDL_BLENDFACTOR_SRC_ALPHA, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD, SDL_BLENDFACTOR_ZERO, SDL_BLENDFACTOR_DST_ALPHA, SDL_BLENDOPERATION_ADD);
+    if (config->replay[0] == '\0')
+    {
+        printf("Error - runHeadless(): no replay given\n");
 
-    TempSurface         = IMG_Load(board_->bgFile);
-    BackgroundTexture   = SDL_CreateTextureFromSurface(Renderer3D, TempSurface);
+        return 1;
+    }
 
-    BackgroundSrcRect.x = 0;
-    BackgroundSrcRect.w = TempSurface->w / 4;
-    BackgroundDstRect.x = 0;
-    BackgroundDstRect.w = screenWidth;
+    if (initGame(config, memory, NULL))
+        return 1;
 
-    if (backgroundTop && backgroundBottom)
+    if (Replay.mode != REPLAY_PLAYING)
     {
-        BackgroundSrcRect.y = 0;
-        BackgroundSrcRect.h = TempSurface->h;
-        BackgroundDstRect.y = 0;
-        BackgroundDstRect.h = screenHeight;
-    }
+        killGame(memory);
 
-    else if (backgroundTop && !backgroundBottom)
-    {
-        BackgroundSrcRect.y = 0;
-        BackgroundSrcRect.h = TempSurface->h/2;
-        BackgroundDstRect.y = 0;
-        BackgroundDstRect.h = screenHeight/2;
+        return 1;
     }
-    else if (!backgroundTop && backgroundBottom)
+
+    start = SDL_GetPerformanceCounter();
+
+    while (tick < Replay.numTicks)
+        tickGame(NULL);
+
+    ms    = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    error = endReplay();
+
+    printf("runHeadless(): %lld ticks in %.1f ms, %.4f ms per tick\n", tick, ms, tick ? ms / tick : 0.0);
+
+    if (config->reference[0])
     {
-        BackgroundSrcRect.y = TempSurface->h/2;
-        BackgroundSrcRect.h = TempSurface->h/2;
-        BackgroundDstRect.y = screenHeight/2;
-        BackgroundDstRect.h = screenHeight/2;
+        IMG_Init(IMG_INIT_PNG);
+        error |= compareReference(config);
     }
 
-    SDL_RenderSetScale(Renderer2D, RES_SCALE, RES_SCALE);
-    SDL_RenderSetScale(Renderer3D, RES_SCALE, RES_SCALE);
-    SDL_FreeSurface(TempSurface);
+    killGame(memory);
+
+    return error;
 }
 
-void spawnObjects(struct Board* board_)
+// Loads config->compile the way the game does, lights it and writes it next to itself as a compiled map,
+// which initGame() then streams in its place
+int runCompile(struct Config* config, struct Memory* memory)
 {
-    int i;
+    char compiled[CONFIG_STRING_SIZE + sizeof(MAP_FILE_EXTENSION)];
+    struct Board* Board;
+    int error;
 
-    for (i = 0; i < board_->numObjects; i++)
+    findCompiledMap(config->compile, compiled, sizeof(compiled));
+
+    if (!strcmp(compiled, config->compile) || isCompiledMap(config->compile))
     {
-        switch (board_->objects[i].type)
-        {
-        case OBJECT_PLAYER:
-            spawnPlayer(board_->objects[i].x, board_->objects[i].y, board_->objects[i].angle, RGBA_GREEN);
-            break;
-        default:
-            break;
-        }
+        printf("Error - runCompile(): %s is compiled already\n", config->compile);
+
+        return 1;
     }
-}
 
-void getSettings(struct Board* board_)
-{
-    texSize          = board_->texSize;
-    tileSize         = board_->tileSize;
-    halfTile         = tileSize/2;
-    quarterTile      = tileSize/4;
-    wallFog          = board_->wallFog;
-    floorFog         = board_->floorFog;
-    ceilingFog       = board_->ceilingFog;
-    wallTex          = board_->wallTex;
-    floorTex         = board_->floorTex;
-    ceilingTex       = board_->ceilingTex;
-    lightEnable      = board_->lightEnable;
-    minLight         = board_->minLight;
-    maxLight         = board_->maxLight;
-    drawDistance     = board_->drawDistance;
-    backClipPlane    = board_->backClipPlane;
-    backgroundTop    = board_->backgroundTop;
-    backgroundBottom = board_->backgroundBottom;
+    if ((Board = loadMap(config->compile, memory)) == NULL)
+    {
+        printf("Error - runCompile() could not load %s\n", config->compile);
 
-    if (maxLight > 255) maxLight = 255;
+        return 1;
+    }
+
+    initFastMath();
+    getSettings(Board);
+    lightBoard(Board);
+    error = compileMap(Board, compiled);
+    freeBoard(Board);
+    resetArena(&memory->Level);
+
+    return error;
 }
 
-/*
-void replaceColor(SDL_Surface* surface_, SDL_Color DstColor, SDL_Color SrcColor)
+// A dedicated server: the simulation without a window, driven by the clients' inputs at TICK_RATE until
+// config->serverSeconds run out, or for good at 0. config->bots local clients put load on it.
+int runServer(struct Config* config, struct Memory* memory)
 {
-    int i, j;
-    int numColors = surface_->format->palette->ncolors;
+    struct NetInput Input;
+    Uint64 start, tickStart, simStart, now, next;
+    Uint64 period = SDL_GetPerformanceFrequency() / TICK_RATE;
+    double tickMs = 0, simMs = 0, seconds;
+    int slot, ticks = 0, peakClients = 0;
 
-    for (i = 0; i < numColors; i++)
+    netRole = NET_ROLE_SERVER;
+
+    if (initNet() || initGame(config, memory, NULL))
     {
-        if (surface_->format->palette->ncolors[i].r != DstColor.r) break;
-        if (surface_->format->palette->ncolors[i].g != DstColor.g) break;
-        if (surface_->format->palette->ncolors[i].b != DstColor.b) break;
+        netRole = NET_ROLE_LOCAL;
+        killNet();
 
-        surface_->format->palette->ncolors[i] = SrcColor;
+        return 1;
     }
-}
-*/
 
-int initGame()
-{
-    struct Board* MainBoard;
+    if (startServer(&Server, config->server))
+    {
+        killGame(memory);
+        killNet();
 
-    // Initialization
-    initArrays();
-    MainBoard = loadMap("map2.txt");
-    getSettings(MainBoard);
-    lightBoard(MainBoard);
-    spawnObjects(MainBoard);
-    cameraId = playerId;
+        return 1;
+    }
 
-    SDL_Init(SDL_INIT_EVERYTHING);
-    IMG_Init(IMG_INIT_PNG);
-    SDL_ShowCursor(SDL_DISABLE);
-    initRenderer(MainBoard);
+    printf("runServer(): listening on port %d\n", config->server);
 
-    quit = 0;
+    if (config->bots)
+        startBots(&Bots, config->bots, config->server, MOVE_COMMANDS);
 
-    while (!quit)
-    {
-        // Input and logic
-        getInput(0, ControlArray[0].type);
+    start = next = SDL_GetPerformanceCounter();
 
-        if (tick % 31 == 0) // solve issue with this not working if it runs too frequently
-            doAI(MainBoard);
+    while (config->serverSeconds == 0 || ticks < config->serverSeconds * TICK_RATE)
+    {
+        tickStart = SDL_GetPerformanceCounter();
+        pollServer(&Server, spawnClientPlayer, MainBoard);
 
-        doControl();
+        for (slot = 0; slot < NET_MAX_CLIENTS; slot++)
+        {
+            if (nextServerInput(&Server, slot, &Input))
+            {
+                InputChannelArray[slot + 1] = Input.commands;
+                InputAimArray[slot + 1]     = (struct Vec2){Input.aimX, Input.aimY};
+            }
+            else
+                InputChannelArray[slot + 1] = 0;
+        }
 
-        // Physics
-        doRotationAndTorque();
-        doVelocity();
-        doTransform();
-        doCollidable(MainBoard);
-        doPosition();
+        simStart = SDL_GetPerformanceCounter();
+        tickGame(NULL);
+        simMs += msSince(simStart);
 
-        // Render
-        SDL_SetRenderDrawColor  (Renderer2D, 0, 0, 0, 255);
-        SDL_RenderClear         (Renderer2D);
-        //SDL_SetRenderDrawColor  (Renderer3D, 0x00, 0x00, 0x00, 0xFF);
-        //SDL_RenderClear         (Renderer3D);
+        gatherNetSnapshot(&Server.Current);
+        gatherNetTiles(&Server, MainBoard);
+        cullNetEntities(&Server, MainBoard);
+        sendSnapshots(&Server);
+        tickMs += msSince(tickStart);
+        peakClients = max(peakClients, Server.numClients);
+        ticks++;
 
-        centerCamera            (cameraId);
-        renderBoard             (MainBoard);
-        raycast                 (MainBoard, cameraId);
-        renderVisible           (Renderer2D);
-        doFire                  (Renderer2D, MainBoard, playerId);      // should be separated to logic and render
-        renderParticles         (Renderer2D, MainBoard);
-        renderCrosshair         (Renderer2D, playerId);
-        SDL_RenderPresent       (Renderer2D);
-        //SDL_RenderPresent       (Renderer3D);
+        next += period;
+        now   = SDL_GetPerformanceCounter();
 
-        // End cycle
-        SDL_Delay(1000.0/60.0);
-        tick++;
+        if (next > now)
+            SDL_Delay((Uint32)((next - now) * 1000 / SDL_GetPerformanceFrequency()));
+        else
+            next = now;     // behind; carry on from here rather than rushing ticks to catch up
     }
 
-    // Quit
-    SDL_DestroyTexture  (Texture2D);
-    SDL_DestroyRenderer (Renderer2D);
-    SDL_DestroyWindow   (Window2D);
+    seconds = msSince(start) / 1000.0;
+
+    if (config->bots)
+        stopBots(&Bots);
 
-    SDL_DestroyTexture  (Texture3D);
-    SDL_DestroyRenderer (Renderer3D);
-    SDL_DestroyWindow   (Window3D);
+    printf("runServer(): %d ticks in %.1f s for %d clients, %.3f ms per tick (%.3f simulating, %.3f networking)\n",
+           ticks, seconds, peakClients, tickMs / max(ticks, 1), simMs / max(ticks, 1), (tickMs - simMs) / max(ticks, 1));
+    printf("runServer(): per client %.2f KB/s out, %.2f KB/s in; %.0f bytes per packet out, %d whole snapshots\n",
+           Server.Stats.bytesOut / 1024.0 / seconds / max(peakClients, 1),
+           Server.Stats.bytesIn  / 1024.0 / seconds / max(peakClients, 1),
+           (double)Server.Stats.bytesOut / max(Server.Stats.packetsOut, 1), Server.Stats.fullSnapshots);
 
-    IMG_Quit();
-    SDL_Quit();
+    stopServer(&Server);
+    killGame(memory);
+    killNet();
 
     return 0;
 }
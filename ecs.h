@@ -0,0 +1,19 @@
+#ifndef ECS_H
+#define ECS_H
+
+#include <SDL2/SDL.h>
+#include "config.h"
+#include "memory.h"
+#include "input.h"
+#include "video.h"
+
+// The game itself; the entities, map and renderer internals stay in ecs.c and game.c runs it as a state
+int  initGame   (struct Config* config, struct Memory* memory, struct Video* video);
+void killGame   (struct Memory* memory);
+void updateGame (struct Config* config, struct Input* input, SDL_Rect screen, double dt);
+void drawGame   (struct DrawList* list);
+int  runHeadless(struct Config* config, struct Memory* memory);
+int  runServer  (struct Config* config, struct Memory* memory);
+int  runCompile (struct Config* config, struct Memory* memory);
+
+#endif
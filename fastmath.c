@@ -0,0 +1,97 @@
+#include "fastmath.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+float SinDegTable[360];
+
+void initFastMath()
+{
+    int i;
+
+    for (i = 0; i < 360; i++)
+        SinDegTable[i] = sin(i * M_PI / 180.0);
+}
+
+#ifdef __SSE2__
+// fastSin() four at a time; same folding and polynomial
+static inline __m128 sin4(__m128 x)
+{
+    const __m128 halfPi = _mm_set1_ps(HALF_PI_F);
+    const __m128 pi     = _mm_set1_ps(PI_F);
+    const __m128 sign   = _mm_set1_ps(-0.0f);
+    __m128 turns, x2, folded, ax, over;
+
+    // round to the nearest turn; the float->int conversion rounds to nearest by default
+    turns = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.0f/TWO_PI_F))));
+    x     = _mm_sub_ps(x, _mm_mul_ps(turns, _mm_set1_ps(TWO_PI_F)));
+
+    // |x| > pi/2: x = sign(x)*pi - x
+    ax     = _mm_andnot_ps(sign, x);
+    over   = _mm_cmpgt_ps(ax, halfPi);
+    folded = _mm_sub_ps(_mm_or_ps(pi, _mm_and_ps(sign, x)), x);
+    x      = _mm_or_ps(_mm_and_ps(over, folded), _mm_andnot_ps(over, x));
+
+    x2 = _mm_mul_ps(x, x);
+
+    return _mm_mul_ps(x, _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(x2,
+                         _mm_add_ps(_mm_set1_ps(-1.0f/6), _mm_mul_ps(x2,
+                         _mm_add_ps(_mm_set1_ps(1.0f/120), _mm_mul_ps(x2,
+                         _mm_add_ps(_mm_set1_ps(-1.0f/5040), _mm_mul_ps(x2, _mm_set1_ps(1.0f/362880))))))))));
+}
+#endif
+
+void sinCosBatch(const float* angles, float* cosOut, float* sinOut, int count)
+{
+    int i = 0;
+
+#ifdef __SSE2__
+    __m128 a;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        a = _mm_loadu_ps(angles + i);
+        _mm_storeu_ps(sinOut + i, sin4(a));
+        _mm_storeu_ps(cosOut + i, sin4(_mm_add_ps(a, _mm_set1_ps(HALF_PI_F))));
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        sinOut[i] = fastSin(angles[i]);
+        cosOut[i] = fastCos(angles[i]);
+    }
+}
+
+// Unit vectors in place; length gets the old lengths unless it's NULL
+void normaliseBatch(float* x, float* y, float* length, int count)
+{
+    int i = 0;
+
+#ifdef __SSE2__
+    __m128 vx, vy, len, scale, nonzero;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        vx      = _mm_loadu_ps(x + i);
+        vy      = _mm_loadu_ps(y + i);
+        len     = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)));
+        nonzero = _mm_cmpgt_ps(len, _mm_setzero_ps());
+        scale   = _mm_and_ps(nonzero, _mm_div_ps(_mm_set1_ps(1.0f), len));
+        _mm_storeu_ps(x + i, _mm_mul_ps(vx, scale));
+        _mm_storeu_ps(y + i, _mm_mul_ps(vy, scale));
+
+        if (length)
+            _mm_storeu_ps(length + i, len);
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        if (length)
+            length[i] = normalise(&x[i], &y[i]);
+        else
+            normalise(&x[i], &y[i]);
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef FASTMATH_H
+#define FASTMATH_H
+
+#include <math.h>
+#include <stdint.h>
+
+#define PI_F            3.14159265f
+#define HALF_PI_F       1.57079633f
+#define TWO_PI_F        6.28318531f
+
+// Replacements for libm in per-tick code. Accuracy is around 1e-6 for sin/cos and 1e-5 radians for atan2,
+// plenty for movement and effects; anything that's stored or compared across frames still uses libm.
+
+extern float SinDegTable[360];  // whole degrees, for the effects that already work in them
+
+void initFastMath   (void);
+void sinCosBatch    (const float* angles, float* cosOut, float* sinOut, int count);
+void normaliseBatch (float* x, float* y, float* length, int count);
+
+static inline float lengthSquared(float x, float y)
+{
+    return x*x + y*y;
+}
+
+static inline float fastLength(float x, float y)
+{
+    return sqrtf(x*x + y*y);
+}
+
+// Scales (x, y) to unit length and returns the old length; a zero vector stays zero
+static inline float normalise(float* x, float* y)
+{
+    float length = sqrtf(*x * *x + *y * *y);
+    float scale  = (length > 0) ? 1.0f / length : 0;
+
+    *x *= scale;
+    *y *= scale;
+
+    return length;
+}
+
+static inline int wrapDeg(int degrees)
+{
+    degrees %= 360;
+
+    return (degrees < 0) ? degrees + 360 : degrees;
+}
+
+static inline float sinDeg(int degrees)
+{
+    return SinDegTable[wrapDeg(degrees)];
+}
+
+static inline float cosDeg(int degrees)
+{
+    return SinDegTable[wrapDeg(degrees + 90)];
+}
+
+// Odd polynomial on [-pi/2, pi/2] after folding the angle into that range
+static inline float fastSin(float x)
+{
+    float x2;
+
+    x -= TWO_PI_F * floorf(x * (1.0f/TWO_PI_F) + 0.5f);     // [-pi, pi]
+
+    if (x > HALF_PI_F)
+        x = PI_F - x;
+    else if (x < -HALF_PI_F)
+        x = -PI_F - x;
+
+    x2 = x*x;
+
+    return x * (1.0f + x2 * (-1.0f/6 + x2 * (1.0f/120 + x2 * (-1.0f/5040 + x2 * (1.0f/362880)))));
+}
+
+static inline float fastCos(float x)
+{
+    return fastSin(x + HALF_PI_F);
+}
+
+static inline float fastAtan2(float y, float x)
+{
+    const float ax = fabsf(x), ay = fabsf(y);
+    const float hi = (ax > ay) ? ax : ay;
+    const float lo = (ax > ay) ? ay : ax;
+    float a, s, r;
+
+    if (hi == 0)
+        return 0;
+
+    a = lo / hi;
+    s = a*a;
+    r = ((((0.0208351f * s - 0.0851330f) * s + 0.1801410f) * s - 0.3302995f) * s + 0.9998660f) * a;
+
+    if (ay > ax) r = HALF_PI_F - r;
+    if (x < 0)   r = PI_F - r;
+    if (y < 0)   r = -r;
+
+    return r;
+}
+
+#endif
@@ -0,0 +1,104 @@
+#include "game.h"
+#include "state.h"
+#include "system.h"
+#include "ecs.h"
+#include <stdio.h>
+#include <string.h>
+
+// ecs.c keeps the game in globals, so there is only ever one; background updates and draws
+// don't run as the current state, so the callbacks find their data here
+static struct State* GameState;
+
+int initState_Game(struct System* system)
+{
+    struct GameData* Data = GameState->Data;
+
+    printf("initState_Game()\n");
+
+    if (initGame(&system->Config, &system->Memory, &system->Video))
+    {
+        printf("Error - initState_Game() failed\n");
+
+        return 1;
+    }
+
+    Data->loaded = 1;
+    SDL_ShowCursor(SDL_DISABLE);
+
+    return 0;
+}
+
+int killState_Game(struct System* system)
+{
+    struct GameData* Data = GameState->Data;
+
+    printf("killState_Game()\n");
+
+    if (Data->loaded)
+        killGame(&system->Memory);
+
+    Data->loaded = 0;
+    SDL_ShowCursor(SDL_ENABLE);
+
+    return 0;
+}
+
+int resumeState_Game(struct System* system)
+{
+    printf("resumeState_Game()\n");
+    SDL_ShowCursor(SDL_DISABLE);
+
+    return 0;
+}
+
+int pauseState_Game(struct System* system)
+{
+    printf("pauseState_Game()\n");
+    SDL_ShowCursor(SDL_ENABLE);
+
+    return 0;
+}
+
+int updateState_Game(struct System* system, double dt)
+{
+    struct GameData* Data = GameState->Data;
+
+    if (Data->loaded)
+        updateGame(&system->Config, &system->Input, system->Video.Screen, dt);
+
+    return 0;
+}
+
+int drawState_Game(struct System* system, double dt)
+{
+    struct GameData* Data = GameState->Data;
+
+    if (Data->loaded)
+        drawGame(system->Video.DrawList);
+
+    return 0;
+}
+
+struct State* createState_Game(struct Memory* memory)
+{
+    struct State* State = allocPool(&memory->States);
+
+    if (State == NULL)
+        return NULL;
+
+    memset(State, 0, sizeof(struct State));
+
+    State->type             = STATE_KILL_ON_EXIT | STATE_BACKGROUND_DRAW;
+    State->enable_update    = 1;
+    State->enable_draw      = 1;
+    State->Data             = (struct GameData*)callocArena(&memory->Persistent, 1, sizeof(struct GameData));
+    State->init             = initState_Game;
+    State->kill             = killState_Game;
+    State->resume           = resumeState_Game;
+    State->pause            = pauseState_Game;
+    State->update           = updateState_Game;
+    State->draw             = drawState_Game;
+    GameState               = State;
+
+    return State;
+}
@@ -0,0 +1,13 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include "memory.h"
+
+struct GameData
+{
+    int loaded;
+};
+
+struct State* createState_Game(struct Memory* memory);
+
+#endif
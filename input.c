@@ -6,6 +6,7 @@ int initInput(struct Input* input)
 {
     printf("initInput()\n");
     input->TextField = NULL;
+    input->toggleConsole = 0;
 
     return 0;
 }
@@ -13,10 +14,13 @@ int initInput(struct Input* input)
 int pollEvents(struct Input* input)
 {
     SDL_Event* event = &input->Event;
-    char* buffer     = input->TextField->buffer;
-    int* cursor      = &input->TextField->cursor;
+    char* buffer;
+    char* clipboard;
+    int* cursor;
     int key;
 
+    input->toggleConsole = 0;
+
     while (SDL_PollEvent(event))
     {
         if (event->type == SDL_QUIT)
@@ -30,7 +34,19 @@ int pollEvents(struct Input* input)
             if (key == SDLK_ESCAPE)
                 return 1;
 
-            else if (key == SDLK_RETURN)
+            if (key == SDLK_BACKQUOTE)
+            {
+                input->toggleConsole = 1;
+                continue;
+            }
+
+            if (input->TextField == NULL)
+                continue;
+
+            buffer = input->TextField->buffer;
+            cursor = &input->TextField->cursor;
+
+            if (key == SDLK_RETURN && *cursor < MAX_TEXT_INPUT-1)
             {
                 buffer[(*cursor)++] = '\n';
                 buffer[*cursor] = '\0';
@@ -43,18 +59,24 @@ int pollEvents(struct Input* input)
 
             else if (event->key.keysym.sym == SDLK_v && SDL_GetModState() & KMOD_CTRL)
             {
-                strncpy(buffer, SDL_GetClipboardText(), MAX_INPUT);
+                clipboard = SDL_GetClipboardText();
+                strncpy(buffer, clipboard, MAX_TEXT_INPUT-1);
+                buffer[MAX_TEXT_INPUT-1] = '\0';
                 *cursor = strlen(buffer);
+                SDL_free(clipboard);
             }
         }
-        else if (event->type == SDL_TEXTINPUT)
+        else if (event->type == SDL_TEXTINPUT && input->TextField != NULL && event->text.text[0] != '`')
         {
+            buffer = input->TextField->buffer;
+            cursor = &input->TextField->cursor;
+
             if (!(SDL_GetModState() & KMOD_CTRL && (event->text.text[0] == 'c' ||
                                                     event->text.text[0] == 'C' ||
                                                     event->text.text[0] == 'v' ||
                                                     event->text.text[0] == 'V')))
             {
-                if (*cursor < MAX_INPUT)
+                if (*cursor < MAX_TEXT_INPUT-1)
                 {
                     buffer[(*cursor)++] = event->text.text[0];
                     buffer[*cursor] = '\0';
@@ -87,4 +109,6 @@ int initTextField(struct TextField* textField)
 {
     textField->cursor = 0;
     textField->buffer[0] = '\0';
+
+    return 0;
 }
@@ -4,11 +4,11 @@
 #include <SDL2/SDL.h>
 //#include "config.h"
 
-#define MAX_INPUT 512
+#define MAX_TEXT_INPUT 512
 
 struct TextField
 {
-    char buffer[MAX_INPUT];
+    char buffer[MAX_TEXT_INPUT];
     int cursor;
 };
 
@@ -16,12 +16,14 @@ struct Input
 {
     SDL_Event Event;
     uint8_t* Keys;
-    struct TextField* TextField;
+    struct TextField* TextField;    // NULL unless something is taking text, e.g. the console
+    int toggleConsole;
 };
 
 int initInput(struct Input* input);// include later for key configs etc , struct Config* config);
 int killInput(struct Input* input);
 int execInput(struct Input* input);
+int initTextField(struct TextField* textField);
 
 #endif
 
@@ -0,0 +1,439 @@
+#include "jobs.h"
+#include <stdio.h>
+#include <string.h>
+
+#define QUEUE_MASK (JOB_QUEUE_SIZE-1)
+
+static double ticksToMs(Uint64 ticks)
+{
+    return ticks * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+static int pushWork(struct JobScheduler* scheduler, int self, struct WorkItem item)
+{
+    struct WorkQueue* Queue = &scheduler->Queues[self];
+    int pushed = 0;
+
+    SDL_AtomicLock(&Queue->Lock);
+
+    if (Queue->tail - Queue->head < JOB_QUEUE_SIZE)
+    {
+        Queue->Items[Queue->tail++ & QUEUE_MASK] = item;
+        SDL_AtomicIncRef(&scheduler->queued);
+        pushed = 1;
+    }
+
+    SDL_AtomicUnlock(&Queue->Lock);
+
+    return pushed;
+}
+
+static int popWork(struct JobScheduler* scheduler, int self, struct WorkItem* item)
+{
+    struct WorkQueue* Queue = &scheduler->Queues[self];
+    int popped = 0;
+
+    SDL_AtomicLock(&Queue->Lock);
+
+    if (Queue->tail != Queue->head)
+    {
+        *item = Queue->Items[--Queue->tail & QUEUE_MASK];
+        SDL_AtomicAdd(&scheduler->queued, -1);
+        popped = 1;
+    }
+
+    SDL_AtomicUnlock(&Queue->Lock);
+
+    return popped;
+}
+
+static int stealWork(struct JobScheduler* scheduler, int self, struct WorkItem* item)
+{
+    struct WorkQueue* Queue;
+    int i, victim, stolen = 0;
+
+    for (i = 1; i < scheduler->numThreads && !stolen; i++)
+    {
+        victim = (self + i) % scheduler->numThreads;
+        Queue  = &scheduler->Queues[victim];
+
+        if (Queue->tail == Queue->head)     // racy peek, just to skip the lock on empty queues
+            continue;
+
+        SDL_AtomicLock(&Queue->Lock);
+
+        if (Queue->tail != Queue->head)
+        {
+            *item = Queue->Items[Queue->head++ & QUEUE_MASK];
+            SDL_AtomicAdd(&scheduler->queued, -1);
+            stolen = 1;
+        }
+
+        SDL_AtomicUnlock(&Queue->Lock);
+    }
+
+    if (stolen)
+        scheduler->steals[self]++;
+
+    return stolen;
+}
+
+static void executeWork(struct JobScheduler* scheduler, int self, struct WorkItem item);
+
+static void wakeWorkers(struct JobScheduler* scheduler)
+{
+    SDL_LockMutex(scheduler->Lock);
+    SDL_CondBroadcast(scheduler->Wake);
+    SDL_UnlockMutex(scheduler->Lock);
+}
+
+// Split the job into pieces on self's queue; other threads steal what self doesn't get to
+static void readyJob(struct JobScheduler* scheduler, int index, int self)
+{
+    struct Job* Job = &scheduler->Graph->Jobs[index];
+    struct WorkItem Item = {index, 0, 1};
+    int count, size, i;
+
+    if (Job->countSource)
+        Job->count = *Job->countSource;
+
+    count = Job->count;
+
+    if (Job->chunkSize <= 0 || count <= 0)
+        Job->chunks = 1;
+    else
+    {
+        size = Job->chunkSize;
+
+        if ((count + size-1) / size > JOB_MAX_CHUNKS)
+            size = (count + JOB_MAX_CHUNKS-1) / JOB_MAX_CHUNKS;
+
+        Job->chunks = (count + size-1) / size;
+    }
+
+    SDL_AtomicSet(&Job->chunksLeft, Job->chunks);
+
+    for (i = 0; i < Job->chunks; i++)
+    {
+        if (Job->chunkSize > 0)
+        {
+            Item.begin = (count <= 0) ? 0 : count * i / Job->chunks;
+            Item.end   = (count <= 0) ? 0 : count * (i+1) / Job->chunks;
+        }
+
+        if (pushWork(scheduler, self, Item) == 0)
+            executeWork(scheduler, self, Item);
+    }
+
+    if (scheduler->numThreads > 1)
+        wakeWorkers(scheduler);
+}
+
+static void finishJob(struct JobScheduler* scheduler, int index, int self)
+{
+    struct JobGraph* Graph = scheduler->Graph;
+    uint64_t dependents = Graph->Jobs[index].dependents;
+    int i;
+
+    for (i = 0; dependents; i++, dependents >>= 1)
+        if ((dependents & 1) && SDL_AtomicAdd(&Graph->Jobs[i].waitingOn, -1) == 1)
+            readyJob(scheduler, i, self);
+
+    // last, so the graph can't look finished while a dependent is still being made ready
+    SDL_AtomicAdd(&scheduler->jobsLeft, -1);
+}
+
+static void executeWork(struct JobScheduler* scheduler, int self, struct WorkItem item)
+{
+    struct Job* Job = &scheduler->Graph->Jobs[item.job];
+    Uint64 start, end;
+
+    start = SDL_GetPerformanceCounter();
+
+    if (Job->chunkSize <= 0 || item.end > item.begin)
+        Job->function(Job->data, item.begin, item.end);
+
+    end = SDL_GetPerformanceCounter();
+    scheduler->busy[self] += end - start;
+
+    SDL_AtomicLock(&Job->TimeLock);
+
+    if (Job->start == 0 || start < Job->start)
+        Job->start = start;
+
+    if (end > Job->end)
+        Job->end = end;
+
+    SDL_AtomicUnlock(&Job->TimeLock);
+
+    if (SDL_AtomicAdd(&Job->chunksLeft, -1) == 1)
+        finishJob(scheduler, item.job, self);
+}
+
+static int runWork(struct JobScheduler* scheduler, int self)
+{
+    struct WorkItem Item;
+
+    if (popWork(scheduler, self, &Item) || stealWork(scheduler, self, &Item))
+    {
+        executeWork(scheduler, self, Item);
+
+        return 1;
+    }
+
+    return 0;
+}
+
+static int workerThread(void* data)
+{
+    struct Worker* Worker = data;
+    struct JobScheduler* Scheduler = Worker->Scheduler;
+    int running = 1;
+
+    while (running)
+    {
+        if (runWork(Scheduler, Worker->index))
+            continue;
+
+        SDL_LockMutex(Scheduler->Lock);
+
+        while (Scheduler->running && SDL_AtomicGet(&Scheduler->queued) == 0)
+            SDL_CondWait(Scheduler->Wake, Scheduler->Lock);
+
+        running = Scheduler->running;
+        SDL_UnlockMutex(Scheduler->Lock);
+    }
+
+    return 0;
+}
+
+// numWorkers < 0 starts one per core besides the main thread's; 0 runs every graph on the main thread
+int initJobScheduler(struct JobScheduler* scheduler, int numWorkers)
+{
+    char name[16];
+    int i;
+
+    memset(scheduler, 0, sizeof(struct JobScheduler));
+
+    if (numWorkers < 0)
+        numWorkers = SDL_GetCPUCount() - 1;
+
+    numWorkers = SDL_max(0, SDL_min(numWorkers, MAX_WORKERS));
+
+    scheduler->Lock       = SDL_CreateMutex();
+    scheduler->Wake       = SDL_CreateCond();
+    scheduler->running    = 1;
+    scheduler->numThreads = 1;
+    scheduler->Workers[0] = (struct Worker){scheduler, 0};
+
+    if (scheduler->Lock == NULL || scheduler->Wake == NULL)
+    {
+        printf("Error - initJobScheduler() could not create the lock: %s\n", SDL_GetError());
+        SDL_DestroyCond(scheduler->Wake);
+        SDL_DestroyMutex(scheduler->Lock);
+        scheduler->Lock = NULL;
+        scheduler->Wake = NULL;
+
+        return 1;
+    }
+
+    for (i = 1; i <= numWorkers; i++)
+    {
+        scheduler->Workers[i] = (struct Worker){scheduler, i};
+        snprintf(name, sizeof(name), "jobs%d", i);
+
+        if ((scheduler->Threads[i-1] = SDL_CreateThread(workerThread, name, &scheduler->Workers[i])) == NULL)
+        {
+            printf("Error - initJobScheduler() started %d of %d workers: %s\n", i-1, numWorkers, SDL_GetError());
+            break;
+        }
+
+        scheduler->numThreads++;
+    }
+
+    printf("initJobScheduler(): %d threads\n", scheduler->numThreads);
+
+    return 0;
+}
+
+void killJobScheduler(struct JobScheduler* scheduler)
+{
+    int i;
+
+    if (scheduler->Lock == NULL)
+        return;
+
+    SDL_LockMutex(scheduler->Lock);
+    scheduler->running = 0;
+    SDL_CondBroadcast(scheduler->Wake);
+    SDL_UnlockMutex(scheduler->Lock);
+
+    for (i = 0; i < scheduler->numThreads-1; i++)
+        SDL_WaitThread(scheduler->Threads[i], NULL);
+
+    SDL_DestroyCond(scheduler->Wake);
+    SDL_DestroyMutex(scheduler->Lock);
+    scheduler->Lock = NULL;
+    scheduler->Wake = NULL;
+    scheduler->numThreads = 0;
+}
+
+void clearJobGraph(struct JobGraph* graph)
+{
+    graph->numJobs = 0;
+}
+
+int addJobLoop(struct JobGraph* graph, const char* name, JobFunction function, void* data, const int* count, int chunkSize, uint32_t reads, uint32_t writes)
+{
+    struct Job* Job;
+    int i, index = graph->numJobs;
+
+    if (index >= MAX_JOBS)
+    {
+        printf("Error - addJob(): more than %d jobs, %s left out\n", MAX_JOBS, name);
+
+        return -1;
+    }
+
+    Job = &graph->Jobs[index];
+    memset(Job, 0, sizeof(struct Job));
+    Job->name        = name;
+    Job->function    = function;
+    Job->data        = data;
+    Job->chunkSize   = chunkSize;
+    Job->count       = 1;
+    Job->countSource = count;
+    Job->reads       = reads;
+    Job->writes      = writes;
+
+    for (i = 0; i < index; i++)
+    {
+        if ((graph->Jobs[i].writes & (reads | writes)) || (graph->Jobs[i].reads & writes))
+        {
+            Job->dependsOn |= (uint64_t)1 << i;
+            graph->Jobs[i].dependents |= (uint64_t)1 << index;
+        }
+    }
+
+    graph->numJobs++;
+
+    return index;
+}
+
+int addJob(struct JobGraph* graph, const char* name, JobFunction function, void* data, uint32_t reads, uint32_t writes)
+{
+    return addJobLoop(graph, name, function, data, NULL, 0, reads, writes);
+}
+
+static int countBits(uint64_t bits)
+{
+    int count = 0;
+
+    for (; bits; bits &= bits-1)
+        count++;
+
+    return count;
+}
+
+// Runs the graph to completion, the calling thread working alongside the workers
+void runJobGraph(struct JobScheduler* scheduler, struct JobGraph* graph)
+{
+    struct Job* Job;
+    Uint64 start, end, busy = 0;
+    double longest, critical = 0;
+    int i, d;
+
+    if (graph->numJobs == 0)
+        return;
+
+    for (i = 0; i < graph->numJobs; i++)
+    {
+        Job = &graph->Jobs[i];
+        Job->start = Job->end = 0;
+        SDL_AtomicSet(&Job->waitingOn, countBits(Job->dependsOn));
+    }
+
+    for (i = 0; i < scheduler->numThreads; i++)
+    {
+        scheduler->busy[i]   = 0;
+        scheduler->steals[i] = 0;
+    }
+
+    SDL_AtomicSet(&scheduler->jobsLeft, graph->numJobs);
+    scheduler->Graph = graph;
+    start = SDL_GetPerformanceCounter();
+
+    for (i = 0; i < graph->numJobs; i++)
+        if (graph->Jobs[i].dependsOn == 0)
+            readyJob(scheduler, i, 0);
+
+    while (SDL_AtomicGet(&scheduler->jobsLeft) > 0)
+        runWork(scheduler, 0);
+
+    end = SDL_GetPerformanceCounter();
+    scheduler->Graph = NULL;
+
+    // jobs only depend on earlier ones, so one pass in order finds the longest chain
+    for (i = 0; i < graph->numJobs; i++)
+    {
+        Job     = &graph->Jobs[i];
+        longest = 0;
+
+        for (d = 0; d < i; d++)
+            if ((Job->dependsOn >> d) & 1 && graph->Jobs[d].pathMs > longest)
+                longest = graph->Jobs[d].pathMs;
+
+        Job->pathMs = longest + ticksToMs(Job->end - Job->start);
+        critical    = SDL_max(critical, Job->pathMs);
+        scheduler->Stats.chunks += Job->chunks;
+    }
+
+    for (i = 0; i < scheduler->numThreads; i++)
+    {
+        busy += scheduler->busy[i];
+        scheduler->Stats.steals += scheduler->steals[i];
+    }
+
+    scheduler->Stats.graphs++;
+    scheduler->Stats.jobs       += graph->numJobs;
+    scheduler->Stats.wallMs     += ticksToMs(end - start);
+    scheduler->Stats.criticalMs += critical;
+    scheduler->Stats.busyMs     += ticksToMs(busy);
+}
+
+// Averages over every graph run so far, then the jobs of the last one; * marks its critical path
+void printJobStats(struct JobScheduler* scheduler, struct JobGraph* graph)
+{
+    struct JobStats* Stats = &scheduler->Stats;
+    double longest;
+    int i, d, next;
+    char onPath[MAX_JOBS] = {0};
+
+    if (Stats->graphs == 0)
+        return;
+
+    printf("Jobs: %d graphs on %d threads, %.1f jobs and %.1f pieces each, %d steals\n",
+           Stats->graphs, scheduler->numThreads, (double)Stats->jobs / Stats->graphs, (double)Stats->chunks / Stats->graphs, Stats->steals);
+    printf("      %.3f ms wall, %.3f ms critical path, %.3f ms of work, %.0f%% utilisation\n",
+           Stats->wallMs / Stats->graphs, Stats->criticalMs / Stats->graphs, Stats->busyMs / Stats->graphs,
+           Stats->wallMs > 0 ? 100.0 * Stats->busyMs / (Stats->wallMs * scheduler->numThreads) : 0.0);
+
+    for (i = 0, next = -1, longest = 0; i < graph->numJobs; i++)
+        if (graph->Jobs[i].pathMs > longest)
+            longest = graph->Jobs[i].pathMs, next = i;
+
+    while (next >= 0)
+    {
+        onPath[next] = 1;
+        d = next;
+        next = -1;
+
+        for (i = 0, longest = 0; i < d; i++)
+            if ((graph->Jobs[d].dependsOn >> i) & 1 && graph->Jobs[i].pathMs >= longest)
+                longest = graph->Jobs[i].pathMs, next = i;
+    }
+
+    for (i = 0; i < graph->numJobs; i++)
+        printf("  %c %-12s %3d pieces %8.3f ms\n", onPath[i] ? '*' : ' ', graph->Jobs[i].name, graph->Jobs[i].chunks,
+               ticksToMs(graph->Jobs[i].end - graph->Jobs[i].start));
+}
@@ -0,0 +1,91 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <SDL2/SDL.h>
+#include <stdint.h>
+
+#define MAX_JOBS            64      // per graph; dependencies are kept as bit masks
+#define MAX_WORKERS         15      // threads besides the main one, which works too
+#define JOB_MAX_CHUNKS      64      // a loop job is split into at most this many pieces
+#define JOB_QUEUE_SIZE      1024    // per thread, power of two; a piece that doesn't fit runs right away
+
+typedef void (*JobFunction)(void* data, int begin, int end);
+
+// A system run as part of a graph. reads and writes are bits for whatever the caller shares between
+// systems, e.g. component arrays; a job waits for every earlier job that writes what it touches,
+// or that reads what it writes. Everything else may run at the same time.
+struct Job
+{
+    const char*     name;
+    JobFunction     function;
+    void*           data;
+    int             chunkSize;      // 0: one call for [0, 1); otherwise [0, count) in pieces of about chunkSize
+    int             count;
+    const int*      countSource;    // if set, count is read from here once the job's dependencies are done
+    uint32_t        reads, writes;
+    uint64_t        dependsOn, dependents;
+    SDL_atomic_t    waitingOn;
+    SDL_atomic_t    chunksLeft;
+    int             chunks;
+    SDL_SpinLock    TimeLock;
+    Uint64          start, end;     // first piece started, last piece finished
+    double          pathMs;         // longest chain of jobs ending with this one
+};
+
+struct JobGraph
+{
+    int         numJobs;
+    struct Job  Jobs[MAX_JOBS];
+};
+
+struct WorkItem
+{
+    int job, begin, end;
+};
+
+// The owner takes from the tail, so it keeps working on what it just made ready; thieves take from the head
+struct WorkQueue
+{
+    SDL_SpinLock    Lock;
+    unsigned        head, tail;
+    struct WorkItem Items[JOB_QUEUE_SIZE];
+};
+
+struct Worker
+{
+    struct JobScheduler* Scheduler;
+    int index;
+};
+
+struct JobStats
+{
+    int     graphs, jobs, chunks, steals;
+    double  wallMs, criticalMs, busyMs;     // totals over all graphs
+};
+
+struct JobScheduler
+{
+    int                 numThreads;         // workers + the main thread
+    int                 running;
+    SDL_Thread*         Threads[MAX_WORKERS];
+    struct Worker       Workers[MAX_WORKERS+1];
+    struct WorkQueue    Queues [MAX_WORKERS+1];
+    SDL_mutex*          Lock;
+    SDL_cond*           Wake;
+    SDL_atomic_t        queued;             // pieces in all the queues
+    SDL_atomic_t        jobsLeft;
+    struct JobGraph*    Graph;              // the one running, NULL between runs
+    Uint64              busy  [MAX_WORKERS+1];
+    int                 steals[MAX_WORKERS+1];
+    struct JobStats     Stats;
+};
+
+int  initJobScheduler   (struct JobScheduler* scheduler, int numWorkers);
+void killJobScheduler   (struct JobScheduler* scheduler);
+void clearJobGraph      (struct JobGraph* graph);
+int  addJob             (struct JobGraph* graph, const char* name, JobFunction function, void* data, uint32_t reads, uint32_t writes);
+int  addJobLoop         (struct JobGraph* graph, const char* name, JobFunction function, void* data, const int* count, int chunkSize, uint32_t reads, uint32_t writes);
+void runJobGraph        (struct JobScheduler* scheduler, struct JobGraph* graph);
+void printJobStats      (struct JobScheduler* scheduler, struct JobGraph* graph);
+
+#endif
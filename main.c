@@ -4,7 +4,7 @@ int main(int argc, char* argv[])
 {
     struct System System;
 
-    initSystem(&System, argv[1]);
+    initSystem(&System, argc, argv);
 
     while (System.running)
         execSystem(&System);
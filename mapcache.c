@@ -0,0 +1,194 @@
+#include "mapcache.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int initMapCache(struct MapCache* cache, struct Board* board_)
+{
+    killMapCache(cache);
+
+    cache->chunksW   = board_->chunksW;
+    cache->chunksH   = board_->chunksH;
+    cache->numChunks = board_->numChunks;
+    cache->tileSize  = board_->tileSize;
+    cache->texSize   = board_->texSize;
+    cache->frame     = 0;
+
+    if ((cache->Chunks = calloc(cache->numChunks, sizeof(struct MapChunk))) == NULL)
+    {
+        printf("Error - initMapCache() failed to allocate %d chunks\n", cache->numChunks);
+        cache->numChunks = 0;
+
+        return 1;
+    }
+
+    return 0;
+}
+
+void killMapCache(struct MapCache* cache)
+{
+    int i;
+
+    for (i = 0; i < cache->numChunks; i++)
+        if (cache->Chunks[i].Texture)
+            SDL_DestroyTexture(cache->Chunks[i].Texture);
+
+    free(cache->Chunks);
+    cache->Chunks    = NULL;
+    cache->numChunks = 0;
+}
+
+// Tiles in [min, max)
+void invalidateMapCache(struct MapCache* cache, int minX, int minY, int maxX, int maxY)
+{
+    int x, y;
+
+    if (cache->Chunks == NULL || maxX <= minX || maxY <= minY)
+        return;
+
+    minX = SDL_max(minX >> CHUNK_SHIFT, 0);
+    minY = SDL_max(minY >> CHUNK_SHIFT, 0);
+    maxX = SDL_min((maxX-1) >> CHUNK_SHIFT, cache->chunksW-1);
+    maxY = SDL_min((maxY-1) >> CHUNK_SHIFT, cache->chunksH-1);
+
+    for (y = minY; y <= maxY; y++)
+        for (x = minX; x <= maxX; x++)
+            cache->Chunks[y * cache->chunksW + x].dirty = 1;
+}
+
+void invalidateMapCacheAll(struct MapCache* cache)
+{
+    int i;
+
+    for (i = 0; i < cache->numChunks; i++)
+        cache->Chunks[i].dirty = 1;
+}
+
+// Tiles are copied from the atlas with the light as a color mod, which is what the old per-tile
+// black fill with alpha 255-light came to
+static void bakeChunk(struct MapCache* cache, struct Board* board_, int index, SDL_Renderer* renderer, SDL_Texture* atlas, int lightEnable)
+{
+    struct MapChunk* mapChunk = &cache->Chunks[index];
+    struct Chunk* chunk = board_->chunkTable[index];
+    const int size = CHUNK_SIZE * cache->tileSize;
+    const int w    = SDL_min(board_->w - (index % cache->chunksW) * CHUNK_SIZE, CHUNK_SIZE);   // chunks on the right and bottom edges are partly outside the map
+    const int h    = SDL_min(board_->h - (index / cache->chunksW) * CHUNK_SIZE, CHUNK_SIZE);
+    SDL_Rect SrcRect = {0, 0, cache->texSize, cache->texSize};
+    SDL_Rect DstRect = {0, 0, cache->tileSize, cache->tileSize};
+    uint8_t light, lastLight = 255;
+    int x, y, i;
+
+    if (mapChunk->Texture == NULL)
+    {
+        mapChunk->Texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, size, size);
+
+        if (mapChunk->Texture == NULL)
+        {
+            printf("Error - bakeChunk() could not create a %dx%d texture: %s\n", size, size, SDL_GetError());
+
+            return;
+        }
+    }
+
+    SDL_SetRenderTarget     (renderer, mapChunk->Texture);
+    SDL_SetRenderDrawColor  (renderer, 0, 0, 0, 255);
+    SDL_RenderClear         (renderer);
+
+    for (y = 0; y < h; y++)
+    {
+        DstRect.y = y * cache->tileSize;
+
+        for (x = 0; x < w; x++)
+        {
+            i         = (y << CHUNK_SHIFT) | x;
+            DstRect.x = x * cache->tileSize;
+            SrcRect.y = cache->texSize * (chunk->tiles[i] >> TILE_FLAGS);
+            light     = lightEnable ? chunk->light[i] : 255;
+
+            if (light != lastLight)
+            {
+                SDL_SetTextureColorMod(atlas, light, light, light);
+                lastLight = light;
+            }
+
+            SDL_RenderCopy(renderer, atlas, &SrcRect, &DstRect);
+        }
+    }
+
+    SDL_SetTextureColorMod(atlas, 255, 255, 255);
+    SDL_SetRenderTarget(renderer, NULL);
+
+    mapChunk->Baked = chunk;
+    mapChunk->dirty = 0;
+    cache->baked++;
+}
+
+// Draws the chunks overlapping the view into the current render target, baking the ones that are out of date first.
+// Baking switches the render target, so the target is restored afterwards.
+void renderMapCache(struct MapCache* cache, struct Board* board_, SDL_Renderer* renderer, SDL_Texture* atlas,
+                    int lightEnable, int cameraX, int cameraY, int viewW, int viewH)
+{
+    const int size = CHUNK_SIZE * cache->tileSize;
+    SDL_Texture* Target = SDL_GetRenderTarget(renderer);
+    struct MapChunk* MapChunk;
+    SDL_Rect DstRect = {0, 0, size, size};
+    int x, y, i, minX, minY, maxX, maxY;
+
+    if (cache->chunksW != board_->chunksW || cache->chunksH != board_->chunksH || cache->tileSize != board_->tileSize || cache->texSize != board_->texSize)
+        if (initMapCache(cache, board_))
+            return;
+
+    cache->frame++;
+    cache->baked = 0;
+    cache->drawn = 0;
+
+    minX = SDL_max(-cameraX / size, 0);
+    minY = SDL_max(-cameraY / size, 0);
+    maxX = SDL_min((-cameraX + viewW) / size, cache->chunksW-1);
+    maxY = SDL_min((-cameraY + viewH) / size, cache->chunksH-1);
+
+    // bake everything first, so the target only switches away and back once per baked chunk
+    for (y = minY; y <= maxY; y++)
+    {
+        for (x = minX; x <= maxX; x++)
+        {
+            i        = y * cache->chunksW + x;
+            MapChunk = &cache->Chunks[i];
+
+            if (MapChunk->dirty || MapChunk->Baked != board_->chunkTable[i] || MapChunk->Texture == NULL)
+                bakeChunk(cache, board_, i, renderer, atlas, lightEnable);
+        }
+    }
+
+    SDL_SetRenderTarget(renderer, Target);
+
+    for (y = minY; y <= maxY; y++)
+    {
+        DstRect.y = y * size + cameraY;
+
+        for (x = minX; x <= maxX; x++)
+        {
+            MapChunk  = &cache->Chunks[y * cache->chunksW + x];
+            DstRect.x = x * size + cameraX;
+
+            if (MapChunk->Texture)
+            {
+                SDL_RenderCopy(renderer, MapChunk->Texture, NULL, &DstRect);
+                MapChunk->lastUsed = cache->frame;
+                cache->drawn++;
+            }
+        }
+    }
+
+    // chunk textures are big; the ones we've walked away from go, and get baked again if we come back
+    for (i = 0; i < cache->numChunks; i++)
+    {
+        MapChunk = &cache->Chunks[i];
+
+        if (MapChunk->Texture && cache->frame - MapChunk->lastUsed > MAP_CACHE_KEEP_FRAMES)
+        {
+            SDL_DestroyTexture(MapChunk->Texture);
+            MapChunk->Texture = NULL;
+            MapChunk->Baked   = NULL;
+        }
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef MAPCACHE_H
+#define MAPCACHE_H
+
+#include <SDL2/SDL.h>
+#include "board.h"
+
+#define MAP_CACHE_KEEP_FRAMES   120     // a chunk texture not drawn for this long is released
+
+// The 2D map pre-rendered a board chunk at a time, with the lightmap baked in.
+// A chunk is re-rendered only when it's invalidated or a different chunk is loaded in its place.
+struct MapChunk
+{
+    SDL_Texture*    Texture;
+    struct Chunk*   Baked;          // what the texture was rendered from; streaming in or swapping boards changes it
+    int             dirty;
+    uint32_t        lastUsed;
+};
+
+struct MapCache
+{
+    int             chunksW, chunksH, numChunks;
+    int             tileSize, texSize;
+    uint32_t        frame;
+    int             baked, drawn;   // last frame's counts
+    struct MapChunk* Chunks;
+};
+
+int  initMapCache       (struct MapCache* cache, struct Board* board_);
+void killMapCache       (struct MapCache* cache);
+void invalidateMapCache (struct MapCache* cache, int minX, int minY, int maxX, int maxY);
+void invalidateMapCacheAll(struct MapCache* cache);
+void renderMapCache     (struct MapCache* cache, struct Board* board_, SDL_Renderer* renderer, SDL_Texture* atlas,
+                         int lightEnable, int cameraX, int cameraY, int viewW, int viewH);
+
+#endif
@@ -0,0 +1,193 @@
+#include "memory.h"
+#include "state.h"
+#include "board.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define alignSize(size) (((size) + (MEMORY_ALIGN-1)) & ~(size_t)(MEMORY_ALIGN-1))
+
+int initArena(struct Arena* arena, const char* name, size_t size)
+{
+    memset(arena, 0, sizeof(struct Arena));
+    arena->name = name;
+
+    if ((arena->base = malloc(size)) == NULL)
+    {
+        printf("Error - initArena() failed to allocate %zu bytes for %s\n", size, name);
+
+        return 1;
+    }
+
+    arena->size = size;
+
+    return 0;
+}
+
+void killArena(struct Arena* arena)
+{
+    free(arena->base);
+    arena->base = NULL;
+    arena->size = 0;
+    arena->used = 0;
+}
+
+// NULL when the arena is full; callers decide whether to fall back to the heap
+void* allocArena(struct Arena* arena, size_t size)
+{
+    void* pointer;
+
+    size = alignSize(size);
+
+    if (arena->used + size > arena->size)
+    {
+        arena->failures++;
+
+        return NULL;
+    }
+
+    pointer = arena->base + arena->used;
+    arena->used += size;
+    arena->allocations++;
+
+    if (arena->used > arena->highWater)
+        arena->highWater = arena->used;
+
+    return pointer;
+}
+
+void* callocArena(struct Arena* arena, size_t count, size_t size)
+{
+    void* pointer = allocArena(arena, count * size);
+
+    if (pointer)
+        memset(pointer, 0, count * size);
+
+    return pointer;
+}
+
+void resetArena(struct Arena* arena)
+{
+    arena->used        = 0;
+    arena->allocations = 0;
+}
+
+int arenaOwns(struct Arena* arena, void* pointer)
+{
+    return (char*)pointer >= arena->base && (char*)pointer < arena->base + arena->size;
+}
+
+int initPool(struct Pool* pool, const char* name, size_t itemSize, int capacity)
+{
+    int i;
+
+    memset(pool, 0, sizeof(struct Pool));
+    pool->name     = name;
+    pool->itemSize = alignSize(itemSize < sizeof(void*) ? sizeof(void*) : itemSize);
+
+    if ((pool->base = malloc(pool->itemSize * capacity)) == NULL)
+    {
+        printf("Error - initPool() failed to allocate %d items for %s\n", capacity, name);
+
+        return 1;
+    }
+
+    pool->capacity = capacity;
+
+    // thread the free list through the items themselves
+    for (i = capacity-1; i >= 0; i--)
+    {
+        *(void**)(pool->base + i * pool->itemSize) = pool->freeList;
+        pool->freeList = pool->base + i * pool->itemSize;
+    }
+
+    return 0;
+}
+
+void killPool(struct Pool* pool)
+{
+    free(pool->base);
+    pool->base     = NULL;
+    pool->freeList = NULL;
+    pool->capacity = 0;
+}
+
+void* allocPool(struct Pool* pool)
+{
+    void* item;
+
+    SDL_AtomicLock(&pool->Lock);
+
+    if ((item = pool->freeList) == NULL)
+        pool->failures++;
+    else
+    {
+        pool->freeList = *(void**)item;
+
+        if (++pool->used > pool->highWater)
+            pool->highWater = pool->used;
+    }
+
+    SDL_AtomicUnlock(&pool->Lock);
+
+    return item;
+}
+
+void freePool(struct Pool* pool, void* item)
+{
+    SDL_AtomicLock(&pool->Lock);
+    *(void**)item = pool->freeList;
+    pool->freeList = item;
+    pool->used--;
+    SDL_AtomicUnlock(&pool->Lock);
+}
+
+int poolOwns(struct Pool* pool, void* pointer)
+{
+    return (char*)pointer >= pool->base && (char*)pointer < pool->base + pool->itemSize * pool->capacity;
+}
+
+int initMemory(struct Memory* memory)
+{
+    int error = 0;
+
+    printf("initMemory()\n");
+
+    error |= initArena(&memory->Persistent, "persistent",  PERSISTENT_ARENA_SIZE);
+    error |= initArena(&memory->Level,      "level",       LEVEL_ARENA_SIZE);
+    error |= initArena(&memory->Frame,      "frame",       FRAME_ARENA_SIZE);
+    error |= initPool (&memory->States,     "states",      sizeof(struct State), MAX_STATES);
+    error |= initPool (&memory->Chunks,     "chunks",      sizeof(struct Chunk), CHUNK_POOL_SIZE);
+
+    return error;
+}
+
+void killMemory(struct Memory* memory)
+{
+    killArena(&memory->Persistent);
+    killArena(&memory->Level);
+    killArena(&memory->Frame);
+    killPool (&memory->States);
+    killPool (&memory->Chunks);
+}
+
+static void printArena(struct Arena* arena)
+{
+    printf("%-12s %8zu / %8zu bytes used, high water %8zu, %d allocations, %d failed\n",
+           arena->name, arena->used, arena->size, arena->highWater, arena->allocations, arena->failures);
+}
+
+static void printPool(struct Pool* pool)
+{
+    printf("%-12s %8d / %8d items used, high water %8d, %d failed\n",
+           pool->name, pool->used, pool->capacity, pool->highWater, pool->failures);
+}
+
+void printMemoryStats(struct Memory* memory)
+{
+    printArena(&memory->Persistent);
+    printArena(&memory->Level);
+    printArena(&memory->Frame);
+    printPool (&memory->States);
+    printPool (&memory->Chunks);
+}
@@ -0,0 +1,57 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <SDL2/SDL.h>
+#include <stddef.h>
+
+#define MEMORY_ALIGN            16
+#define PERSISTENT_ARENA_SIZE   (4*1024*1024)   // lives as long as the program: states, draw list
+#define LEVEL_ARENA_SIZE        (32*1024*1024)  // freed all at once when the map is unloaded
+#define FRAME_ARENA_SIZE        (1*1024*1024)   // reset at the end of every execSystem() cycle
+#define CHUNK_POOL_SIZE         256             // streamed map chunks resident at once
+
+// Bump allocator; individual allocations are never freed, the whole arena is reset
+struct Arena
+{
+    const char* name;
+    char*       base;
+    size_t      size, used, highWater;
+    int         allocations, failures;
+};
+
+// Fixed-size items on a free list; safe to use from several threads
+struct Pool
+{
+    const char*     name;
+    char*           base;
+    void*           freeList;
+    size_t          itemSize;
+    int             capacity, used, highWater, failures;
+    SDL_SpinLock    Lock;
+};
+
+struct Memory
+{
+    struct Arena    Persistent;
+    struct Arena    Level;
+    struct Arena    Frame;
+    struct Pool     States;
+    struct Pool     Chunks;
+};
+
+int   initArena         (struct Arena* arena, const char* name, size_t size);
+void  killArena         (struct Arena* arena);
+void* allocArena        (struct Arena* arena, size_t size);
+void* callocArena       (struct Arena* arena, size_t count, size_t size);
+void  resetArena        (struct Arena* arena);
+int   arenaOwns         (struct Arena* arena, void* pointer);
+int   initPool          (struct Pool* pool, const char* name, size_t itemSize, int capacity);
+void  killPool          (struct Pool* pool);
+void* allocPool         (struct Pool* pool);
+void  freePool          (struct Pool* pool, void* item);
+int   poolOwns          (struct Pool* pool, void* pointer);
+int   initMemory        (struct Memory* memory);
+void  killMemory        (struct Memory* memory);
+void  printMemoryStats  (struct Memory* memory);
+
+#endif
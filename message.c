@@ -1,42 +1,163 @@
 #include "message.h"
 #include <stdio.h>
+#include <string.h>
+
+static const int MessageChannel[NUM_MESSAGE_TYPES] =
+{
+    [MSG_SWITCH_STATE]  = CHANNEL_SYSTEM,
+    [MSG_QUIT]          = CHANNEL_SYSTEM
+};
+
+static const char* ChannelNames[NUM_CHANNELS] = {"system"};
 
 int initMessageBus(struct MessageBus* messageBus)
 {
+    int i, j;
+
     printf("initMessageBus()\n");
 
-    messageBus->head = 0;
-    messageBus->tail = 0;
-    messageBus->numMessages = 0;
+    memset(messageBus, 0, sizeof(struct MessageBus));
+
+    for (i = 0; i < NUM_CHANNELS; i++)
+        for (j = 0; j < CHANNEL_SIZE; j++)
+            SDL_AtomicSet(&messageBus->Channels[i].Slots[j].sequence, j);
 
     return 0;
 }
 
-int pushMessage(struct MessageBus* messageBus, struct Message message)
+// Not thread safe; register handlers during init, before any worker starts pushing
+int addMessageHandler(struct MessageBus* messageBus, int type, MessageHandler handle, void* data)
 {
-    if (messageBus->numMessages < MAX_MESSAGES)
+    struct MessageHandlers* Handlers;
+
+    if (type < 0 || type >= NUM_MESSAGE_TYPES || messageBus->Handlers[type].numHandlers >= MAX_HANDLERS)
     {
-        messageBus->Messages[messageBus->tail++] = message;
+        printf("Error - addMessageHandler(): can't add handler for message type %d\n", type);
 
-        if (messageBus->tail >= MAX_MESSAGES)
-            messageBus->tail = 0;
+        return 1;
     }
-    else
+
+    Handlers = &messageBus->Handlers[type];
+    Handlers->handle[Handlers->numHandlers] = handle;
+    Handlers->data  [Handlers->numHandlers] = data;
+    Handlers->numHandlers++;
+
+    return 0;
+}
+
+// Safe from any thread. Returns 1 if the message's channel is full; the message is dropped and counted
+int pushMessage(struct MessageBus* messageBus, struct Message message)
+{
+    struct MessageChannel* Channel;
+    struct MessageSlot* Slot;
+    int pos, diff;
+
+    if (message.type >= NUM_MESSAGE_TYPES)
         return 1;
 
+    Channel = &messageBus->Channels[MessageChannel[message.type]];
+    pos     = SDL_AtomicGet(&Channel->tail);
+
+    for (;;)
+    {
+        Slot = &Channel->Slots[pos & CHANNEL_MASK];
+        diff = (int)((unsigned)SDL_AtomicGet(&Slot->sequence) - (unsigned)pos);
+
+        if (diff == 0)
+        {
+            if (SDL_AtomicCAS(&Channel->tail, pos, pos+1))
+                break;
+
+            SDL_AtomicAdd(&Channel->Stats.contention, 1);
+        }
+        else if (diff < 0)
+        {
+            SDL_AtomicAdd(&Channel->Stats.dropped, 1);
+
+            return 1;
+        }
+
+        pos = SDL_AtomicGet(&Channel->tail);
+    }
+
+    Slot->Message = message;
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&Slot->sequence, pos+1);
+    SDL_AtomicAdd(&Channel->Stats.pushed, 1);
+
     return 0;
 }
 
+int postMessage(struct MessageBus* messageBus, int type, union Data payload)
+{
+    struct Message Message = {.type = type, .flags = 0, .timestamp = SDL_GetTicks(), .Payload = payload};
+
+    return pushMessage(messageBus, Message);
+}
+
+static void dispatchMessage(struct MessageBus* messageBus, struct Message* message)
+{
+    struct MessageHandlers* Handlers = &messageBus->Handlers[message->type];
+    int i;
+
+    if (Handlers->numHandlers == 0)
+        messageBus->unhandled++;
+
+    for (i = 0; i < Handlers->numHandlers; i++)
+        Handlers->handle[i](message, Handlers->data[i]);
+}
+
+// Main thread only. Drains what was in each channel when the poll started; messages pushed
+// by the handlers themselves wait for the next poll, so a handler can't keep the loop going
 int pollMessages(struct MessageBus* messageBus)
 {
-    while (messageBus->numMessages-- > 0)
+    struct MessageChannel* Channel;
+    struct MessageSlot* Slot;
+    struct Message Message;
+    int i, end, depth;
+
+    for (i = 0; i < NUM_CHANNELS; i++)
     {
-        //processMessage(&messageBus->Messages[messageBus->head++]);
+        Channel = &messageBus->Channels[i];
+        end     = SDL_AtomicGet(&Channel->tail);
+        depth   = end - Channel->head;
+
+        if (depth > Channel->Stats.highWater)
+            Channel->Stats.highWater = depth;
+
+        while (Channel->head != end)
+        {
+            Slot = &Channel->Slots[Channel->head & CHANNEL_MASK];
 
-        if (messageBus->head >= MAX_MESSAGES)
-            messageBus->head = 0;
+            // claimed but still being written, pick it up next frame
+            if (SDL_AtomicGet(&Slot->sequence) != Channel->head+1)
+                break;
+
+            SDL_MemoryBarrierAcquire();
+            Message = Slot->Message;
+            SDL_AtomicSet(&Slot->sequence, Channel->head + CHANNEL_SIZE);
+            Channel->head++;
+            Channel->Stats.drained++;
+
+            dispatchMessage(messageBus, &Message);
+        }
     }
 
     return 0;
 }
 
+void printMessageStats(struct MessageBus* messageBus)
+{
+    struct ChannelStats* Stats;
+    int i;
+
+    for (i = 0; i < NUM_CHANNELS; i++)
+    {
+        Stats = &messageBus->Channels[i].Stats;
+        printf("%-8s pushed %d, drained %d, dropped %d, contention %d, high water %d/%d\n", ChannelNames[i],
+               SDL_AtomicGet(&Stats->pushed), Stats->drained, SDL_AtomicGet(&Stats->dropped),
+               SDL_AtomicGet(&Stats->contention), Stats->highWater, CHANNEL_SIZE);
+    }
+
+    printf("unhandled %d\n", messageBus->unhandled);
+}
@@ -1,14 +1,25 @@
 #ifndef MESSAGE_H
 #define MESSAGE_H
 
+#include <SDL2/SDL.h>
 #include <stdint.h>
 
-#define MAX_MESSAGES 4096
+#define CHANNEL_SIZE        1024    // per channel, power of two
+#define CHANNEL_MASK        (CHANNEL_SIZE-1)
+#define MAX_HANDLERS        8       // per message type
 
 enum MessageTypes
 {
-    MSG_SWITCH_STATE,
-    MSG_QUIT
+    MSG_SWITCH_STATE,   // Payload.Pointer = struct State*
+    MSG_QUIT,
+    NUM_MESSAGE_TYPES
+};
+
+// Each message type is routed to one channel; a full channel only drops messages of its own kind
+enum MessageChannels
+{
+    CHANNEL_SYSTEM,
+    NUM_CHANNELS
 };
 
 struct Rect
@@ -39,15 +50,53 @@ struct Message
     union Data  Payload;
 }; // 16 bytes
 
+typedef int (*MessageHandler)(struct Message* message, void* data);
+
+// A slot is free for the producer claiming position pos when sequence == pos,
+// and ready for the consumer when sequence == pos+1
+struct MessageSlot
+{
+    SDL_atomic_t    sequence;
+    struct Message  Message;
+};
+
+struct ChannelStats
+{
+    SDL_atomic_t    pushed;
+    SDL_atomic_t    dropped;        // channel was full
+    SDL_atomic_t    contention;     // producers lost a race for a slot and retried
+    int             drained;
+    int             highWater;      // deepest the channel has been at the start of a poll
+};
+
+// Lock-free multi-producer single-consumer ring; any thread may push, only the main thread polls
+struct MessageChannel
+{
+    SDL_atomic_t        tail;
+    int                 head;
+    struct ChannelStats Stats;
+    struct MessageSlot  Slots[CHANNEL_SIZE];
+};
+
+struct MessageHandlers
+{
+    int             numHandlers;
+    MessageHandler  handle[MAX_HANDLERS];
+    void*           data  [MAX_HANDLERS];
+};
+
 struct MessageBus
 {
-    int head, tail, numMessages;
-    struct Message Messages[MAX_MESSAGES];
+    int                     unhandled;
+    struct MessageChannel   Channels[NUM_CHANNELS];
+    struct MessageHandlers  Handlers[NUM_MESSAGE_TYPES];
 };
 
-int initMessageBus  (struct MessageBus* messageBus);
-int pushMessage     (struct MessageBus* messageBus, struct Message message);
-int pollMessages    (struct MessageBus* messageBus);
-int processMessage  (struct Message* message);
+int  initMessageBus     (struct MessageBus* messageBus);
+int  addMessageHandler  (struct MessageBus* messageBus, int type, MessageHandler handle, void* data);
+int  pushMessage        (struct MessageBus* messageBus, struct Message message);
+int  postMessage        (struct MessageBus* messageBus, int type, union Data payload);
+int  pollMessages       (struct MessageBus* messageBus);
+void printMessageStats  (struct MessageBus* messageBus);
 
 #endif
@@ -0,0 +1,993 @@
+#include "net.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+typedef int socklen_t;
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define closesocket close
+#endif
+
+/**********
+* Sockets *
+**********/
+int initNet(void)
+{
+    #ifdef _WIN32
+    WSADATA Data;
+
+    if (WSAStartup(MAKEWORD(2, 2), &Data))
+    {
+        printf("Error - initNet(): WSAStartup failed\n");
+
+        return 1;
+    }
+    #endif
+
+    return 0;
+}
+
+void killNet(void)
+{
+    #ifdef _WIN32
+    WSACleanup();
+    #endif
+}
+
+// Non-blocking UDP socket on the port, or any free one for 0; -1 on failure
+int openSocket(uint16_t port)
+{
+    struct sockaddr_in Address = {0};
+    int s;
+
+    if ((s = (int)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) < 0)
+    {
+        printf("Error - openSocket(): could not create a socket\n");
+
+        return -1;
+    }
+
+    Address.sin_family      = AF_INET;
+    Address.sin_addr.s_addr = htonl(INADDR_ANY);
+    Address.sin_port        = htons(port);
+
+    if (bind(s, (struct sockaddr*)&Address, sizeof(Address)) < 0)
+    {
+        printf("Error - openSocket(): could not bind port %d\n", port);
+        closesocket(s);
+
+        return -1;
+    }
+
+    #ifdef _WIN32
+    u_long nonBlocking = 1;
+    ioctlsocket(s, FIONBIO, &nonBlocking);
+    #else
+    fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+    #endif
+
+    return s;
+}
+
+void closeSocket(int socket)
+{
+    if (socket >= 0)
+        closesocket(socket);
+}
+
+int sendPacket(int socket, const struct NetAddress* to, const void* data, int size)
+{
+    struct sockaddr_in Address = {0};
+
+    Address.sin_family      = AF_INET;
+    Address.sin_addr.s_addr = to->host;
+    Address.sin_port        = to->port;
+
+    return sendto(socket, data, size, 0, (struct sockaddr*)&Address, sizeof(Address)) == size ? 0 : 1;
+}
+
+// Bytes received, or 0 when nothing is waiting
+int receivePacket(int socket, struct NetAddress* from, void* data, int size)
+{
+    struct sockaddr_in Address;
+    socklen_t length = sizeof(Address);
+    int received = recvfrom(socket, data, size, 0, (struct sockaddr*)&Address, &length);
+
+    if (received <= 0)
+        return 0;
+
+    from->host = Address.sin_addr.s_addr;
+    from->port = Address.sin_port;
+
+    return received;
+}
+
+// "host:port", port defaulting to NET_DEFAULT_PORT
+int parseAddress(const char* text, struct NetAddress* address)
+{
+    char host[256];
+    const char* colon = strrchr(text, ':');
+    int length = colon ? (int)(colon - text) : (int)strlen(text);
+    struct hostent* Host;
+
+    if (length <= 0 || length >= (int)sizeof(host))
+    {
+        printf("Error - parseAddress(): bad address \"%s\"\n", text);
+
+        return 1;
+    }
+
+    memcpy(host, text, length);
+    host[length] = '\0';
+
+    if ((Host = gethostbyname(host)) == NULL || Host->h_addrtype != AF_INET)
+    {
+        printf("Error - parseAddress(): could not resolve \"%s\"\n", host);
+
+        return 1;
+    }
+
+    memcpy(&address->host, Host->h_addr_list[0], 4);
+    address->port = htons(colon ? (uint16_t)atoi(colon + 1) : NET_DEFAULT_PORT);
+
+    return 0;
+}
+
+static int sameAddress(const struct NetAddress* a, const struct NetAddress* b)
+{
+    return a->host == b->host && a->port == b->port;
+}
+
+/**********
+* Packing *
+**********/
+// Little-endian whatever the machine; a write past the end sets overflow instead
+void writeU8(struct PacketWriter* writer, uint8_t value)
+{
+    if (writer->size + 1 > NET_PACKET_SIZE)
+    {
+        writer->overflow = 1;
+
+        return;
+    }
+
+    writer->data[writer->size++] = value;
+}
+
+void writeU16(struct PacketWriter* writer, uint16_t value)
+{
+    writeU8(writer, value);
+    writeU8(writer, value >> 8);
+}
+
+void writeU32(struct PacketWriter* writer, uint32_t value)
+{
+    writeU16(writer, value);
+    writeU16(writer, value >> 16);
+}
+
+// Reads past the end give 0 and set overflow, so a short packet is caught once at the end
+uint8_t readU8(struct PacketReader* reader)
+{
+    if (reader->position + 1 > reader->size)
+    {
+        reader->overflow = 1;
+
+        return 0;
+    }
+
+    return reader->data[reader->position++];
+}
+
+uint16_t readU16(struct PacketReader* reader)
+{
+    uint16_t low = readU8(reader);
+
+    return low | (uint16_t)readU8(reader) << 8;
+}
+
+uint32_t readU32(struct PacketReader* reader)
+{
+    uint32_t low = readU16(reader);
+
+    return low | (uint32_t)readU16(reader) << 16;
+}
+
+/************
+* Snapshots *
+************/
+static int entryBytes(int mask)
+{
+    int bytes = 2;
+
+    if (mask & NET_SPAWN)       bytes += 10;
+    if (mask & NET_POS_SMALL)   bytes += 4;
+    if (mask & NET_POS)         bytes += 8;
+    if (mask & NET_VELOCITY)    bytes += 4;
+    if (mask & NET_ANGLE)       bytes += 4;
+    if (mask & NET_COMMANDS)    bytes += 2;
+    if (mask & NET_COLOR)       bytes += 4;
+
+    return bytes;
+}
+
+static int changedFields(const struct NetEntity* current, const struct NetEntity* base)
+{
+    int mask = 0;
+    int32_t dx, dy;
+
+    if (base == NULL)
+        return NET_SPAWN | NET_POS | NET_VELOCITY | NET_ANGLE | NET_COMMANDS;
+
+    if (current->type != base->type || current->control != base->control || current->channel != base->channel)
+        mask |= NET_SPAWN;
+    else if (current->color != base->color)
+        mask |= NET_COLOR;
+
+    dx = current->x - base->x;
+    dy = current->y - base->y;
+
+    if (dx || dy)
+        mask |= (dx == (int16_t)dx && dy == (int16_t)dy) ? NET_POS_SMALL : NET_POS;
+
+    if (current->velX != base->velX || current->velY != base->velY)
+        mask |= NET_VELOCITY;
+
+    if (current->angle != base->angle || current->angVel != base->angVel)
+        mask |= NET_ANGLE;
+
+    if (current->commands != base->commands)
+        mask |= NET_COMMANDS;
+
+    return mask;
+}
+
+// Entity count and the entries that differ from baseline (NULL for none), as many as fit in the packet.
+// sent becomes what the receiver will hold: the baseline with the written entries applied, so anything left out
+// is simply still different next time. Starts at a different entity every tick so none of them starve.
+// Entities set in hidden (NULL for none) are left out the same way, so the receiver holds them as it last saw them.
+int writeSnapshot(struct PacketWriter* writer, const struct NetSnapshot* current, const struct NetSnapshot* baseline, struct NetSnapshot* sent,
+                  const uint8_t* hidden)
+{
+    const struct NetEntity *C, *B;
+    int i, n, mask, numEntries = 0, countAt;
+
+    if (baseline)
+        *sent = *baseline;
+    else
+        memset(sent, 0, sizeof(struct NetSnapshot));
+
+    sent->tick  = current->tick;
+    sent->count = current->count;
+
+    for (i = current->count; i < NET_MAX_ENTITIES; i++)
+        sent->Entities[i].present = 0;
+
+    writeU8(writer, current->count);
+    countAt = writer->size;
+    writeU8(writer, 0);
+
+    for (n = 0; n < current->count; n++)
+    {
+        i = (n + current->tick) % current->count;
+        C = &current->Entities[i];
+        B = sent->Entities[i].present ? &sent->Entities[i] : NULL;
+
+        if (!C->present || (hidden && (hidden[i >> 3] >> (i & 7)) & 1) || (mask = changedFields(C, B)) == 0)
+            continue;
+
+        if (writer->size + entryBytes(mask) > NET_PACKET_SIZE)
+            continue;
+
+        writeU8(writer, i);
+        writeU8(writer, mask);
+
+        if (mask & NET_SPAWN)
+        {
+            writeU32(writer, C->type);
+            writeU8 (writer, C->control);
+            writeU8 (writer, C->channel);
+            writeU32(writer, C->color);
+        }
+
+        if (mask & NET_POS_SMALL)
+        {
+            writeU16(writer, C->x - B->x);
+            writeU16(writer, C->y - B->y);
+        }
+
+        if (mask & NET_POS)
+        {
+            writeU32(writer, C->x);
+            writeU32(writer, C->y);
+        }
+
+        if (mask & NET_VELOCITY)
+        {
+            writeU16(writer, C->velX);
+            writeU16(writer, C->velY);
+        }
+
+        if (mask & NET_ANGLE)
+        {
+            writeU16(writer, C->angle);
+            writeU16(writer, C->angVel);
+        }
+
+        if (mask & NET_COMMANDS)    writeU16(writer, C->commands);
+        if (mask & NET_COLOR)       writeU32(writer, C->color);
+
+        sent->Entities[i] = *C;
+        numEntries++;
+    }
+
+    writer->data[countAt] = numEntries;
+
+    return numEntries;
+}
+
+// The baseline with the entries applied; 1 if the packet is malformed, and out is then garbage
+int readSnapshot(struct PacketReader* reader, const struct NetSnapshot* baseline, struct NetSnapshot* out)
+{
+    struct NetEntity* E;
+    int i, index, mask, numEntries;
+
+    if (baseline)
+        *out = *baseline;
+    else
+        memset(out, 0, sizeof(struct NetSnapshot));
+
+    out->count = readU8(reader);
+    numEntries = readU8(reader);
+
+    if (out->count > NET_MAX_ENTITIES)
+        return 1;
+
+    for (i = out->count; i < NET_MAX_ENTITIES; i++)
+        out->Entities[i].present = 0;
+
+    for (i = 0; i < numEntries; i++)
+    {
+        index = readU8(reader);
+        mask  = readU8(reader);
+
+        if (index >= out->count)
+            return 1;
+
+        E = &out->Entities[index];
+
+        if (mask & NET_SPAWN)
+        {
+            E->type    = readU32(reader);
+            E->control = readU8 (reader);
+            E->channel = readU8 (reader);
+            E->color   = readU32(reader);
+            E->present = 1;
+        }
+        else if (!E->present)
+            return 1;
+
+        if (mask & NET_POS_SMALL)
+        {
+            E->x += (int16_t)readU16(reader);
+            E->y += (int16_t)readU16(reader);
+        }
+
+        if (mask & NET_POS)
+        {
+            E->x = (int32_t)readU32(reader);
+            E->y = (int32_t)readU32(reader);
+        }
+
+        if (mask & NET_VELOCITY)
+        {
+            E->velX = (int16_t)readU16(reader);
+            E->velY = (int16_t)readU16(reader);
+        }
+
+        if (mask & NET_ANGLE)
+        {
+            E->angle  = readU16(reader);
+            E->angVel = (int16_t)readU16(reader);
+        }
+
+        if (mask & NET_COMMANDS)    E->commands = readU16(reader);
+        if (mask & NET_COLOR)       E->color    = readU32(reader);
+    }
+
+    return reader->overflow;
+}
+
+/*********
+* Server *
+*********/
+int startServer(struct NetServer* server, uint16_t port)
+{
+    int i;
+
+    memset(server, 0, sizeof(struct NetServer));
+
+    if ((server->socket = openSocket(port)) < 0)
+        return 1;
+
+    for (i = 0; i < NET_MAX_CLIENTS; i++)
+        server->Clients[i].entity = -1;
+
+    return 0;
+}
+
+static void dropClient(struct NetServer* server, int slot)
+{
+    struct NetClient* Client = &server->Clients[slot];
+
+    free(Client->Sent);
+    Client->Sent      = NULL;
+    Client->connected = 0;
+    server->numClients--;
+}
+
+void stopServer(struct NetServer* server)
+{
+    int i;
+
+    for (i = 0; i < NET_MAX_CLIENTS; i++)
+        if (server->Clients[i].connected)
+            dropClient(server, i);
+
+    free(server->Tiles);
+    closeSocket(server->socket);
+    server->Tiles  = NULL;
+    server->socket = -1;
+}
+
+static void sendToClient(struct NetServer* server, struct NetClient* client, struct PacketWriter* writer)
+{
+    sendPacket(server->socket, &client->Address, writer->data, writer->size);
+
+    client->Stats.bytesOut += writer->size;
+    client->Stats.packetsOut++;
+    server->Stats.bytesOut += writer->size;
+    server->Stats.packetsOut++;
+}
+
+static void welcomeClient(struct NetServer* server, int slot)
+{
+    struct PacketWriter Writer = {.size = 0};
+
+    writeU8 (&Writer, NET_WELCOME);
+    writeU8 (&Writer, slot);
+    writeU8 (&Writer, server->Clients[slot].entity);
+    writeU32(&Writer, server->Current.tick);
+    sendToClient(server, &server->Clients[slot], &Writer);
+}
+
+static void acceptClient(struct NetServer* server, const struct NetAddress* from, NetConnectFunction onConnect, void* data)
+{
+    struct PacketWriter Writer = {.size = 0};
+    struct NetClient* Client;
+    int slot;
+
+    for (slot = 0; slot < NET_MAX_CLIENTS && server->Clients[slot].connected; slot++);
+
+    Client = &server->Clients[slot];
+
+    if (slot == NET_MAX_CLIENTS || (Client->entity < 0 && (Client->entity = onConnect(slot, data)) < 0)
+    ||  (Client->Sent = calloc(NET_HISTORY, sizeof(struct NetSnapshot))) == NULL)
+    {
+        writeU8(&Writer, NET_FULL);
+        sendPacket(server->socket, from, Writer.data, Writer.size);
+
+        return;
+    }
+
+    Client->connected     = 1;
+    Client->Address       = *from;
+    Client->ackTick       = NET_NO_BASELINE;
+    Client->newestInput   = 0;
+    Client->nextInput     = 1;
+    Client->lastProcessed = 0;
+    Client->Last          = (struct NetInput){0};
+    Client->lastHeard     = SDL_GetTicks();
+    memset(&Client->Stats, 0, sizeof(struct NetStats));
+    server->numClients++;
+
+    welcomeClient(server, slot);
+}
+
+// Inputs come newest first; anything already run or too old for the queue is dropped
+static void readInputs(struct NetClient* client, struct PacketReader* reader)
+{
+    uint32_t ack    = readU32(reader);
+    uint32_t newest = readU32(reader);
+    int i, count    = readU8(reader);
+    struct NetInput Input;
+
+    if (ack != NET_NO_BASELINE && (client->ackTick == NET_NO_BASELINE || ack > client->ackTick))
+        client->ackTick = ack;
+
+    for (i = 0; i < count && i < NET_INPUT_REDUNDANCY && newest >= (uint32_t)i + 1; i++)
+    {
+        Input.commands = readU16(reader);
+        Input.aimX     = (int16_t)readU16(reader);
+        Input.aimY     = (int16_t)readU16(reader);
+
+        if (reader->overflow || newest - i < client->nextInput || newest - i + NET_INPUT_QUEUE <= client->newestInput)
+            continue;
+
+        client->Inputs[(newest - i) % NET_INPUT_QUEUE] = Input;
+    }
+
+    if (!reader->overflow && newest > client->newestInput)
+        client->newestInput = newest;
+}
+
+// Everything waiting on the socket: connects, inputs and goodbyes; then clients gone quiet are dropped
+void pollServer(struct NetServer* server, NetConnectFunction onConnect, void* data)
+{
+    uint8_t buffer[NET_PACKET_SIZE];
+    struct PacketReader Reader;
+    struct NetAddress From;
+    struct NetClient* Client;
+    Uint32 now = SDL_GetTicks();
+    int size, slot;
+
+    while ((size = receivePacket(server->socket, &From, buffer, sizeof(buffer))) > 0)
+    {
+        Reader = (struct PacketReader){buffer, size, 0, 0};
+        server->Stats.bytesIn += size;
+        server->Stats.packetsIn++;
+
+        for (slot = 0; slot < NET_MAX_CLIENTS; slot++)
+            if (server->Clients[slot].connected && sameAddress(&server->Clients[slot].Address, &From))
+                break;
+
+        Client = slot < NET_MAX_CLIENTS ? &server->Clients[slot] : NULL;
+
+        if (Client)
+        {
+            Client->lastHeard = now;
+            Client->Stats.bytesIn += size;
+            Client->Stats.packetsIn++;
+        }
+
+        switch (readU8(&Reader))
+        {
+            case NET_CONNECT:
+                if (Client)
+                    welcomeClient(server, slot);    // the welcome got lost
+                else
+                    acceptClient(server, &From, onConnect, data);
+                break;
+
+            case NET_INPUT:
+                if (Client)
+                    readInputs(Client, &Reader);
+                break;
+
+            case NET_DISCONNECT:
+                if (Client)
+                    dropClient(server, slot);
+                break;
+        }
+    }
+
+    for (slot = 0; slot < NET_MAX_CLIENTS; slot++)
+        if (server->Clients[slot].connected && now - server->Clients[slot].lastHeard > NET_TIMEOUT_MS)
+            dropClient(server, slot);
+}
+
+// The client's input for this tick. A late input repeats the last one, and a client that has run ahead of the
+// queue skips to near its newest, so the server never waits and lag can't build up.
+int nextServerInput(struct NetServer* server, int slot, struct NetInput* input)
+{
+    struct NetClient* Client = &server->Clients[slot];
+
+    if (!Client->connected)
+        return 0;
+
+    if (Client->newestInput >= Client->nextInput)
+    {
+        if (Client->newestInput - Client->nextInput >= NET_MAX_INPUT_LAG)
+            Client->nextInput = Client->newestInput - NET_MAX_INPUT_LAG + 1;
+
+        Client->Last          = Client->Inputs[Client->nextInput % NET_INPUT_QUEUE];
+        Client->lastProcessed = Client->nextInput++;
+    }
+
+    *input = Client->Last;
+
+    return 1;
+}
+
+// Room for count tiles in server->Tiles; 1 if there isn't memory for them
+int reserveNetTiles(struct NetServer* server, int count)
+{
+    struct NetTile* grown;
+
+    if (count <= server->maxTiles)
+        return 0;
+
+    if ((grown = realloc(server->Tiles, count * sizeof(struct NetTile))) == NULL)
+    {
+        printf("Error - reserveNetTiles(): could not allocate %d tiles\n", count);
+
+        return 1;
+    }
+
+    server->Tiles    = grown;
+    server->maxTiles = count;
+
+    return 0;
+}
+
+// Tile count and the tiles set since the baseline (every one the game changed without one), as many as
+// NET_MAX_TILES. Starts at a different tile every tick so none of them starve. Returns the serial the receiver
+// then holds every edit up to, short of the oldest one left out.
+static uint32_t writeTiles(struct PacketWriter* writer, const struct NetServer* server, const struct NetSnapshot* baseline)
+{
+    const struct NetTile* T;
+    uint32_t since = baseline ? baseline->tileSerial : 0, held = server->tileSerial;
+    int n, count = 0, countAt = writer->size;
+
+    writeU8(writer, 0);
+
+    for (n = 0; n < server->numTiles; n++)
+    {
+        T = &server->Tiles[(n + server->Current.tick) % server->numTiles];
+
+        if (T->serial <= since)
+            continue;
+
+        if (count == NET_MAX_TILES)
+        {
+            held = SDL_min(held, T->serial - 1);
+
+            continue;
+        }
+
+        writeU16(writer, T->x);
+        writeU16(writer, T->y);
+        writeU16(writer, T->tile);
+        count++;
+    }
+
+    writer->data[countAt] = count;
+
+    return held;
+}
+
+// Current to every client, against the newest snapshot it acked if that's still in its history, whole otherwise
+void sendSnapshots(struct NetServer* server)
+{
+    struct PacketWriter Writer;
+    struct NetClient* Client;
+    const struct NetSnapshot* Baseline;
+    uint32_t tick = server->Current.tick, tileSerial;
+    int slot;
+
+    for (slot = 0; slot < NET_MAX_CLIENTS; slot++)
+    {
+        Client = &server->Clients[slot];
+
+        if (!Client->connected)
+            continue;
+
+        Baseline = NULL;
+
+        if (Client->ackTick != NET_NO_BASELINE && Client->ackTick < tick && tick - Client->ackTick < NET_HISTORY
+        &&  Client->Sent[Client->ackTick % NET_HISTORY].tick == Client->ackTick)
+            Baseline = &Client->Sent[Client->ackTick % NET_HISTORY];
+
+        Writer.size     = 0;
+        Writer.overflow = 0;
+        writeU8 (&Writer, NET_SNAPSHOT);
+        writeU32(&Writer, Client->lastProcessed);
+        writeU32(&Writer, tick);
+        writeU32(&Writer, Baseline ? Baseline->tick : NET_NO_BASELINE);
+        tileSerial = writeTiles(&Writer, server, Baseline);
+        writeSnapshot(&Writer, &server->Current, Baseline, &Client->Sent[tick % NET_HISTORY], Client->hidden);
+        Client->Sent[tick % NET_HISTORY].tileSerial = tileSerial;
+
+        if (Baseline == NULL)
+        {
+            Client->Stats.fullSnapshots++;
+            server->Stats.fullSnapshots++;
+        }
+
+        sendToClient(server, Client, &Writer);
+    }
+}
+
+/*********
+* Client *
+*********/
+static void sendToServer(struct NetConnection* connection, struct PacketWriter* writer)
+{
+    sendPacket(connection->socket, &connection->Server, writer->data, writer->size);
+
+    connection->Stats.bytesOut += writer->size;
+    connection->Stats.packetsOut++;
+}
+
+static void sendConnect(struct NetConnection* connection)
+{
+    struct PacketWriter Writer = {.size = 0};
+
+    writeU8(&Writer, NET_CONNECT);
+    sendToServer(connection, &Writer);
+    connection->lastConnect = SDL_GetTicks();
+}
+
+int connectClient(struct NetConnection* connection, const char* address)
+{
+    memset(connection, 0, sizeof(struct NetConnection));
+    connection->socket = -1;
+
+    if (parseAddress(address, &connection->Server))
+        return 1;
+
+    if ((connection->History = calloc(NET_HISTORY, sizeof(struct NetSnapshot))) == NULL)
+    {
+        printf("Error - connectClient(): could not allocate snapshot history\n");
+
+        return 1;
+    }
+
+    if ((connection->socket = openSocket(0)) < 0)
+    {
+        free(connection->History);
+        connection->History = NULL;
+
+        return 1;
+    }
+
+    connection->slot       = -1;
+    connection->entity     = -1;
+    connection->latestTick = NET_NO_BASELINE;
+    sendConnect(connection);
+
+    return 0;
+}
+
+void disconnectClient(struct NetConnection* connection)
+{
+    struct PacketWriter Writer = {.size = 0};
+
+    if (connection->socket < 0)
+        return;
+
+    if (connection->slot >= 0)
+    {
+        writeU8(&Writer, NET_DISCONNECT);
+        sendToServer(connection, &Writer);
+    }
+
+    closeSocket(connection->socket);
+    free(connection->History);
+    connection->History = NULL;
+    connection->socket  = -1;
+    connection->slot    = -1;
+}
+
+static int readServerSnapshot(struct NetConnection* connection, struct PacketReader* reader)
+{
+    const struct NetSnapshot* Baseline = NULL;
+    struct NetTile Tiles[NET_MAX_TILES];
+    uint32_t lastProcessed = readU32(reader);
+    uint32_t tick          = readU32(reader);
+    uint32_t baseTick      = readU32(reader);
+    struct NetSnapshot* Out = &connection->History[tick % NET_HISTORY];
+    int i, numTiles;
+
+    if (reader->overflow || (connection->latestTick != NET_NO_BASELINE && tick <= connection->latestTick))
+        return 0;   // late or duplicate
+
+    if (baseTick != NET_NO_BASELINE)
+    {
+        Baseline = &connection->History[baseTick % NET_HISTORY];
+
+        if (Baseline->tick != baseTick || Baseline == Out)
+            return 0;   // a baseline we no longer hold; the next ack will sort it out
+    }
+
+    // they cover every edit since the baseline, so the newest snapshot's are all the game needs
+    if ((numTiles = readU8(reader)) > NET_MAX_TILES)
+        return 0;
+
+    for (i = 0; i < numTiles; i++)
+    {
+        Tiles[i].x    = readU16(reader);
+        Tiles[i].y    = readU16(reader);
+        Tiles[i].tile = readU16(reader);
+    }
+
+    if (reader->overflow || readSnapshot(reader, Baseline, Out))
+    {
+        Out->tick = NET_NO_BASELINE;
+
+        return 0;
+    }
+
+    Out->tick                 = tick;
+    connection->latestTick    = tick;
+    connection->lastProcessed = lastProcessed;
+    connection->numTiles      = numTiles;
+    memcpy(connection->Tiles, Tiles, numTiles * sizeof(struct NetTile));
+
+    return 1;
+}
+
+// Reads everything waiting; 1 if a newer snapshot came in
+int pollClient(struct NetConnection* connection)
+{
+    uint8_t buffer[NET_PACKET_SIZE];
+    struct PacketReader Reader;
+    struct NetAddress From;
+    int size, snapshot = 0;
+
+    if (connection->socket < 0)
+        return 0;
+
+    if (connection->slot < 0 && SDL_GetTicks() - connection->lastConnect > NET_CONNECT_RETRY_MS)
+        sendConnect(connection);
+
+    while ((size = receivePacket(connection->socket, &From, buffer, sizeof(buffer))) > 0)
+    {
+        if (!sameAddress(&From, &connection->Server))
+            continue;
+
+        Reader = (struct PacketReader){buffer, size, 0, 0};
+        connection->Stats.bytesIn += size;
+        connection->Stats.packetsIn++;
+
+        switch (readU8(&Reader))
+        {
+            case NET_WELCOME:
+                connection->slot        = readU8(&Reader);
+                connection->entity      = readU8(&Reader);
+                connection->welcomeTick = readU32(&Reader);
+                break;
+
+            case NET_FULL:
+                if (connection->slot < 0)
+                    printf("Error - pollClient(): server is full\n");
+                break;
+
+            case NET_SNAPSHOT:
+                if (connection->slot >= 0)
+                    snapshot |= readServerSnapshot(connection, &Reader);
+                break;
+        }
+    }
+
+    return snapshot;
+}
+
+// Queues the input under the next sequence number and sends it with the ones before it
+void sendClientInput(struct NetConnection* connection, struct NetInput input)
+{
+    struct PacketWriter Writer = {.size = 0};
+    struct NetInput* Input;
+    uint32_t seq;
+    int i;
+
+    if (connection->slot < 0)
+        return;
+
+    seq = ++connection->inputSeq;
+    connection->Pending[seq % NET_INPUT_QUEUE] = input;
+
+    writeU8 (&Writer, NET_INPUT);
+    writeU32(&Writer, connection->latestTick);
+    writeU32(&Writer, seq);
+    writeU8 (&Writer, seq < NET_INPUT_REDUNDANCY ? seq : NET_INPUT_REDUNDANCY);
+
+    for (i = 0; i < NET_INPUT_REDUNDANCY && (uint32_t)i < seq; i++)
+    {
+        Input = &connection->Pending[(seq - i) % NET_INPUT_QUEUE];
+        writeU16(&Writer, Input->commands);
+        writeU16(&Writer, Input->aimX);
+        writeU16(&Writer, Input->aimY);
+    }
+
+    sendToServer(connection, &Writer);
+}
+
+struct NetSnapshot* latestSnapshot(struct NetConnection* connection)
+{
+    if (connection->latestTick == NET_NO_BASELINE)
+        return NULL;
+
+    return &connection->History[connection->latestTick % NET_HISTORY];
+}
+
+/*******
+* Bots *
+*******/
+static int botThread(void* data)
+{
+    struct NetBot* Bot = data;
+    struct NetInput Input = {0};
+    struct Rng Rng;
+    char address[32];
+    Uint64 next = SDL_GetPerformanceCounter();
+    Uint64 period = SDL_GetPerformanceFrequency() / 60;
+    Uint64 now;
+    int ticks = 0;
+
+    seedRng(&Rng, Bot->index, 0);
+    snprintf(address, sizeof(address), "127.0.0.1:%d", Bot->Bots->port);
+
+    if (connectClient(&Bot->Connection, address))
+        return 1;
+
+    while (SDL_AtomicGet(&Bot->Bots->running))
+    {
+        pollClient(&Bot->Connection);
+
+        if (ticks++ % 30 == 0)
+        {
+            Input.commands = nextRng(&Rng) & Bot->Bots->commandMask;
+            Input.aimX     = rngBelow(&Rng, 2048) - 1024;
+            Input.aimY     = rngBelow(&Rng, 2048) - 1024;
+        }
+
+        sendClientInput(&Bot->Connection, Input);
+
+        next += period;
+        now   = SDL_GetPerformanceCounter();
+
+        if (next > now)
+            SDL_Delay((Uint32)((next - now) * 1000 / SDL_GetPerformanceFrequency()));
+    }
+
+    disconnectClient(&Bot->Connection);
+
+    return 0;
+}
+
+int startBots(struct NetBots* bots, int count, uint16_t port, uint16_t commandMask)
+{
+    int i;
+
+    memset(bots, 0, sizeof(struct NetBots));
+    bots->port        = port;
+    bots->commandMask = commandMask;
+    SDL_AtomicSet(&bots->running, 1);
+
+    for (i = 0; i < count && i < NET_MAX_CLIENTS; i++)
+    {
+        bots->Bot[i].Bots  = bots;
+        bots->Bot[i].index = i;
+
+        if ((bots->Bot[i].Thread = SDL_CreateThread(botThread, "bot", &bots->Bot[i])) == NULL)
+        {
+            printf("Error - startBots(): could not start bot %d\n", i);
+            break;
+        }
+
+        bots->count++;
+    }
+
+    return bots->count < count;
+}
+
+void stopBots(struct NetBots* bots)
+{
+    int i;
+
+    SDL_AtomicSet(&bots->running, 0);
+
+    for (i = 0; i < bots->count; i++)
+        SDL_WaitThread(bots->Bot[i].Thread, NULL);
+
+    bots->count = 0;
+}
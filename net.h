@@ -0,0 +1,205 @@
+#ifndef NET_H
+#define NET_H
+
+#include <SDL2/SDL.h>
+#include <stdint.h>
+#include "rng.h"
+
+#define NET_DEFAULT_PORT        27960
+#define NET_MAX_CLIENTS         64
+#define NET_MAX_ENTITIES        128         // per snapshot; entity indices go out as one byte
+#define NET_HISTORY             32          // snapshots kept for delta baselines, about half a second at 60 Hz
+#define NET_INPUT_QUEUE         64          // inputs kept by sequence number, on both ends
+#define NET_INPUT_REDUNDANCY    4           // each input packet repeats the newest inputs, so one lost packet costs nothing
+#define NET_MAX_INPUT_LAG       8           // queued inputs beyond this are skipped, so a burst can't add latency for good
+#define NET_MAX_TILES           40          // tile edits per snapshot, so they can't crowd out the entities
+#define NET_PACKET_SIZE         1400
+#define NET_TIMEOUT_MS          5000
+#define NET_CONNECT_RETRY_MS    500
+#define NET_NO_BASELINE         0xFFFFFFFFu
+
+#define NET_POSITION_SCALE      64.0f       // quantisation steps per world unit
+#define NET_VELOCITY_SCALE      1024.0f     // per world unit per tick
+#define NET_ANGLE_SCALE         (65536.0f / 6.28318531f)
+
+enum NetMessages
+{
+    NET_CONNECT = 1,    // client: let me in
+    NET_WELCOME,        // server: slot, entity, tick
+    NET_FULL,           // server: no free slot
+    NET_INPUT,          // client: snapshot ack, newest sequence number, the last few inputs
+    NET_SNAPSHOT,       // server: tiles and entities that changed since the snapshot the client acked
+    NET_DISCONNECT      // client: leaving
+};
+
+// Fields of an entity in a snapshot; only those that changed since the baseline are sent
+enum NetFields
+{
+    NET_SPAWN       = 1 << 0,   // type, control, channel and color, for an entity the baseline doesn't have
+    NET_POS_SMALL   = 1 << 1,   // position as 16-bit steps from the baseline
+    NET_POS         = 1 << 2,
+    NET_VELOCITY    = 1 << 3,
+    NET_ANGLE       = 1 << 4,   // and angular velocity
+    NET_COMMANDS    = 1 << 5,
+    NET_COLOR       = 1 << 6
+};
+
+struct NetAddress
+{
+    uint32_t host;      // both in network byte order
+    uint16_t port;
+};
+
+// An entity as the network sees it, quantised
+struct NetEntity
+{
+    uint8_t     present;
+    uint8_t     control, channel;
+    uint32_t    type;
+    int32_t     x, y;
+    int16_t     velX, velY;
+    uint16_t    angle;
+    int16_t     angVel;
+    uint16_t    commands;
+    uint32_t    color;
+};
+
+// A tile as the server's game last set it
+struct NetTile
+{
+    uint16_t    x, y, tile;
+    uint32_t    serial;         // the board's editSerial then; only the server uses it
+};
+
+struct NetSnapshot
+{
+    uint32_t            tick;
+    uint32_t            tileSerial;             // the receiver holds every tile edit up to this one
+    int                 count;
+    struct NetEntity    Entities[NET_MAX_ENTITIES];
+};
+
+struct NetInput
+{
+    uint16_t commands;
+    int16_t  aimX, aimY;
+};
+
+struct PacketWriter
+{
+    uint8_t data[NET_PACKET_SIZE];
+    int     size, overflow;
+};
+
+struct PacketReader
+{
+    const uint8_t*  data;
+    int             size, position, overflow;
+};
+
+struct NetStats
+{
+    uint64_t bytesOut, bytesIn;
+    int      packetsOut, packetsIn, fullSnapshots;
+};
+
+struct NetClient
+{
+    int                 connected;
+    struct NetAddress   Address;
+    int                 entity;                 // kept when the slot is reused, so a reconnect gets the same one back
+    uint32_t            ackTick;                // newest snapshot the client has confirmed
+    uint32_t            newestInput, nextInput; // sequence numbers received and due
+    uint32_t            lastProcessed;
+    struct NetInput     Inputs[NET_INPUT_QUEUE];
+    struct NetInput     Last;
+    struct NetSnapshot* Sent;                   // [NET_HISTORY], what the client holds after each snapshot, by tick
+    uint8_t             hidden[NET_MAX_ENTITIES/8]; // set by the game before sendSnapshots(), for entities the client can't see
+    Uint32              lastHeard;
+    struct NetStats     Stats;
+};
+
+struct NetServer
+{
+    int                 socket;
+    int                 numClients;
+    struct NetClient    Clients[NET_MAX_CLIENTS];
+    struct NetSnapshot  Current;                // filled by the game before sendSnapshots()
+    struct NetTile*     Tiles;                  // every tile the game has changed, likewise; see reserveNetTiles()
+    int                 numTiles, maxTiles;
+    uint32_t            tileSerial;             // the newest of them
+    struct NetStats     Stats;
+};
+
+struct NetConnection
+{
+    int                 socket;
+    struct NetAddress   Server;
+    int                 slot, entity;           // -1 until welcomed
+    uint32_t            welcomeTick;
+    uint32_t            latestTick;             // newest snapshot held, NET_NO_BASELINE before the first
+    uint32_t            lastProcessed;          // newest of our inputs the server had run into it
+    uint32_t            inputSeq;
+    struct NetInput     Pending[NET_INPUT_QUEUE];
+    struct NetSnapshot* History;                // [NET_HISTORY], by tick
+    struct NetTile      Tiles[NET_MAX_TILES];   // from the newest snapshot, for the game to set
+    int                 numTiles;
+    Uint32              lastConnect;
+    struct NetStats     Stats;
+};
+
+struct NetBot
+{
+    struct NetBots*         Bots;
+    int                     index;
+    SDL_Thread*             Thread;
+    struct NetConnection    Connection;
+};
+
+// Clients on their own threads that press random commands, for loading a server without players
+struct NetBots
+{
+    int                     count;
+    SDL_atomic_t            running;
+    uint16_t                port, commandMask;
+    struct NetBot           Bot[NET_MAX_CLIENTS];
+};
+
+typedef int (*NetConnectFunction)(int slot, void* data);    // returns the client's entity, or -1 to turn it away
+
+int  initNet            (void);
+void killNet            (void);
+int  openSocket         (uint16_t port);
+void closeSocket        (int socket);
+int  sendPacket         (int socket, const struct NetAddress* to, const void* data, int size);
+int  receivePacket      (int socket, struct NetAddress* from, void* data, int size);
+int  parseAddress       (const char* text, struct NetAddress* address);
+
+void writeU8            (struct PacketWriter* writer, uint8_t value);
+void writeU16           (struct PacketWriter* writer, uint16_t value);
+void writeU32           (struct PacketWriter* writer, uint32_t value);
+uint8_t  readU8         (struct PacketReader* reader);
+uint16_t readU16        (struct PacketReader* reader);
+uint32_t readU32        (struct PacketReader* reader);
+
+int  writeSnapshot      (struct PacketWriter* writer, const struct NetSnapshot* current, const struct NetSnapshot* baseline, struct NetSnapshot* sent,
+                         const uint8_t* hidden);
+int  readSnapshot       (struct PacketReader* reader, const struct NetSnapshot* baseline, struct NetSnapshot* out);
+
+int  startServer        (struct NetServer* server, uint16_t port);
+void stopServer         (struct NetServer* server);
+void pollServer         (struct NetServer* server, NetConnectFunction onConnect, void* data);
+int  nextServerInput    (struct NetServer* server, int slot, struct NetInput* input);
+int  reserveNetTiles    (struct NetServer* server, int count);
+void sendSnapshots      (struct NetServer* server);
+
+int  connectClient      (struct NetConnection* connection, const char* address);
+void disconnectClient   (struct NetConnection* connection);
+int  pollClient         (struct NetConnection* connection);
+void sendClientInput    (struct NetConnection* connection, struct NetInput input);
+struct NetSnapshot* latestSnapshot(struct NetConnection* connection);
+
+int  startBots          (struct NetBots* bots, int count, uint16_t port, uint16_t commandMask);
+void stopBots           (struct NetBots* bots);
+
+#endif
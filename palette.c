@@ -0,0 +1,322 @@
+#include "palette.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define channel555(color, axis)     (((color) >> (10 - 5*(axis))) & 31)
+#define expand5(value)              ((value) << 3 | (value) >> 2)
+
+// A run of the distinct colors, sorted along whichever axis it was last split on
+struct ColorBox
+{
+    int         begin, end;
+    int         lo[3], hi[3];
+    uint32_t    count;
+};
+
+static void shrinkBox(struct ColorBox* box, const uint16_t* colors, const uint32_t* counts)
+{
+    int i, axis, value;
+
+    box->count = 0;
+
+    for (axis = 0; axis < 3; axis++)
+    {
+        box->lo[axis] = 31;
+        box->hi[axis] = 0;
+    }
+
+    for (i = box->begin; i < box->end; i++)
+    {
+        box->count += counts[colors[i]];
+
+        for (axis = 0; axis < 3; axis++)
+        {
+            value = channel555(colors[i], axis);
+            box->lo[axis] = SDL_min(box->lo[axis], value);
+            box->hi[axis] = SDL_max(box->hi[axis], value);
+        }
+    }
+}
+
+static int widestAxis(const struct ColorBox* box)
+{
+    int axis, widest = 0;
+
+    for (axis = 1; axis < 3; axis++)
+        if (box->hi[axis] - box->lo[axis] > box->hi[widest] - box->lo[widest])
+            widest = axis;
+
+    return widest;
+}
+
+// Sorts the box along its widest axis, 32 buckets being all a 5 bit channel needs, and cuts it where half
+// its pixels are on either side
+static void splitBox(struct ColorBox* box, struct ColorBox* other, uint16_t* colors, uint16_t* scratch, const uint32_t* counts)
+{
+    const int axis = widestAxis(box);
+    int bucketStart[33] = {0};
+    int i, split;
+    uint32_t half, sum;
+
+    for (i = box->begin; i < box->end; i++)
+        bucketStart[channel555(colors[i], axis) + 1]++;
+
+    for (i = 1; i <= 32; i++)
+        bucketStart[i] += bucketStart[i-1];
+
+    for (i = box->begin; i < box->end; i++)
+        scratch[bucketStart[channel555(colors[i], axis)]++] = colors[i];
+
+    memcpy(colors + box->begin, scratch, (box->end - box->begin) * sizeof(uint16_t));
+
+    half = box->count / 2;
+    sum  = 0;
+
+    // both halves keep at least one color, even when the last has most of the pixels
+    for (split = box->begin; split < box->end - 2; split++)
+        if ((sum += counts[colors[split]]) >= half)
+            break;
+
+    other->begin = split + 1;
+    other->end   = box->end;
+    box->end     = split + 1;
+
+    shrinkBox(box,   colors, counts);
+    shrinkBox(other, colors, counts);
+}
+
+static void buildInverse(struct Palette* palette)
+{
+    int color, i, r, g, b, dr, dg, db, distance, best, bestDistance;
+
+    for (color = 0; color < INVERSE_SIZE; color++)
+    {
+        r = expand5(channel555(color, 0));
+        g = expand5(channel555(color, 1));
+        b = expand5(channel555(color, 2));
+        best         = 1;
+        bestDistance = INT32_MAX;
+
+        for (i = 1; i <= palette->numColors; i++)
+        {
+            dr = r - (int)(palette->Colors[i] >> 16 & 0xFF);
+            dg = g - (int)(palette->Colors[i] >> 8  & 0xFF);
+            db = b - (int)(palette->Colors[i]       & 0xFF);
+            distance = dr*dr + dg*dg + db*db;
+
+            if (distance < bestDistance)
+            {
+                bestDistance = distance;
+                best         = i;
+            }
+        }
+
+        palette->Inverse[color] = best;
+    }
+}
+
+// Median cut over the opaque pixels of the ARGB8888 images; index PALETTE_CLEAR stays out of it. The fog
+// colormaps start out for black.
+int buildPalette(struct Palette* palette, SDL_Surface** images, int numImages)
+{
+    struct ColorBox Boxes[PALETTE_SIZE-1];
+    uint32_t* counts  = calloc(INVERSE_SIZE, sizeof(uint32_t));
+    uint16_t* colors  = malloc(INVERSE_SIZE * sizeof(uint16_t));
+    uint16_t* scratch = malloc(INVERSE_SIZE * sizeof(uint16_t));
+    uint32_t pixel, score, bestScore, sum[3];
+    int numBoxes, numDistinct = 0;
+    int i, x, y, axis, best;
+
+    if (counts == NULL || colors == NULL || scratch == NULL)
+    {
+        printf("Error - buildPalette() failed to allocate the histogram\n");
+        free(counts);
+        free(colors);
+        free(scratch);
+
+        return 1;
+    }
+
+    for (i = 0; i < numImages; i++)
+    {
+        if (images[i] == NULL || images[i]->format->format != SDL_PIXELFORMAT_ARGB8888)
+            continue;
+
+        for (y = 0; y < images[i]->h; y++)
+        {
+            for (x = 0; x < images[i]->w; x++)
+            {
+                pixel = ((uint32_t*)((uint8_t*)images[i]->pixels + y * images[i]->pitch))[x];
+
+                if (pixel >> 24 >= 128)
+                    counts[(pixel >> 19 & 31) << 10 | (pixel >> 11 & 31) << 5 | (pixel >> 3 & 31)]++;
+            }
+        }
+    }
+
+    for (i = 0; i < INVERSE_SIZE; i++)
+        if (counts[i])
+            colors[numDistinct++] = i;
+
+    numBoxes = 0;
+
+    if (numDistinct > 0)
+    {
+        Boxes[0].begin = 0;
+        Boxes[0].end   = numDistinct;
+        shrinkBox(&Boxes[0], colors, counts);
+        numBoxes = 1;
+    }
+
+    // split the box with the most pixels times the most spread, until the palette is full or every box is one color
+    while (numBoxes < PALETTE_SIZE-1)
+    {
+        best      = -1;
+        bestScore = 0;
+
+        for (i = 0; i < numBoxes; i++)
+        {
+            if (Boxes[i].end - Boxes[i].begin < 2)
+                continue;
+
+            axis  = widestAxis(&Boxes[i]);
+            score = Boxes[i].count * (uint32_t)(Boxes[i].hi[axis] - Boxes[i].lo[axis] + 1);
+
+            if (best < 0 || score > bestScore)
+            {
+                best      = i;
+                bestScore = score;
+            }
+        }
+
+        if (best < 0)
+            break;
+
+        splitBox(&Boxes[best], &Boxes[numBoxes++], colors, scratch, counts);
+    }
+
+    memset(palette->Colors, 0, sizeof(palette->Colors));
+    palette->Colors[PALETTE_CLEAR] = 0xFF000000;
+    palette->numColors = SDL_max(numBoxes, 1);
+    palette->Colors[1] = 0xFF000000;
+
+    for (i = 0; i < numBoxes; i++)
+    {
+        sum[0] = sum[1] = sum[2] = 0;
+
+        for (x = Boxes[i].begin; x < Boxes[i].end; x++)
+            for (axis = 0; axis < 3; axis++)
+                sum[axis] += expand5(channel555(colors[x], axis)) * counts[colors[x]];
+
+        palette->Colors[i+1] = 0xFF000000
+                             | (sum[0] / Boxes[i].count) << 16
+                             | (sum[1] / Boxes[i].count) << 8
+                             | (sum[2] / Boxes[i].count);
+    }
+
+    buildInverse(palette);
+    buildColormaps(palette, 0, 0, 0);
+
+    printf("buildPalette(): %d colors from %d distinct\n", palette->numColors, numDistinct);
+    free(counts);
+    free(colors);
+    free(scratch);
+
+    return 0;
+}
+
+// The light maps only depend on the palette; the fog maps are rebuilt when the fog color changes
+void buildColormaps(struct Palette* palette, uint8_t r, uint8_t g, uint8_t b)
+{
+    const int top = COLORMAP_LEVELS - 1;
+    int level, i, cr, cg, cb;
+
+    for (level = 0; level < COLORMAP_LEVELS; level++)
+    {
+        palette->Light[level][PALETTE_CLEAR] = PALETTE_CLEAR;
+        palette->Fog  [level][PALETTE_CLEAR] = PALETTE_CLEAR;
+
+        for (i = 1; i < PALETTE_SIZE; i++)
+        {
+            cr = palette->Colors[i] >> 16 & 0xFF;
+            cg = palette->Colors[i] >> 8  & 0xFF;
+            cb = palette->Colors[i]       & 0xFF;
+
+            palette->Light[level][i] = nearestIndex(palette, cr * level / top, cg * level / top, cb * level / top);
+            palette->Fog  [level][i] = nearestIndex(palette, cr + (r - cr) * level / top, cg + (g - cg) * level / top, cb + (b - cb) * level / top);
+        }
+    }
+
+    palette->fogColor = 0xFF000000 | r << 16 | g << 8 | b;
+}
+
+int quantiseImage(struct Palette* palette, SDL_Surface* image, struct IndexedImage* indexed)
+{
+    uint32_t pixel;
+    uint8_t* pixels;
+    int x, y;
+
+    if (image == NULL || image->format->format != SDL_PIXELFORMAT_ARGB8888)
+    {
+        printf("Error - quantiseImage() needs an ARGB8888 surface\n");
+
+        return 1;
+    }
+
+    if ((pixels = malloc((size_t)image->w * image->h)) == NULL)
+    {
+        printf("Error - quantiseImage() failed to allocate %dx%d\n", image->w, image->h);
+
+        return 1;
+    }
+
+    for (y = 0; y < image->h; y++)
+    {
+        for (x = 0; x < image->w; x++)
+        {
+            pixel = ((uint32_t*)((uint8_t*)image->pixels + y * image->pitch))[x];
+            pixels[y * image->w + x] = (pixel >> 24 < 128) ? PALETTE_CLEAR : nearestIndex(palette, pixel >> 16, pixel >> 8, pixel);
+        }
+    }
+
+    freeIndexedImage(indexed);
+    indexed->w      = image->w;
+    indexed->h      = image->h;
+    indexed->pixels = pixels;
+
+    return 0;
+}
+
+void freeIndexedImage(struct IndexedImage* indexed)
+{
+    free(indexed->pixels);
+    indexed->pixels = NULL;
+    indexed->w      = indexed->h = 0;
+}
+
+// The last step before upload, and the only one at 32 bits a pixel; four at a time, the palette being small
+// enough to stay in L1. dstPitch is in pixels.
+void expandPalette(const uint32_t* colors, const uint8_t* src, int srcPitch, uint32_t* dst, int dstPitch, int w, int h)
+{
+    const uint8_t* s;
+    uint32_t* d;
+    int x, y;
+
+    for (y = 0; y < h; y++)
+    {
+        s = src + y * srcPitch;
+        d = dst + y * dstPitch;
+
+        for (x = 0; x + 4 <= w; x += 4)
+        {
+            d[x]   = colors[s[x]];
+            d[x+1] = colors[s[x+1]];
+            d[x+2] = colors[s[x+2]];
+            d[x+3] = colors[s[x+3]];
+        }
+
+        for (; x < w; x++)
+            d[x] = colors[s[x]];
+    }
+}
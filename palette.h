@@ -0,0 +1,43 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <SDL2/SDL.h>
+#include <stdint.h>
+
+#define PALETTE_SIZE        256
+#define PALETTE_CLEAR       0       // index kept out of the palette for see-through texels
+#define COLORMAP_LEVELS     64      // shades between black or the fog color and the full color
+#define COLORMAP_SHIFT      2       // 0-255 light or fog to a level
+#define INVERSE_SIZE        32768   // one entry per RGB555 color
+
+// 256 colors picked from the game's images by median cut, and the colormaps that shade one index into another.
+// Light[level] darkens every color towards black, Fog[level] fades it into the fog color.
+struct Palette
+{
+    int         numColors;
+    uint32_t    Colors[PALETTE_SIZE];           // ARGB8888, what the indices expand to
+    uint8_t     Inverse[INVERSE_SIZE];          // nearest index for an RGB555 color
+    uint8_t     Light[COLORMAP_LEVELS][PALETTE_SIZE];
+    uint8_t     Fog  [COLORMAP_LEVELS][PALETTE_SIZE];
+    uint32_t    fogColor;                       // what Fog was built for
+};
+
+// An image as palette indices; pixels with less than half alpha are PALETTE_CLEAR
+struct IndexedImage
+{
+    int         w, h;
+    uint8_t*    pixels;
+};
+
+int     buildPalette    (struct Palette* palette, SDL_Surface** images, int numImages);
+void    buildColormaps  (struct Palette* palette, uint8_t r, uint8_t g, uint8_t b);
+int     quantiseImage   (struct Palette* palette, SDL_Surface* image, struct IndexedImage* indexed);
+void    freeIndexedImage(struct IndexedImage* indexed);
+void    expandPalette   (const uint32_t* colors, const uint8_t* src, int srcPitch, uint32_t* dst, int dstPitch, int w, int h);
+
+static inline uint8_t nearestIndex(const struct Palette* palette, uint8_t r, uint8_t g, uint8_t b)
+{
+    return palette->Inverse[(r >> 3) << 10 | (g >> 3) << 5 | (b >> 3)];
+}
+
+#endif
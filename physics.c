@@ -0,0 +1,97 @@
+#include "physics.h"
+#include <math.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Per body, as doVelocity() and doTransform() did it:
+// push by the force, in the body's frame if it's rotational, then slow down along the direction of travel
+// by its friction plus whatever is over the top speed, stopping an axis that friction would reverse.
+// The transform is the velocity scaled to world units.
+static inline void integrateBody(struct Bodies* b, int i, float physScale)
+{
+    float vx, vy, length, scale, drag, excess, frictionX, frictionY;
+
+    if (b->rotational[i] > 0)
+    {
+        vx = b->velX[i] + b->rotX[i] * -b->forceY[i] + b->rotY[i] * -b->forceX[i];
+        vy = b->velY[i] + b->rotY[i] * -b->forceY[i] + b->rotX[i] *  b->forceX[i];
+    }
+    else
+    {
+        vx = b->velX[i] + b->forceX[i];
+        vy = b->velY[i] + b->forceY[i];
+    }
+
+    length = sqrtf(vx*vx + vy*vy);
+    scale  = (length > 0) ? 1.0f / length : 0;
+    excess = vx*vx + vy*vy - b->maxVelSquared[i];
+    drag   = b->friction[i] + ((excess > 0) ? sqrtf(excess) : 0);
+
+    frictionX = vx * scale * drag;
+    frictionY = vy * scale * drag;
+    vx -= frictionX;
+    vy -= frictionY;
+
+    if (fabsf(vx) < fabsf(frictionX)) vx = 0;
+    if (fabsf(vy) < fabsf(frictionY)) vy = 0;
+
+    b->velX[i]   = vx;
+    b->velY[i]   = vy;
+    b->transX[i] = vx * physScale;
+    b->transY[i] = vy * physScale;
+}
+
+#ifdef __SSE2__
+#define select4(mask, a, b)     _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b))
+#define abs4(v)                 _mm_andnot_ps(_mm_set1_ps(-0.0f), v)
+
+static void integrate4(struct Bodies* b, int i, float physScale)
+{
+    const __m128 zero = _mm_setzero_ps();
+    __m128 rot, rx, ry, fx, fy, vx, vy, lengthSquared, length, scale, excess, drag, frictionX, frictionY;
+
+    rot = _mm_cmpgt_ps(_mm_loadu_ps(b->rotational + i), zero);
+    rx  = _mm_loadu_ps(b->rotX   + i);
+    ry  = _mm_loadu_ps(b->rotY   + i);
+    fx  = _mm_loadu_ps(b->forceX + i);
+    fy  = _mm_loadu_ps(b->forceY + i);
+    vx  = _mm_loadu_ps(b->velX   + i);
+    vy  = _mm_loadu_ps(b->velY   + i);
+
+    vx = _mm_add_ps(vx, select4(rot, _mm_sub_ps(zero, _mm_add_ps(_mm_mul_ps(rx, fy), _mm_mul_ps(ry, fx))), fx));
+    vy = _mm_add_ps(vy, select4(rot, _mm_sub_ps(_mm_mul_ps(rx, fx), _mm_mul_ps(ry, fy)), fy));
+
+    lengthSquared = _mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy));
+    length        = _mm_sqrt_ps(lengthSquared);
+    scale         = _mm_and_ps(_mm_cmpgt_ps(length, zero), _mm_div_ps(_mm_set1_ps(1.0f), length));
+    excess        = _mm_sub_ps(lengthSquared, _mm_loadu_ps(b->maxVelSquared + i));
+    drag          = _mm_add_ps(_mm_loadu_ps(b->friction + i), _mm_sqrt_ps(_mm_max_ps(excess, zero)));
+
+    frictionX = _mm_mul_ps(_mm_mul_ps(vx, scale), drag);
+    frictionY = _mm_mul_ps(_mm_mul_ps(vy, scale), drag);
+    vx = _mm_sub_ps(vx, frictionX);
+    vy = _mm_sub_ps(vy, frictionY);
+    vx = _mm_andnot_ps(_mm_cmplt_ps(abs4(vx), abs4(frictionX)), vx);
+    vy = _mm_andnot_ps(_mm_cmplt_ps(abs4(vy), abs4(frictionY)), vy);
+
+    _mm_storeu_ps(b->velX   + i, vx);
+    _mm_storeu_ps(b->velY   + i, vy);
+    _mm_storeu_ps(b->transX + i, _mm_mul_ps(vx, _mm_set1_ps(physScale)));
+    _mm_storeu_ps(b->transY + i, _mm_mul_ps(vy, _mm_set1_ps(physScale)));
+}
+#endif
+
+void integrateBodies(struct Bodies* bodies, int begin, int end, float physScale)
+{
+    int i = begin;
+
+#ifdef __SSE2__
+    for (; i + 4 <= end; i += 4)
+        integrate4(bodies, i, physScale);
+#endif
+
+    for (; i < end; i++)
+        integrateBody(bodies, i, physScale);
+}
@@ -0,0 +1,21 @@
+#ifndef PHYSICS_H
+#define PHYSICS_H
+
+// Moving entities gathered into dense arrays, one float per component field, so each step runs
+// straight-line kernels over them. Bodies are independent of each other until collision,
+// so any [begin, end) range can be integrated on its own, e.g. on another core.
+struct Bodies
+{
+    int     count, capacity;
+    int*    ids;                    // entity of each body
+    float*  rotational;             // 1 if the force is in the body's own frame, 0 if in world space
+    float  *rotX,    *rotY;
+    float  *forceX,  *forceY;
+    float  *velX,    *velY;
+    float  *maxVelSquared, *friction;
+    float  *transX,  *transY;
+};
+
+void integrateBodies(struct Bodies* bodies, int begin, int end, float physScale);
+
+#endif
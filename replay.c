@@ -0,0 +1,208 @@
+#include "replay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// File: magic, version, seed, ticks, frames, checksum and the map name, then the frames field by field.
+// Everything is written in the machine's byte order; replays are for comparing runs on the same machine.
+
+static int reserveFrames(struct Replay* replay, int count)
+{
+    struct ReplayFrame* grown;
+    int capacity = replay->capacity ? replay->capacity : 1024;
+
+    if (count <= replay->capacity)
+        return 0;
+
+    while (capacity < count)
+        capacity *= 2;
+
+    if ((grown = realloc(replay->Frames, capacity * sizeof(struct ReplayFrame))) == NULL)
+        return 1;
+
+    replay->Frames   = grown;
+    replay->capacity = capacity;
+
+    return 0;
+}
+
+int startRecording(struct Replay* replay, const char* map, uint32_t seed)
+{
+    killReplay(replay);
+
+    replay->mode = REPLAY_RECORDING;
+    replay->seed = seed;
+    strncpy(replay->map, map, REPLAY_MAP_SIZE-1);
+
+    printf("startRecording(): seed %u\n", seed);
+
+    return 0;
+}
+
+void recordInput(struct Replay* replay, uint32_t tick, int channel, struct ReplayInput input)
+{
+    struct ReplayInput* Current;
+
+    if (replay->mode != REPLAY_RECORDING || channel < 0 || channel >= REPLAY_MAX_CHANNELS)
+        return;
+
+    Current = &replay->Current[channel];
+
+    if (replay->numFrames && Current->commands == input.commands && Current->aimX == input.aimX && Current->aimY == input.aimY)
+        return;
+
+    if (reserveFrames(replay, replay->numFrames+1))
+    {
+        printf("Error - recordInput(): out of memory at tick %u, recording stopped\n", tick);
+        replay->mode = REPLAY_OFF;
+
+        return;
+    }
+
+    *Current = input;
+    replay->Frames[replay->numFrames++] = (struct ReplayFrame){tick, channel, input};
+}
+
+int saveReplay(struct Replay* replay, const char* filename, uint32_t numTicks, uint64_t checksum)
+{
+    const uint32_t magic = REPLAY_MAGIC, version = REPLAY_VERSION;
+    struct ReplayFrame* Frame;
+    FILE* file;
+    int i;
+
+    if ((file = fopen(filename, "wb")) == NULL)
+    {
+        printf("Error - saveReplay() could not open %s\n", filename);
+
+        return 1;
+    }
+
+    replay->numTicks = numTicks;
+    replay->checksum = checksum;
+
+    fwrite(&magic,              sizeof(magic),              1, file);
+    fwrite(&version,            sizeof(version),            1, file);
+    fwrite(&replay->seed,       sizeof(replay->seed),       1, file);
+    fwrite(&replay->numTicks,   sizeof(replay->numTicks),   1, file);
+    fwrite(&replay->numFrames,  sizeof(replay->numFrames),  1, file);
+    fwrite(&replay->checksum,   sizeof(replay->checksum),   1, file);
+    fwrite(replay->map,         REPLAY_MAP_SIZE,            1, file);
+
+    for (i = 0; i < replay->numFrames; i++)
+    {
+        Frame = &replay->Frames[i];
+        fwrite(&Frame->tick,            sizeof(Frame->tick),            1, file);
+        fwrite(&Frame->channel,         sizeof(Frame->channel),         1, file);
+        fwrite(&Frame->Input.commands,  sizeof(Frame->Input.commands),  1, file);
+        fwrite(&Frame->Input.aimX,      sizeof(Frame->Input.aimX),      1, file);
+        fwrite(&Frame->Input.aimY,      sizeof(Frame->Input.aimY),      1, file);
+    }
+
+    if (fclose(file))
+    {
+        printf("Error - saveReplay() could not write %s\n", filename);
+
+        return 1;
+    }
+
+    printf("saveReplay(): %u ticks in %d frames to %s\n", numTicks, replay->numFrames, filename);
+
+    return 0;
+}
+
+int loadReplay(struct Replay* replay, const char* filename)
+{
+    uint32_t magic = 0, version = 0;
+    struct ReplayFrame* Frame;
+    FILE* file;
+    int i, numFrames = 0, ok = 1;
+
+    killReplay(replay);
+
+    if ((file = fopen(filename, "rb")) == NULL)
+    {
+        printf("Error - loadReplay() could not open %s\n", filename);
+
+        return 1;
+    }
+
+    ok &= fread(&magic,             sizeof(magic),              1, file);
+    ok &= fread(&version,           sizeof(version),            1, file);
+
+    if (!ok || magic != REPLAY_MAGIC || version != REPLAY_VERSION)
+    {
+        printf("Error - loadReplay(): %s is not a version %d replay\n", filename, REPLAY_VERSION);
+        fclose(file);
+
+        return 1;
+    }
+
+    ok &= fread(&replay->seed,      sizeof(replay->seed),       1, file);
+    ok &= fread(&replay->numTicks,  sizeof(replay->numTicks),   1, file);
+    ok &= fread(&numFrames,         sizeof(numFrames),          1, file);
+    ok &= fread(&replay->checksum,  sizeof(replay->checksum),   1, file);
+    ok &= fread(replay->map,        REPLAY_MAP_SIZE,            1, file);
+    replay->map[REPLAY_MAP_SIZE-1] = '\0';
+
+    if (!ok || numFrames < 0 || reserveFrames(replay, numFrames))
+    {
+        printf("Error - loadReplay() could not read %s\n", filename);
+        fclose(file);
+        killReplay(replay);
+
+        return 1;
+    }
+
+    for (i = 0; i < numFrames && ok; i++)
+    {
+        Frame = &replay->Frames[i];
+        ok &= fread(&Frame->tick,           sizeof(Frame->tick),            1, file);
+        ok &= fread(&Frame->channel,        sizeof(Frame->channel),         1, file);
+        ok &= fread(&Frame->Input.commands, sizeof(Frame->Input.commands),  1, file);
+        ok &= fread(&Frame->Input.aimX,     sizeof(Frame->Input.aimX),      1, file);
+        ok &= fread(&Frame->Input.aimY,     sizeof(Frame->Input.aimY),      1, file);
+        ok &= Frame->channel < REPLAY_MAX_CHANNELS;
+    }
+
+    fclose(file);
+
+    if (!ok)
+    {
+        printf("Error - loadReplay(): %s is cut short or corrupt\n", filename);
+        killReplay(replay);
+
+        return 1;
+    }
+
+    replay->numFrames = numFrames;
+    replay->mode      = REPLAY_PLAYING;
+
+    printf("loadReplay(): %u ticks of %s, seed %u\n", replay->numTicks, replay->map, replay->seed);
+
+    return 0;
+}
+
+// Returns 1 once tick is past the end of the recording
+int playInput(struct Replay* replay, uint32_t tick, int channel, struct ReplayInput* input)
+{
+    struct ReplayFrame* Frame;
+
+    if (replay->mode != REPLAY_PLAYING || tick >= replay->numTicks)
+        return 1;
+
+    while (replay->next < replay->numFrames && replay->Frames[replay->next].tick <= tick)
+    {
+        Frame = &replay->Frames[replay->next++];
+        replay->Current[Frame->channel] = Frame->Input;
+    }
+
+    *input = replay->Current[channel];
+
+    return 0;
+}
+
+void killReplay(struct Replay* replay)
+{
+    free(replay->Frames);
+    memset(replay, 0, sizeof(struct Replay));
+}
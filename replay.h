@@ -0,0 +1,53 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdint.h>
+
+#define REPLAY_MAGIC        0x50524C42u     // "BLRP"
+#define REPLAY_VERSION      3       // 2: seeds the per-system streams instead of rand(); 3: tiles change, and the state hash covers them
+#define REPLAY_MAX_CHANNELS 8
+#define REPLAY_MAP_SIZE     64
+
+enum ReplayModes
+{
+    REPLAY_OFF,
+    REPLAY_RECORDING,
+    REPLAY_PLAYING
+};
+
+// What an input channel holds for a tick: the command word and where it aims, in world units
+struct ReplayInput
+{
+    uint16_t commands;
+    int32_t  aimX, aimY;
+};
+
+// Only changes are stored; a channel keeps its input until the next frame for it
+struct ReplayFrame
+{
+    uint32_t tick;
+    uint8_t  channel;
+    struct ReplayInput Input;
+};
+
+struct Replay
+{
+    int                 mode;
+    char                map[REPLAY_MAP_SIZE];
+    uint32_t            seed;
+    uint32_t            numTicks;       // how long the recording ran
+    uint64_t            checksum;       // of the game state after the last tick, to tell whether playback stayed exact
+    int                 numFrames, capacity;
+    int                 next;           // playback position
+    struct ReplayFrame* Frames;
+    struct ReplayInput  Current[REPLAY_MAX_CHANNELS];
+};
+
+int  startRecording (struct Replay* replay, const char* map, uint32_t seed);
+void recordInput    (struct Replay* replay, uint32_t tick, int channel, struct ReplayInput input);
+int  saveReplay     (struct Replay* replay, const char* filename, uint32_t numTicks, uint64_t checksum);
+int  loadReplay     (struct Replay* replay, const char* filename);
+int  playInput      (struct Replay* replay, uint32_t tick, int channel, struct ReplayInput* input);
+void killReplay     (struct Replay* replay);
+
+#endif
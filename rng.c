@@ -0,0 +1,57 @@
+#include "rng.h"
+
+static uint64_t splitMix64(uint64_t* state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+
+    return z ^ (z >> 31);
+}
+
+// Streams of the same seed are unrelated to each other; splitmix also keeps the state from being all zero
+void seedRng(struct Rng* rng, uint64_t seed, uint32_t stream)
+{
+    uint64_t state = seed ^ ((uint64_t)stream * 0xD1B54A32D192ED03ull);
+    uint64_t a = splitMix64(&state);
+    uint64_t b = splitMix64(&state);
+
+    rng->s[0] = (uint32_t)a;
+    rng->s[1] = (uint32_t)(a >> 32);
+    rng->s[2] = (uint32_t)b;
+    rng->s[3] = (uint32_t)(b >> 32);
+}
+
+// A stream for one piece of work, from the parent's state and key; the parent doesn't advance, so it can be forked
+// from any thread while the pieces run
+void forkRng(struct Rng* child, const struct Rng* parent, uint32_t key)
+{
+    uint64_t seed = ((uint64_t)parent->s[0] << 32 | parent->s[1]) ^ ((uint64_t)parent->s[2] << 32 | parent->s[3]);
+
+    seedRng(child, seed, key);
+}
+
+// Batches keep the state in registers for the whole run instead of going through memory for every number
+void fillRngFloats(struct Rng* rng, float* out, int count, float min, float max)
+{
+    struct Rng Local = *rng;
+    const float scale = (max - min) * (1.0f / 16777216.0f);
+    int i;
+
+    for (i = 0; i < count; i++)
+        out[i] = min + (nextRng(&Local) >> 8) * scale;
+
+    *rng = Local;
+}
+
+void fillRngInts(struct Rng* rng, int* out, int count, uint32_t range)
+{
+    struct Rng Local = *rng;
+    int i;
+
+    for (i = 0; i < count; i++)
+        out[i] = (int)(((uint64_t)nextRng(&Local) * range) >> 32);
+
+    *rng = Local;
+}
@@ -0,0 +1,59 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+// xoshiro128** generators in place of rand(): small, fast, the same sequence on every platform, and no hidden
+// shared state. Each system draws from its own stream, so adding a random call to one doesn't shift the others.
+// Work split across threads forks a stream per piece of work, keyed by something fixed like the first index,
+// never by the thread that happens to run it; that keeps parallel results the same as serial ones.
+
+struct Rng
+{
+    uint32_t s[4];
+};
+
+void seedRng        (struct Rng* rng, uint64_t seed, uint32_t stream);
+void forkRng        (struct Rng* child, const struct Rng* parent, uint32_t key);
+void fillRngFloats  (struct Rng* rng, float* out, int count, float min, float max);
+void fillRngInts    (struct Rng* rng, int* out, int count, uint32_t range);
+
+static inline uint32_t rotl32(uint32_t x, int k)
+{
+    return (x << k) | (x >> (32 - k));
+}
+
+static inline uint32_t nextRng(struct Rng* rng)
+{
+    uint32_t* s = rng->s;
+    const uint32_t result = rotl32(s[1] * 5, 7) * 9;
+    const uint32_t t = s[1] << 9;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3]  = rotl32(s[3], 11);
+
+    return result;
+}
+
+// [0, 1) from the top 24 bits, which is all a float holds
+static inline float rngUnit(struct Rng* rng)
+{
+    return (nextRng(rng) >> 8) * (1.0f / 16777216.0f);
+}
+
+static inline float rngFloat(struct Rng* rng, float min, float max)
+{
+    return min + rngUnit(rng) * (max - min);
+}
+
+// [0, range) without the bias or the division of rand() % range
+static inline uint32_t rngBelow(struct Rng* rng, uint32_t range)
+{
+    return (uint32_t)(((uint64_t)nextRng(rng) * range) >> 32);
+}
+
+#endif
@@ -0,0 +1,295 @@
+#include "snapshot.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HEADER_BYTES    16      // magic, version, size, region count
+#define MAX_RUN         0xFFFF
+
+#define align4(n)       (((n) + 3) & ~3u)
+
+// Grows the buffer; new bytes are zero, like everything past size
+static int reserveSnapshot(struct Snapshot* snapshot, uint32_t size)
+{
+    uint8_t* grown;
+    uint32_t capacity = snapshot->capacity ? snapshot->capacity : 4096;
+
+    if (size <= snapshot->capacity)
+        return 0;
+
+    while (capacity < size)
+        capacity *= 2;
+
+    if ((grown = realloc(snapshot->data, capacity)) == NULL)
+        return 1;
+
+    memset(grown + snapshot->capacity, 0, capacity - snapshot->capacity);
+    snapshot->data     = grown;
+    snapshot->capacity = capacity;
+
+    return 0;
+}
+
+void killSnapshot(struct Snapshot* snapshot)
+{
+    free(snapshot->data);
+    memset(snapshot, 0, sizeof(struct Snapshot));
+}
+
+int takeSnapshot(struct Snapshot* snapshot, const struct SnapshotRegion* regions, int count)
+{
+    uint32_t header[4] = {SNAPSHOT_MAGIC, SNAPSHOT_VERSION, HEADER_BYTES, count};
+    uint32_t offset, oldSize = snapshot->size;
+    uint8_t* data;
+    int i;
+
+    for (i = 0; i < count; i++)
+        header[2] += 4 + align4(regions[i].size);
+
+    if (reserveSnapshot(snapshot, header[2]))
+    {
+        printf("Error - takeSnapshot(): out of memory for %u bytes\n", header[2]);
+
+        return 1;
+    }
+
+    data = snapshot->data;
+    memcpy(data, header, HEADER_BYTES);
+
+    for (i = 0, offset = HEADER_BYTES; i < count; i++)
+    {
+        memcpy(data + offset, &regions[i].size, 4);
+        memcpy(data + offset + 4, regions[i].data, regions[i].size);
+        memset(data + offset + 4 + regions[i].size, 0, align4(regions[i].size) - regions[i].size);
+        offset += 4 + align4(regions[i].size);
+    }
+
+    if (oldSize > header[2])
+        memset(data + header[2], 0, oldSize - header[2]);
+
+    snapshot->size = header[2];
+
+    return 0;
+}
+
+// Everything is checked before anything is written, so a snapshot that doesn't fit leaves the state alone
+int restoreSnapshot(const struct Snapshot* snapshot, struct SnapshotRegion* regions, int count)
+{
+    const uint8_t* data = snapshot->data;
+    uint32_t header[4], offset, size;
+    int i;
+
+    if (snapshot->size < HEADER_BYTES)
+        return 1;
+
+    memcpy(header, data, HEADER_BYTES);
+
+    if (header[0] != SNAPSHOT_MAGIC || header[1] != SNAPSHOT_VERSION || header[2] != snapshot->size || header[3] != (uint32_t)count)
+    {
+        printf("Error - restoreSnapshot(): version %u snapshot of %u regions, expected version %d of %d\n", header[1], header[3], SNAPSHOT_VERSION, count);
+
+        return 1;
+    }
+
+    for (i = 0, offset = HEADER_BYTES; i < count; i++, offset += 4 + align4(size))
+    {
+        memcpy(&size, data + offset, 4);
+
+        if (size > regions[i].capacity || offset + 4 + size > snapshot->size)
+        {
+            printf("Error - restoreSnapshot(): region %d holds %u bytes, room for %u\n", i, size, regions[i].capacity);
+
+            return 1;
+        }
+    }
+
+    for (i = 0, offset = HEADER_BYTES; i < count; i++, offset += 4 + align4(size))
+    {
+        memcpy(&size, data + offset, 4);
+        regions[i].changed = size != regions[i].size || memcmp(regions[i].data, data + offset + 4, size);
+
+        if (regions[i].changed)
+            memcpy(regions[i].data, data + offset + 4, size);
+
+        regions[i].size = size;
+    }
+
+    return 0;
+}
+
+/*********
+* Rewind *
+*********/
+// Word count, then runs: a token with the equal words to skip in the high half and the differing ones in the low half,
+// followed by those words XORed
+static uint32_t encodeDelta(uint32_t* out, const uint32_t* a, const uint32_t* b, uint32_t words)
+{
+    uint32_t i = 0, n = 0, start, skip, literals;
+
+    out[n++] = words;
+
+    while (i < words)
+    {
+        for (skip = 0; i < words && skip < MAX_RUN && a[i] == b[i]; i++)
+            skip++;
+
+        for (start = i, literals = 0; i < words && literals < MAX_RUN && a[i] != b[i]; i++)
+            literals++;
+
+        out[n++] = skip << 16 | literals;
+
+        for (; start < i; start++)
+            out[n++] = a[start] ^ b[start];
+    }
+
+    return n;
+}
+
+static void applyDelta(uint32_t* target, const uint32_t* delta)
+{
+    uint32_t i = 0, n = 1, literals;
+
+    while (i < delta[0])
+    {
+        i       += delta[n] >> 16;
+        literals = delta[n++] & MAX_RUN;
+
+        while (literals--)
+            target[i++] ^= delta[n++];
+    }
+}
+
+// Room for length bytes after the newest step, dropping the oldest ones in the way
+static struct RewindStep* reserveStep(struct RewindBuffer* rewind, uint32_t length)
+{
+    struct RewindStep* Oldest;
+    uint32_t start = rewind->head;
+
+    if (length > rewind->budget)
+        return NULL;
+
+    if (start + length > rewind->budget)
+    {
+        start = 0;
+
+        // past the head are the oldest steps; they go first, or they'd outlive newer ones overwritten below
+        while (rewind->count && rewind->Steps[rewind->first].offset >= rewind->head)
+            rewind->first = (rewind->first + 1) % REWIND_MAX_STEPS, rewind->count--;
+    }
+
+    while (rewind->count)
+    {
+        Oldest = &rewind->Steps[rewind->first];
+
+        if (rewind->count < REWIND_MAX_STEPS && (Oldest->offset >= start + length || Oldest->offset + Oldest->length <= start))
+            break;
+
+        rewind->first = (rewind->first + 1) % REWIND_MAX_STEPS;
+        rewind->count--;
+    }
+
+    rewind->head = start + length;
+    Oldest = &rewind->Steps[(rewind->first + rewind->count++) % REWIND_MAX_STEPS];
+    *Oldest = (struct RewindStep){start, length};
+
+    return Oldest;
+}
+
+int initRewind(struct RewindBuffer* rewind, uint32_t budget)
+{
+    memset(rewind, 0, sizeof(struct RewindBuffer));
+
+    if (budget == 0)
+        return 0;
+
+    if ((rewind->bytes = malloc(budget)) == NULL)
+    {
+        printf("Error - initRewind(): could not allocate %u bytes\n", budget);
+
+        return 1;
+    }
+
+    rewind->budget = budget;
+
+    return 0;
+}
+
+void killRewind(struct RewindBuffer* rewind)
+{
+    free(rewind->bytes);
+    killSnapshot(&rewind->Last);
+    killSnapshot(&rewind->Next);
+    killSnapshot(&rewind->Delta);
+    memset(rewind, 0, sizeof(struct RewindBuffer));
+}
+
+void clearRewind(struct RewindBuffer* rewind)
+{
+    rewind->first = 0;
+    rewind->count = 0;
+    rewind->head  = 0;
+    rewind->valid = 0;
+}
+
+// Adds the current state as the newest step
+int pushRewind(struct RewindBuffer* rewind, const struct SnapshotRegion* regions, int count)
+{
+    struct Snapshot Swap;
+    struct RewindStep* Step;
+    uint32_t words, length;
+
+    if (rewind->budget == 0 || takeSnapshot(&rewind->Next, regions, count))
+        return 1;
+
+    if (rewind->valid)
+    {
+        words = (rewind->Last.size > rewind->Next.size ? rewind->Last.size : rewind->Next.size) / 4;
+
+        if (reserveSnapshot(&rewind->Last, words * 4) || reserveSnapshot(&rewind->Next, words * 4)
+        ||  reserveSnapshot(&rewind->Delta, (words + words / MAX_RUN + 4) * 4))
+        {
+            printf("Error - pushRewind(): out of memory, history dropped\n");
+            clearRewind(rewind);
+
+            return 1;
+        }
+
+        length = encodeDelta((uint32_t*)rewind->Delta.data, (uint32_t*)rewind->Last.data, (uint32_t*)rewind->Next.data, words) * 4;
+
+        if ((Step = reserveStep(rewind, length)) == NULL)
+            clearRewind(rewind);    // a step bigger than the whole budget; history restarts from here
+        else
+            memcpy(rewind->bytes + Step->offset, rewind->Delta.data, length);
+    }
+
+    Swap          = rewind->Last;
+    rewind->Last  = rewind->Next;
+    rewind->Next  = Swap;
+    rewind->valid = 1;
+
+    return 0;
+}
+
+// Steps back to the state before the newest one; 1 once there's nothing older
+int popRewind(struct RewindBuffer* rewind, struct SnapshotRegion* regions, int count)
+{
+    struct RewindStep* Step;
+    const uint32_t* Delta;
+
+    if (!rewind->valid || rewind->count == 0)
+        return 1;
+
+    Step  = &rewind->Steps[(rewind->first + rewind->count - 1) % REWIND_MAX_STEPS];
+    Delta = (const uint32_t*)(rewind->bytes + Step->offset);
+
+    if (reserveSnapshot(&rewind->Last, Delta[0] * 4))
+        return 1;
+
+    applyDelta((uint32_t*)rewind->Last.data, Delta);
+    memcpy(&rewind->Last.size, rewind->Last.data + 8, 4);
+
+    rewind->head = Step->offset;
+    rewind->count--;
+
+    return restoreSnapshot(&rewind->Last, regions, count);
+}
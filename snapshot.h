@@ -0,0 +1,54 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+
+#define SNAPSHOT_MAGIC      0x53534C42u     // "BLSS"
+#define SNAPSHOT_VERSION    1
+#define REWIND_MAX_STEPS    600             // 10 seconds of ticks at 60 Hz
+
+// A piece of state to capture: size bytes now, at most capacity when restored.
+// Restoring sets changed if the bytes differ, so the owner only rebuilds what depends on those.
+struct SnapshotRegion
+{
+    void*       data;
+    uint32_t    size, capacity;
+    int         changed;
+};
+
+// The regions back to back, each after its size and padded to 4 bytes, behind a header with the magic,
+// version, total size and region count. Bytes past size are kept zero so two snapshots XOR cleanly.
+struct Snapshot
+{
+    uint32_t    size, capacity;
+    uint8_t*    data;
+};
+
+struct RewindStep
+{
+    uint32_t    offset, length;
+};
+
+// Each step is the XOR of a state with the one after it, zero runs skipped; only the newest state is kept whole.
+// Steps sit in a fixed budget of bytes, and the oldest go when a new one needs the room.
+struct RewindBuffer
+{
+    uint32_t            budget, head;
+    uint8_t*            bytes;
+    struct RewindStep   Steps[REWIND_MAX_STEPS];
+    int                 first, count;
+    struct Snapshot     Last, Next, Delta;
+    int                 valid;              // Last holds a state
+};
+
+void killSnapshot       (struct Snapshot* snapshot);
+int  takeSnapshot       (struct Snapshot* snapshot, const struct SnapshotRegion* regions, int count);
+int  restoreSnapshot    (const struct Snapshot* snapshot, struct SnapshotRegion* regions, int count);
+
+int  initRewind         (struct RewindBuffer* rewind, uint32_t budget);
+void killRewind         (struct RewindBuffer* rewind);
+void clearRewind        (struct RewindBuffer* rewind);
+int  pushRewind         (struct RewindBuffer* rewind, const struct SnapshotRegion* regions, int count);
+int  popRewind          (struct RewindBuffer* rewind, struct SnapshotRegion* regions, int count);
+
+#endif
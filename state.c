@@ -1,14 +1,17 @@
 #include "state.h"
+#include "system.h"
 #include "title.h"
 #include <stdio.h>
 
-// updatestate must received System* as an argument to access global data
-// system has a pointer StateManager*, which updatestate may use to change states
+// States get the System, so they can reach the other subsystems and use switchState() / leaveState()
 // input is handled only to the current state
 // based on the input and updated logic, the state generates commands
 
 int pushState(struct State* state, struct StateList* stateList)
 {
+    if (stateList->numStates >= MAX_STATES)
+        return 1;
+
     stateList->States[stateList->numStates++] = state;
 
     return 0;
@@ -16,6 +19,9 @@ int pushState(struct State* state, struct StateList* stateList)
 
 int popState(struct State* state, struct StateList* stateList)
 {
+    if (stateList->numStates == 0 || stateList->States[stateList->numStates-1] != state)
+        return 1;
+
     stateList->States[--stateList->numStates] = NULL;
 
     return 0;
@@ -28,42 +34,181 @@ int initStateManager(struct StateManager* stateMgr)
     stateMgr->CurrentState          = NULL;
     stateMgr->StateList.numStates   = 0;
 
-    struct State* Title = createState_Title();
-    pushState(Title, &stateMgr->StateList);
-
     return 0;
 }
 
-int updateAllStates(struct StateManager* stateMgr, double dt)
+static int findState(struct StateList* stateList, struct State* state)
 {
-    struct State** States = stateMgr->StateList.States;
-    int numStates        = stateMgr->StateList.numStates;
     int i;
 
-    if (numStates == 0)
-        printf("updateStates(): Nothing to update\n");
-    else
+    for (i = 0; i < stateList->numStates; i++)
+        if (stateList->States[i] == state)
+            return i;
+
+    return -1;
+}
+
+// Current state always updates with the real dt; background states that may update do so every updateInterval frames
+int updateAllStates(struct System* system, double dt)
+{
+    struct StateManager* StateMgr = &system->StateManager;
+    struct State* State;
+    int i;
+
+    for (i = 0; i < StateMgr->StateList.numStates; i++)
     {
-        for (i = 0; i < numStates; i++)
+        State = StateMgr->StateList.States[i];
+
+        if (State == StateMgr->CurrentState)
+            State->update(system, dt);
+        else if (State->enable_update)
         {
-            if (States[i]->enable_update)
-                States[i]->update(0.0);
+            State->pendingDt += dt;
+
+            if (++State->framesSkipped >= State->updateInterval)
+            {
+                State->update(system, State->pendingDt);
+                State->framesSkipped = 0;
+                State->pendingDt     = 0;
+            }
         }
     }
 
     return 0;
 }
 
-int switchState(struct StateManager* stateMgr, struct State* state)
+// Bottom of the stack first, so the current state draws over the ones behind it.
+// A frozen state draws one last time and everything recorded up to it is captured into a texture;
+// after that the texture stands in for it and for every state below it.
+int drawAllStates(struct System* system, double dt)
 {
-    state->LastState = stateMgr->CurrentState;
-    stateMgr->CurrentState = state;
+    struct StateManager* StateMgr = &system->StateManager;
+    struct Video* Video = &system->Video;
+    struct State* State;
+    int i, first = 0;
+
+    for (i = StateMgr->StateList.numStates-1; i >= 0; i--)
+    {
+        State = StateMgr->StateList.States[i];
+
+        if (State->frozen && State->FrozenFrame)
+        {
+            first = i;
+            break;
+        }
+    }
 
-    if ((state->type & STATE_PAUSE_LAST_UPDATE) || !(state->LastState->type & STATE_BACKGROUND_UPDATE))
-        state->LastState->enable_update = 0;
+    for (i = first; i < StateMgr->StateList.numStates; i++)
+    {
+        State = StateMgr->StateList.States[i];
 
-    if ((state->type & STATE_PAUSE_LAST_DRAW) || !(state->LastState->type & STATE_BACKGROUND_DRAW))
-        state->LastState->enable_draw = 0;
+        if (State == StateMgr->CurrentState || State->enable_draw)
+            State->draw(system, dt);
+        else if (State->frozen)
+        {
+            if (State->FrozenFrame == NULL)
+            {
+                State->draw(system, dt);
+
+                if (captureDrawList(Video, &State->FrozenFrame))
+                {
+                    State->frozen = 0;
+                    continue;
+                }
+            }
+
+            drawSprite(Video->DrawList, LAYER_BACKGROUND, State->FrozenFrame, (SDL_Rect){0, 0, Video->Screen.w, Video->Screen.h},
+                       (SDL_Rect){0, 0, Video->Screen.w, Video->Screen.h}, 0xFFFFFF, SDL_BLENDMODE_NONE);
+        }
+    }
 
     return 0;
 }
+
+static void enterState(struct System* system, struct State* state)
+{
+    state->enable_update = 1;
+    state->enable_draw   = 1;
+    state->frozen        = 0;
+    state->framesSkipped = 0;
+    state->pendingDt     = 0;
+
+    if (state->FrozenFrame)
+    {
+        SDL_DestroyTexture(state->FrozenFrame);
+        state->FrozenFrame = NULL;
+    }
+}
+
+// Make state the current one. A state that is already on the stack is returned to, leaving everything above it;
+// otherwise it goes on top and the flags of both decide what the last state keeps doing in the background.
+int switchState(struct System* system, struct State* state)
+{
+    struct StateManager* StateMgr = &system->StateManager;
+    struct State* Last = StateMgr->CurrentState;
+
+    if (state == NULL || state == Last)
+        return 0;
+
+    if (findState(&StateMgr->StateList, state) >= 0)
+    {
+        while (StateMgr->CurrentState != state)
+            leaveState(system);
+
+        return 0;
+    }
+
+    if (pushState(state, &StateMgr->StateList))
+    {
+        printf("Error - switchState(): more than %d states\n", MAX_STATES);
+
+        return 1;
+    }
+
+    if (Last)
+    {
+        Last->enable_update = (Last->type & STATE_BACKGROUND_UPDATE) && !(state->type & STATE_PAUSE_LAST_UPDATE);
+        Last->enable_draw   = (Last->type & STATE_BACKGROUND_DRAW)   && !(state->type & STATE_PAUSE_LAST_DRAW);
+        Last->frozen        = (Last->type & STATE_BACKGROUND_DRAW)   && !Last->enable_draw;
+        Last->framesSkipped = 0;
+        Last->pendingDt     = 0;
+        Last->pause(system);
+    }
+
+    state->LastState = Last;
+    StateMgr->CurrentState = state;
+    enterState(system, state);
+
+    if (state->updateInterval <= 0)
+        state->updateInterval = BACKGROUND_UPDATE_INTERVAL;
+
+    return state->init(system);
+}
+
+// Pop the current state and resume the one below it
+int leaveState(struct System* system)
+{
+    struct StateManager* StateMgr = &system->StateManager;
+    struct State* State = StateMgr->CurrentState;
+    struct State* Next;
+
+    if (State == NULL || popState(State, &StateMgr->StateList))
+        return 1;
+
+    enterState(system, State);
+
+    if (State->type & STATE_KILL_ON_EXIT)
+        State->kill(system);
+    else
+        State->pause(system);
+
+    Next = StateMgr->StateList.numStates ? StateMgr->StateList.States[StateMgr->StateList.numStates-1] : NULL;
+    StateMgr->CurrentState = Next;
+
+    if (Next == NULL)
+        return 0;
+
+    enterState(system, Next);
+
+    return (Next->type & STATE_RESET_ON_ENTRY) ? Next->init(system) : Next->resume(system);
+}
@@ -1,7 +1,12 @@
 #ifndef STATE_H
 #define STATE_H
 
+#include <SDL2/SDL.h>
+
 #define MAX_STATES 10
+#define BACKGROUND_UPDATE_INTERVAL 4    // background states update every 4th frame by default, with the time of all 4
+
+struct System;
 
 enum StateTypes
 {
@@ -10,7 +15,7 @@ enum StateTypes
     STATE_BACKGROUND_UPDATE   = 1 << 2,   // Update even when not current state, e.g. multiplayer game behind console
     STATE_BACKGROUND_DRAW     = 1 << 3,   // Draw even when not current state, e.g. singleplayer game behind pause menu
     STATE_PAUSE_LAST_UPDATE   = 1 << 4,   // overrides STATE_BACKGROUND_UPDATE, e.g. pause menu for singleplayer does this, but console won't
-    STATE_PAUSE_LAST_DRAW     = 1 << 5    // overrides STATE_BACKGROUND_DRAW
+    STATE_PAUSE_LAST_DRAW     = 1 << 5    // overrides STATE_BACKGROUND_DRAW; the last state's final frame is kept as a texture instead
 };
 
 struct State
@@ -18,14 +23,19 @@ struct State
     int type;
     int enable_update;
     int enable_draw;
+    int updateInterval;         // frames between background updates
+    int framesSkipped;
+    double pendingDt;           // time the throttled background update hasn't seen yet
+    int frozen;                 // stopped drawing, shown from FrozenFrame
+    SDL_Texture* FrozenFrame;
     void* Data;
 
-    int (*init)  ();
-    int (*kill)  ();
-    int (*resume)();
-    int (*pause) ();
-    int (*update)(double);
-    int (*draw)  (double);
+    int (*init)  (struct System*);
+    int (*kill)  (struct System*);
+    int (*resume)(struct System*);
+    int (*pause) (struct System*);
+    int (*update)(struct System*, double);
+    int (*draw)  (struct System*, double);
 
     struct State* LastState;
 };
@@ -45,7 +55,9 @@ struct StateManager
 int pushState       (struct State* state, struct StateList* stateList);
 int popState        (struct State* state, struct StateList* stateList);
 int initStateManager(struct StateManager* stateMgr);
-int updateAllStates (struct StateManager* stateMgr, double dt);
-int switchState     (struct StateManager* stateMgr, struct State* state);
+int updateAllStates (struct System* system, double dt);
+int drawAllStates   (struct System* system, double dt);
+int switchState     (struct System* system, struct State* state);
+int leaveState      (struct System* system);
 
 #endif
@@ -1,22 +1,71 @@
 #include "system.h"
 #include "title.h"
+#include "ecs.h"
 #include <stdio.h>
 
-int initSystem(struct System* system, char* filename)
+static int handleQuit(struct Message* message, void* data)
+{
+    struct System* System = data;
+    System->running = 0;
+
+    return 0;
+}
+
+static int handleSwitchState(struct Message* message, void* data)
+{
+    return switchState(data, message->Payload.Pointer);
+}
+
+int initSystem(struct System* system, int argc, char* argv[])
 {
     printf("initSystem()\n");
 
     int error = 0;
+    char* filename = (argc > 1 && argv[1][0] != '-') ? argv[1] : NULL;
     system->running = 1;
 
-  //error |= initMemory         (&system->Memory);
+    error |= initMemory         (&system->Memory);
     error |= loadConfig         (&system->Config, filename);
+    error |= parseArguments     (&system->Config, argc, argv);
     error |= initStateManager   (&system->StateManager);
     error |= initInput          (&system->Input);
+    error |= initConsole        (&system->Console);
     error |= initMessageBus     (&system->MessageBus);
-    error |= initVideo          (&system->Video, &system->Config);
+    error |= addMessageHandler  (&system->MessageBus, MSG_QUIT,         handleQuit,         system);
+    error |= addMessageHandler  (&system->MessageBus, MSG_SWITCH_STATE, handleSwitchState,  system);
+
+    if (system->Config.headless)    // no window; play the replay through and quit
+    {
+        error |= runHeadless(&system->Config, &system->Memory);
+        system->running = 0;
+
+        return error;
+    }
+
+    if (system->Config.compile[0])  // nor does compiling a map
+    {
+        error |= runCompile(&system->Config, &system->Memory);
+        system->running = 0;
+
+        return error;
+    }
+
+    if (system->Config.server)      // a dedicated server has no window either
+    {
+        error |= runServer(&system->Config, &system->Memory);
+        system->running = 0;
+
+        return error;
+    }
+
+    error |= initVideo          (&system->Video, &system->Config, &system->Memory);
   //error |= initAudio          (&system->Audio);
 
+    if (error == 0)
+        error |= switchState    (system, createState_Title(&system->Memory));
+
+    system->lastCounter = SDL_GetPerformanceCounter();
+
     if (error)
         printf("Error - initSystem() failed\n");
 
@@ -25,15 +74,28 @@ int initSystem(struct System* system, char* filename)
 
 int execSystem(struct System* system)
 {
+    Uint64 counter = SDL_GetPerformanceCounter();
+
     printf("execSystem()\n");
 
+    system->dt          = (double)(counter - system->lastCounter) / SDL_GetPerformanceFrequency();
+    system->lastCounter = counter;
     system->running = execInput(&system->Input)^1;
-    updateAllStates (&system->StateManager, 0.0); // uses input & state data to change variables & generate update commands
-  //drawAllStates   (&system->StateManager, 0.0); // walks through state data & update commands in message bus to generate draw commands
-  //soundAllStates  (&system->StateManager, 0.0); // walks through state data & update commands in message bus to generate sound commands
+    execConsole     (&system->Console, &system->Input, &system->Config);
+    updateAllStates (system, system->dt); // uses input & state data to change variables & generate update commands
+    pollMessages    (&system->MessageBus); // dispatches everything the states and workers posted this frame
+    drawAllStates   (system, system->dt); // states record their draw commands into Video's draw list
+  //soundAllStates  (system, system->dt); // walks through state data & update commands in message bus to generate sound commands
     execVideo       (&system->Video); // process video // walks through draw commands to draw the screen image and render it
   //execAudio       (&system->Audio); // process audio // walks through sound commands to make noises
-  //memory allocator does occasional de-fragmentation of memory
+
+    if (system->Config.changes) // settings changed from the console; each subsystem reallocates only what they affect
+    {
+        applyVideoConfig(&system->Video, &system->Config);
+        system->Config.changes = CHANGE_NONE;
+    }
+
+    resetArena(&system->Memory.Frame); // everything allocated this frame is gone; nothing else is allocated per frame
 
     return 1;
 }
@@ -43,5 +105,12 @@ int quitSystem(struct System* system)
     printf("quitSystem()\n");
     // kill all states and subsystems
 
+    while (system->StateManager.CurrentState)
+        leaveState(system);
+
+    printMessageStats(&system->MessageBus);
+    printMemoryStats(&system->Memory);
+    killMemory(&system->Memory);
+
     return 0;
 }
@@ -1,24 +1,29 @@
 #ifndef SYSTEM_H
 #define SYSTEM_H
 
+#include "memory.h"
 #include "config.h"
 #include "state.h"
 #include "message.h"
 #include "video.h"
 #include "input.h"
+#include "console.h"
 
 struct System
 {
     int running;
-    //struct Memory       Memory;
+    struct Memory       Memory;
     struct Config       Config;
     struct StateManager StateManager;
     struct MessageBus   MessageBus;
     struct Video        Video;
     struct Input        Input;
+    struct Console      Console;
+    Uint64              lastCounter;
+    double              dt;             // seconds since the last execSystem()
 };
 
-int initSystem(struct System* system, char* filename);
+int initSystem(struct System* system, int argc, char* argv[]);
 int quitSystem(struct System* system);
 int execSystem(struct System* system);
 
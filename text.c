@@ -1,10 +1,16 @@
+#include "text.h"
+#include "video.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 int getTextSize(const char* text, int* columns, int* rows)
 {
     int num_chars   = 0;
     int num_rows    = 1;
     int current_row = 0;
     int longest_row = 0;
-    char* c;
+    const char* c;
 
     for (c = text; *c != '\0'; c++)
     {
@@ -40,3 +46,180 @@ int getTextPositionCentered(const char* text, int font_w, int font_h, int area_w
 
     return chars;
 }
+
+void initTextCache(struct TextCache* cache)
+{
+    printf("initTextCache()\n");
+
+    memset(cache, 0, sizeof(struct TextCache));
+}
+
+// Call when a font texture is reloaded, the cached texture coordinates would be stale
+void clearTextCache(struct TextCache* cache)
+{
+    int i;
+
+    for (i = 0; i < TEXT_CACHE_SIZE; i++)
+        cache->Layouts[i].valid = 0;
+}
+
+void killTextCache(struct TextCache* cache)
+{
+    int i;
+
+    for (i = 0; i < TEXT_CACHE_SIZE; i++)
+    {
+        free(cache->Layouts[i].text);
+        free(cache->Layouts[i].Vertices);
+    }
+
+    memset(cache, 0, sizeof(struct TextCache));
+}
+
+static int reserve(void** buffer, int* capacity, int count, size_t size)
+{
+    void* grown;
+
+    if (count <= *capacity)
+        return 0;
+
+    if ((grown = realloc(*buffer, count * size)) == NULL)
+        return 1;
+
+    *buffer   = grown;
+    *capacity = count;
+
+    return 0;
+}
+
+static uint32_t hashText(const char* text, int* length, struct Font* font, int maxColumns, int maxRows)
+{
+    uint32_t hash = 2166136261u;    // FNV-1a
+    const char* c;
+
+    for (c = text; *c != '\0'; c++)
+        hash = (hash ^ (uint8_t)*c) * 16777619u;
+
+    *length = c - text;
+
+    return hash ^ (uint32_t)(uintptr_t)font ^ (maxColumns * 31) ^ (maxRows * 131);
+}
+
+// Same wrapping as drawText(): a new row on '\n' or after maxColumns characters, stop after maxRows
+static int layoutText(struct TextLayout* layout)
+{
+    struct Font* Font = layout->Font;
+    SDL_Vertex* Vertex;
+    const char* c;
+    int texW, texH, column = 0, row = 0, numQuads = 0;
+    float x, y, u, v, du, dv;
+
+    if (SDL_QueryTexture(Font->Texture, NULL, NULL, &texW, &texH) < 0)
+        return 1;
+
+    for (c = layout->text; *c != '\0'; c++)
+        numQuads += (*c != ' ' && *c != '\n');
+
+    if (reserve((void**)&layout->Vertices, &layout->quadCapacity, numQuads, 4 * sizeof(SDL_Vertex)))
+        return 1;
+
+    du = (float)Font->width  / texW;
+    dv = (float)Font->height / texH;
+    layout->columns  = 0;
+    layout->numQuads = 0;
+
+    for (c = layout->text; *c != '\0'; c++)
+    {
+        if (*c == '\n' || column >= layout->maxColumns)
+        {
+            column = 0;
+
+            if (++row >= layout->maxRows)
+                break;
+
+            if (*c == '\n')
+                continue;
+        }
+
+        if (*c != ' ')
+        {
+            x = column * Font->width;
+            y = row    * Font->height;
+            u = (*c % 32) * du;
+            v = (*c / 32) * dv;
+
+            Vertex = &layout->Vertices[layout->numQuads++ * 4];
+            Vertex[0] = (SDL_Vertex){{x,               y               }, {255, 255, 255, 255}, {u,    v   }};
+            Vertex[1] = (SDL_Vertex){{x + Font->width, y               }, {255, 255, 255, 255}, {u+du, v   }};
+            Vertex[2] = (SDL_Vertex){{x + Font->width, y + Font->height}, {255, 255, 255, 255}, {u+du, v+dv}};
+            Vertex[3] = (SDL_Vertex){{x,               y + Font->height}, {255, 255, 255, 255}, {u,    v+dv}};
+        }
+
+        if (++column > layout->columns)
+            layout->columns = column;
+    }
+
+    layout->rows = (row < layout->maxRows) ? row + 1 : layout->maxRows;
+
+    return 0;
+}
+
+// Returns the cached layout, building it on a miss. NULL if every candidate slot is already in use this frame,
+// so a layout handed out this frame is never freed before the draw list is submitted.
+struct TextLayout* getTextLayout(struct TextCache* cache, struct Font* font, const char* text, int maxColumns, int maxRows)
+{
+    struct TextLayout* Layout;
+    struct TextLayout* Victim = NULL;
+    int i, length;
+    uint32_t hash = hashText(text, &length, font, maxColumns, maxRows);
+
+    for (i = 0; i < TEXT_CACHE_PROBE; i++)
+    {
+        Layout = &cache->Layouts[(hash + i) & (TEXT_CACHE_SIZE-1)];
+
+        if (Layout->valid && Layout->hash == hash && Layout->Font == font && Layout->maxColumns == maxColumns
+            && Layout->maxRows == maxRows && Layout->length == length && !memcmp(Layout->text, text, length))
+        {
+            Layout->lastUsed = cache->frame;
+            cache->hits++;
+
+            return Layout;
+        }
+
+        // prefer an empty slot, then the least recently used one not touched this frame
+        if (!Layout->valid)
+        {
+            if (Victim == NULL || Victim->valid)
+                Victim = Layout;
+        }
+        else if (Layout->lastUsed != cache->frame && (Victim == NULL || (Victim->valid && Layout->lastUsed < Victim->lastUsed)))
+            Victim = Layout;
+    }
+
+    if (Victim == NULL)
+        return NULL;
+
+    if (Victim->valid)
+        cache->evictions++;
+
+    cache->misses++;
+    Victim->valid      = 0;
+    Victim->hash       = hash;
+    Victim->lastUsed   = cache->frame;
+    Victim->Font       = font;
+    Victim->maxColumns = maxColumns;
+    Victim->maxRows    = maxRows;
+    Victim->length     = length;
+
+    if (reserve((void**)&Victim->text, &Victim->textCapacity, length + 1, 1))
+        return NULL;
+
+    memcpy(Victim->text, text, length + 1);
+
+    if (layoutText(Victim))
+        return NULL;
+
+    Victim->valid = 1;
+
+    return Victim;
+}
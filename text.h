@@ -1,7 +1,42 @@
 #ifndef TEXT_H
 #define TEXT_H
 
+#include <SDL2/SDL.h>
+#include <stdint.h>
+
+#define TEXT_CACHE_SIZE     256     // power of two
+#define TEXT_CACHE_PROBE    8       // slots searched per string before evicting the least recently used
+
+struct Font;
+
+// Glyph quads of a laid out string, relative to its top-left corner and untinted; built once per string and font
+struct TextLayout
+{
+    int             valid;
+    uint32_t        hash;
+    uint32_t        lastUsed;       // frame number
+    struct Font*    Font;
+    int             maxColumns, maxRows;
+    int             length;
+    char*           text;
+    int             columns, rows;  // size of the laid out text, in characters
+    int             numQuads;
+    SDL_Vertex*     Vertices;       // 4 per quad
+    int             textCapacity, quadCapacity;     // buffers only grow and are kept on eviction, so a warm cache doesn't allocate
+};
+
+struct TextCache
+{
+    uint32_t            frame;
+    int                 hits, misses, evictions;
+    struct TextLayout   Layouts[TEXT_CACHE_SIZE];
+};
+
 int getTextSize             (const char* text, int* columns, int* rows);
 int getTextPositionCentered (const char* text, int font_w, int font_h, int area_w, int area_h, int* x, int* y);
+void initTextCache          (struct TextCache* cache);
+void clearTextCache         (struct TextCache* cache);
+void killTextCache          (struct TextCache* cache);
+struct TextLayout* getTextLayout(struct TextCache* cache, struct Font* font, const char* text, int maxColumns, int maxRows);
 
 #endif
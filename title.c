@@ -1,57 +1,75 @@
 #include "title.h"
 #include "state.h"
+#include "system.h"
+#include "game.h"
 #include <stdio.h>
-#include <stdlib.h> // malloc should work through a memory.c command instead
+#include <string.h>
 
-int initState_Title()  // should take message bus instead
+int initState_Title(struct System* system)
 {
     printf("initState_Title()\n");
 
     return 0;
 }
 
-int killState_Title()
+int killState_Title(struct System* system)
 {
     printf("killState_Title()\n");
 
     return 0;
 }
 
-int resumeState_Title()
+int resumeState_Title(struct System* system)
 {
     printf("resumeState_Title()\n");
 
     return 0;
 }
 
-int pauseState_Title()
+int pauseState_Title(struct System* system)
 {
     printf("pauseState_Title()\n");
 
     return 0;
 }
 
-int updateState_Title()
+int updateState_Title(struct System* system, double dt)
 {
+    struct TitleData* Data = system->StateManager.CurrentState->Data;
+
     printf("updateState_Title()\n");
 
+    if (system->Input.TextField == NULL && system->Input.Keys[SDL_SCANCODE_RETURN])
+    {
+        if (Data->Game == NULL)
+            Data->Game = createState_Game(&system->Memory);
+
+        postMessage(&system->MessageBus, MSG_SWITCH_STATE, (union Data){.Pointer = Data->Game});
+    }
+
     return 0;
 }
 
-int drawState_Title()
+int drawState_Title(struct System* system, double dt)
 {
     printf("drawState_Title()\n");
+    drawTextCentered("VIDEO TEST\n\nPRESS ENTER", &system->Video.Graphics.BasicFont, 0xFFFFFF00, &system->Video);
 
     return 0;
 }
 
-struct State* createState_Title()
+struct State* createState_Title(struct Memory* memory)
 {
-    struct State* State = malloc(sizeof(struct State));
+    struct State* State = allocPool(&memory->States);
+
+    if (State == NULL)
+        return NULL;
+
+    memset(State, 0, sizeof(struct State));
 
     State->enable_update    = 1;
     State->enable_draw      = 1;
-    State->Data             = (struct TitleData*)malloc(sizeof(struct TitleData));
+    State->Data             = (struct TitleData*)callocArena(&memory->Persistent, 1, sizeof(struct TitleData));
     State->init             = initState_Title;
     State->kill             = killState_Title;
     State->resume           = resumeState_Title;
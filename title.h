@@ -2,12 +2,14 @@
 #define TITLE_H
 
 #include "input.h"
+#include "memory.h"
 
 struct TitleData
 {
     struct TextField TextField;
+    struct State* Game;     // created the first time it's entered
 };
 
-struct State* createState_Title();
+struct State* createState_Title(struct Memory* memory);
 
 #endif
@@ -4,7 +4,26 @@
 #include <stdlib.h>
 #include <string.h>
 
-int initVideo(struct Video* video, struct Config* config) // could be split into functions, including initgraphics
+static void setScreen(struct Video* video, struct Config* config)
+{
+    SDL_RenderSetScale(video->Renderer, config->resScale, config->resScale);
+
+    if (config->screenWidth < config->windowWidth || config->screenHeight < config->windowHeight)
+    {
+        video->Screen.x = (video->windowWidth - config->screenWidth)/2;
+        video->Screen.y = (video->windowHeight - config->screenHeight)/2;
+        video->Screen.w = config->screenWidth;
+        video->Screen.h = config->screenHeight;
+        SDL_RenderSetViewport(video->Renderer, &video->Screen);
+    }
+    else
+    {
+        video->Screen = (SDL_Rect){0, 0, video->windowWidth, video->windowHeight};
+        SDL_RenderSetViewport(video->Renderer, NULL);
+    }
+}
+
+int initVideo(struct Video* video, struct Config* config, struct Memory* memory) // could be split into functions, including initgraphics
 {
     printf("initVideo()\n");
 
@@ -47,19 +66,18 @@ int initVideo(struct Video* video, struct Config* config) // could be split into
         return 1;
     }
 
-    if (config->resScale > 1)
-        SDL_RenderSetScale(video->Renderer,config->resScale, config->resScale);
+    setScreen(video, config);
 
-    if (config->screenWidth < config->windowWidth || config->screenHeight < config->windowHeight)
+    // Graphics
+    if ((video->DrawList = allocArena(&memory->Persistent, sizeof(struct DrawList))) == NULL)
     {
-        video->Screen.x = (video->windowWidth - config->screenWidth)/2;
-        video->Screen.y = (video->windowHeight - config->screenHeight)/2;
-        video->Screen.w = config->screenWidth;
-        video->Screen.h = config->screenHeight;
-        SDL_RenderSetViewport(video->Renderer, &video->Screen);
+        printf("Error - out of persistent memory for DrawList\n");
+
+        return 1;
     }
 
-    // Graphics
+    initDrawList(video->DrawList, &memory->Frame);
+
     if (initFont(&video->Graphics.BasicFont, config->font, 8, 8, video->Renderer) == 1)
     {
         printf("Error - initFont() failed\n");
@@ -72,31 +90,80 @@ int initVideo(struct Video* video, struct Config* config) // could be split into
 
 int killVideo(struct Video* video)
 {
+    killTextCache(&video->DrawList->TextCache);
     SDL_DestroyWindow(video->Window);
 
     return 0;
 }
 
+int applyVideoConfig(struct Video* video, struct Config* config)
+{
+    printf("applyVideoConfig()\n");
+
+    if (config->changes & CHANGE_WINDOW)
+    {
+        video->windowWidth  = config->windowWidth;
+        video->windowHeight = config->windowHeight;
+        SDL_SetWindowSize(video->Window, video->windowWidth * config->resScale, video->windowHeight * config->resScale);
+        setScreen(video, config);
+    }
+
+    if (config->changes & CHANGE_FONT)
+    {
+        SDL_DestroyTexture(video->Graphics.BasicFont.Texture);
+        clearTextCache(&video->DrawList->TextCache);
+
+        if (initFont(&video->Graphics.BasicFont, config->font, 8, 8, video->Renderer) == 1)
+        {
+            printf("Error - initFont() failed\n");
+
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
 int execVideo(struct Video* video)
 {
     printf("execVideo()\n");
-    execGraphics(video, NULL);
+    execGraphics(video);
     SDL_RenderPresent(video->Renderer);
+    clearDrawList(video->DrawList);
 
     return 0;
 }
 
-int execGraphics(struct Video* video, struct MessageBus* MessageBus)
+int execGraphics(struct Video* video)
 {
     // Blank screen
     SDL_SetRenderDrawColor(video->Renderer, 64, 128, 255, 255);
-    SDL_RenderFillRect(video->Renderer, NULL);
+    SDL_RenderClear(video->Renderer);
+
+    // Everything the states recorded this frame, sorted by layer and state
+    submitDrawList(video->DrawList, video->Renderer);
+
+    return 0;
+}
+
+// Render what has been recorded so far into a screen-sized texture, created on first use, and start the list over
+int captureDrawList(struct Video* video, SDL_Texture** texture)
+{
+    if (*texture == NULL)
+        *texture = SDL_CreateTexture(video->Renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, video->Screen.w, video->Screen.h);
 
-    // Walk through message bus here to render everything
+    if (*texture == NULL || SDL_SetRenderTarget(video->Renderer, *texture) < 0)
+    {
+        printf("Error - captureDrawList() failed: %s\n", SDL_GetError());
+
+        return 1;
+    }
 
-    // temporary test functions
-    const char* text = "VIDEO TEST";
-    drawTextCentered(text, &video->Graphics.BasicFont, 0xFFFFFF00, video);
+    SDL_SetRenderDrawColor(video->Renderer, 0, 0, 0, 255);
+    SDL_RenderClear(video->Renderer);
+    submitDrawList(video->DrawList, video->Renderer);
+    SDL_SetRenderTarget(video->Renderer, NULL);
+    clearDrawList(video->DrawList);
 
     return 0;
 }
@@ -131,58 +198,34 @@ int initFont(struct Font* font, const char* filename, int w, int h, SDL_Renderer
     return 0;
 }
 
+// x, y in characters; records the string into the draw list, wrapping at max_columns
 int drawText(const char* text, struct Font* font, int x, int y, int max_columns, int max_rows, uint32_t color, struct Video* video)
 {
-    int row;
-    int column;
-    char* c = text;
-    SDL_Rect source = {0, 0, font->width, font->height};
-    SDL_Rect destination;
-    SDL_SetTextureColorMod(font->Texture, uintToRGB(color));
-
     if (x >= 0)             x           *= font->width;
     if (y >= 0)             y           *= font->height;
-    if (max_rows == 0)      max_rows     = (video->Screen.w-x) / font->height;
-    if (max_columns == 0)   max_columns  = (video->Screen.h-y) / font->width;
-
-    destination.x = x;
-    destination.y = y;
-    destination.w = font->width;
-    destination.h = font->height;
-
-    for (row = 0; row < max_rows; row++)
-    {
-        destination.x = x;
+    if (max_columns == 0)   max_columns  = (video->Screen.w-x) / font->width;
+    if (max_rows == 0)      max_rows     = (video->Screen.h-y) / font->height;
 
-        for (column = 0; column < max_columns; column++, c++)
-        {
-            if (*c == '\0')
-                return 0;
-            else if (*c == '\n')
-                column = max_columns;
-            else
-            {
-                source.y = ((*c) / 32) * font->height;
-                source.x = ((*c) % 32) * font->width;
-                SDL_RenderCopy(video->Renderer, font->Texture, &source, &destination);
-            }
-            destination.x += font->width;
-        }
-        destination.y += font->height;
-    }
-
-    return 0;
+    return drawString(video->DrawList, LAYER_HUD, font, text, x, y, max_columns, max_rows, color);
 }
 
+// Centered on the screen; the size comes from the cached layout, so measuring costs a lookup, not a pass over the string
 int drawTextCentered(const char* text, struct Font* font, uint32_t color, struct Video* video)
 {
-    static int x = -1;
-    static int y;
+    struct TextLayout* Layout;
+    int columns = video->Screen.w / font->width;
+    int rows    = video->Screen.h / font->height;
+    int x, y;
 
-    if (x == -1)
+    if ((Layout = getTextLayout(&video->DrawList->TextCache, font, text, columns, rows)) != NULL)
+    {
+        x = (columns - Layout->columns) / 2;
+        y = (rows    - Layout->rows)    / 2;
+    }
+    else
         getTextPositionCentered(text, font->width, font->height, video->Screen.w, video->Screen.h, &x, &y);
 
-    drawText(text, &video->Graphics.BasicFont, x, y, 0, 0, color, video);
+    return drawString(video->DrawList, LAYER_HUD, font, text, x * font->width, y * font->height, columns, rows, color);
 }
 
 uint32_t colorToUint(int r, int g, int b)
@@ -4,7 +4,8 @@
 #include <SDL2/SDL.h>
 #include <stdint.h>
 #include "config.h"
-#include "message.h"
+#include "draw.h"
+#include "memory.h"
 
 #define uintToRGB(color) ((color >> 16) & 0xFF), ((color >> 8) & 0xFF), (color & 0xFF)
 
@@ -28,12 +29,15 @@ struct Video
     SDL_Renderer*       Renderer;
     SDL_Rect            Screen;
     struct Graphics     Graphics;
+    struct DrawList*    DrawList;       // recorded by the states during the frame, submitted by execGraphics()
 };
 
-int initVideo           (struct Video* video, struct Config* config);
+int initVideo           (struct Video* video, struct Config* config, struct Memory* memory);
 int killVideo           (struct Video* video);
 int execVideo           (struct Video* video);
-int execGraphics        (struct Video* video, struct MessageBus* MessageBus);
+int execGraphics        (struct Video* video);
+int captureDrawList     (struct Video* video, SDL_Texture** texture);
+int applyVideoConfig    (struct Video* video, struct Config* config);
 int initFont            (struct Font* font, const char* filename, int w, int h, SDL_Renderer* renderer);
 int drawText            (const char* text, struct Font* font, int x, int y, int max_columns, int max_rows, uint32_t color, struct Video* video);
 int drawTextCentered    (const char* text, struct Font* font, uint32_t color, struct Video* video);
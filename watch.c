@@ -0,0 +1,147 @@
+#include "watch.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+
+#define WATCH_EVENTS    (IN_CLOSE_WRITE | IN_MOVED_TO)  // editors either rewrite in place or rename a temp file over it
+
+static int watchThread(void* data)
+{
+    struct Watcher* Watcher = data;
+    struct inotify_event* event;
+    struct pollfd pfd = {.fd = Watcher->fd, .events = POLLIN};
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t length;
+    char* p;
+    int i;
+
+    while (Watcher->running)
+    {
+        if (poll(&pfd, 1, WATCH_POLL_MS) <= 0)
+            continue;
+
+        if ((length = read(Watcher->fd, buffer, sizeof(buffer))) <= 0)
+            continue;
+
+        for (p = buffer; p < buffer + length; p += sizeof(struct inotify_event) + event->len)
+        {
+            event = (struct inotify_event*)p;
+
+            if (event->len == 0)
+                continue;
+
+            SDL_LockMutex(Watcher->Lock);
+
+            for (i = 0; i < Watcher->numFiles; i++)
+            {
+                if (Watcher->Files[i].wd == event->wd && !strcmp(Watcher->Files[i].name, event->name))
+                {
+                    printf("watchThread(): %s changed\n", Watcher->Files[i].path);
+                    Watcher->Files[i].reload(Watcher->Files[i].path, Watcher->Files[i].data);
+                }
+            }
+
+            SDL_UnlockMutex(Watcher->Lock);
+        }
+    }
+
+    return 0;
+}
+
+int initWatcher(struct Watcher* watcher)
+{
+    printf("initWatcher()\n");
+
+    memset(watcher, 0, sizeof(struct Watcher));
+
+    if ((watcher->fd = inotify_init1(IN_NONBLOCK)) < 0)
+    {
+        printf("Error - inotify_init1() failed\n");
+
+        return 1;
+    }
+
+    watcher->running = 1;
+    watcher->Lock    = SDL_CreateMutex();
+    watcher->Thread  = SDL_CreateThread(watchThread, "Watcher", watcher);
+
+    return 0;
+}
+
+int watchFile(struct Watcher* watcher, const char* path, WatchCallback reload, void* data)
+{
+    struct WatchedFile* File;
+    char directory[WATCH_PATH_SIZE];
+    char* slash;
+
+    if (watcher->Thread == NULL || watcher->numFiles >= MAX_WATCHED_FILES)
+        return 1;
+
+    SDL_LockMutex(watcher->Lock);
+
+    File = &watcher->Files[watcher->numFiles];
+    strncpy(File->path, path, WATCH_PATH_SIZE-1);
+    strncpy(directory, path, WATCH_PATH_SIZE-1);
+    directory[WATCH_PATH_SIZE-1] = '\0';
+
+    if ((slash = strrchr(directory, '/')) != NULL)
+    {
+        strncpy(File->name, slash+1, WATCH_PATH_SIZE-1);
+        *slash = '\0';
+    }
+    else
+    {
+        strncpy(File->name, path, WATCH_PATH_SIZE-1);
+        strcpy(directory, ".");
+    }
+
+    File->reload = reload;
+    File->data   = data;
+    File->wd     = inotify_add_watch(watcher->fd, directory, WATCH_EVENTS);
+
+    if (File->wd < 0)
+        printf("Error - watchFile() could not watch %s\n", directory);
+    else
+        watcher->numFiles++;
+
+    SDL_UnlockMutex(watcher->Lock);
+
+    return File->wd < 0;
+}
+
+void killWatcher(struct Watcher* watcher)
+{
+    if (watcher->Thread == NULL)
+        return;
+
+    watcher->running = 0;
+    SDL_WaitThread(watcher->Thread, NULL);
+    SDL_DestroyMutex(watcher->Lock);
+    close(watcher->fd);
+    watcher->Thread = NULL;
+}
+
+#else
+
+int initWatcher(struct Watcher* watcher)
+{
+    memset(watcher, 0, sizeof(struct Watcher));
+    printf("initWatcher(): file watching needs inotify, hot reload is disabled\n");
+
+    return 1;
+}
+
+int watchFile(struct Watcher* watcher, const char* path, WatchCallback reload, void* data)
+{
+    return 1;
+}
+
+void killWatcher(struct Watcher* watcher)
+{
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include <SDL2/SDL.h>
+
+#define MAX_WATCHED_FILES   8
+#define WATCH_PATH_SIZE     256
+#define WATCH_POLL_MS       250
+
+// Called on the watcher thread whenever the file is rewritten or replaced.
+// Do the slow work (parsing, decoding) here and hand the result to the main thread.
+typedef int (*WatchCallback)(const char* path, void* data);
+
+struct WatchedFile
+{
+    char            path[WATCH_PATH_SIZE];
+    char            name[WATCH_PATH_SIZE];  // basename, inotify reports changes relative to the directory
+    int             wd;
+    WatchCallback   reload;
+    void*           data;
+};
+
+struct Watcher
+{
+    int                 fd;
+    volatile int        running;
+    int                 numFiles;
+    SDL_Thread*         Thread;
+    SDL_mutex*          Lock;
+    struct WatchedFile  Files[MAX_WATCHED_FILES];
+};
+
+int  initWatcher(struct Watcher* watcher);
+int  watchFile  (struct Watcher* watcher, const char* path, WatchCallback reload, void* data);
+void killWatcher(struct Watcher* watcher);
+
+#endif